@@ -0,0 +1,31 @@
+# Writes the GLSL sources of the stock canvas shaders into a header as constexpr byte arrays.
+# Bytes are unsigned, plain char would make every byte above 0x7f a narrowing error.
+# Invoked at build time by module_extra.cmake:
+#   cmake -DSHADER_DIR=<dir> -DSHADERS=<name;name> -DOUTPUT=<header> -P embedshaders.cmake
+
+function(foglio_embed_file file_path var_name out_content)
+    file(READ ${file_path} hex_content HEX)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," hex_content "${hex_content}")
+    set(${out_content} "${${out_content}}\t\t\tinline constexpr unsigned char ${var_name}[] = { ${hex_content}0x00 };\n" PARENT_SCOPE)
+endfunction()
+
+set(content "// Don't edit this file\n//\n// It was auto generated by CMake from module/data/shaders\n\n#pragma once\n\n#include <cstddef>\n\nnamespace nap\n{\n\tnamespace shader\n\t{\n\t\tnamespace embedded\n\t\t{\n")
+
+set(table "")
+foreach(shader ${SHADERS})
+    foglio_embed_file(${SHADER_DIR}/${shader}.vert ${shader}_vert content)
+    foglio_embed_file(${SHADER_DIR}/${shader}.frag ${shader}_frag content)
+    string(APPEND table "\t\t\t\t{ \"${shader}\", ${shader}_vert, sizeof(${shader}_vert) - 1, ${shader}_frag, sizeof(${shader}_frag) - 1 },\n")
+endforeach()
+
+string(APPEND content "\n\t\t\tstruct Source\n\t\t\t{\n\t\t\t\tconst char* mName;\n\t\t\t\tconst unsigned char* mVert;\n\t\t\t\tstd::size_t mVertSize;\n\t\t\t\tconst unsigned char* mFrag;\n\t\t\t\tstd::size_t mFragSize;\n\t\t\t};\n\n")
+string(APPEND content "\t\t\tinline constexpr Source sources[] =\n\t\t\t{\n${table}\t\t\t};\n\t\t}\n\t}\n}\n")
+
+# Only touch the header when the content changed, keeps incremental builds incremental
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} old_content)
+    if("${old_content}" STREQUAL "${content}")
+        return()
+    endif()
+endif()
+file(WRITE ${OUTPUT} "${content}")
@@ -0,0 +1,86 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#version 450 core
+
+// RGBA16 texture with the BC1 or BC3 blocks of a frame, 8 bytes per texel
+uniform sampler2D inTexture;
+
+uniform UBO {
+	vec2 size;
+	int format;
+} ubo;
+
+in vec3 pass_Uvs;
+out vec4 out_Color;
+
+// The four little endian 16 bit words of a texel
+uvec4 fetchWords(ivec2 texel)
+{
+	return uvec4(round(texelFetch(inTexture, texel, 0) * 65535.0));
+}
+
+vec3 unpack565(uint color)
+{
+	return vec3(float((color >> 11) & 31u) / 31.0, float((color >> 5) & 63u) / 63.0, float(color & 31u) / 31.0);
+}
+
+// Texel of a color block, BC3 color blocks always use four colors
+vec4 decodeColor(uvec4 block, uint index, bool fourColors)
+{
+	uint selector = index < 8u ? (block.z >> (2u * index)) & 3u : (block.w >> (2u * (index - 8u))) & 3u;
+	vec3 color0 = unpack565(block.x);
+	vec3 color1 = unpack565(block.y);
+	if (selector < 2u)
+		return vec4(selector == 0u ? color0 : color1, 1.0);
+	if (fourColors || block.x > block.y)
+		return vec4(mix(color0, color1, selector == 2u ? 1.0 / 3.0 : 2.0 / 3.0), 1.0);
+	return selector == 2u ? vec4(mix(color0, color1, 0.5), 1.0) : vec4(0.0);
+}
+
+// Alpha of a BC3 alpha block, 3 bit selectors packed over the last three words
+float decodeAlpha(uvec4 block, uint index)
+{
+	uint bit = 3u * index;
+	uint word = bit / 16u;
+	uint shift = bit % 16u;
+	uint bits = block[1u + word] >> shift;
+	if (shift > 13u)
+		bits |= block[2u + word] << (16u - shift);
+	uint selector = bits & 7u;
+
+	uint alpha0 = block.x & 255u;
+	uint alpha1 = block.x >> 8;
+	if (selector < 2u)
+		return float(selector == 0u ? alpha0 : alpha1) / 255.0;
+	if (alpha0 > alpha1)
+		return mix(float(alpha0), float(alpha1), float(selector - 1u) / 7.0) / 255.0;
+	if (selector >= 6u)
+		return selector == 6u ? 0.0 : 1.0;
+	return mix(float(alpha0), float(alpha1), float(selector - 1u) / 5.0) / 255.0;
+}
+
+vec4 decodePixel(ivec2 pixel)
+{
+	pixel = clamp(pixel, ivec2(0), ivec2(ubo.size) - 1);
+	ivec2 block = pixel / 4;
+	uint index = uint((pixel.y % 4) * 4 + pixel.x % 4);
+	if (ubo.format == 0)
+		return decodeColor(fetchWords(block), index, false);
+
+	vec4 color = decodeColor(fetchWords(ivec2(block.x * 2 + 1, block.y)), index, true);
+	color.a = decodeAlpha(fetchWords(ivec2(block.x * 2, block.y)), index);
+	return color;
+}
+
+// Expands the blocks into the canvas output, filtered by hand because the block texture can't be filtered
+void main()
+{
+	vec2 position = pass_Uvs.xy * ubo.size - 0.5;
+	ivec2 base = ivec2(floor(position));
+	vec2 weight = position - vec2(base);
+	vec4 top = mix(decodePixel(base), decodePixel(base + ivec2(1, 0)), weight.x);
+	vec4 bottom = mix(decodePixel(base + ivec2(0, 1)), decodePixel(base + ivec2(1, 1)), weight.x);
+	out_Color = mix(top, bottom, weight.y);
+}
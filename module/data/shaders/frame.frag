@@ -0,0 +1,15 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at https://mozilla.org/MPL/2.0/.
+
+#version 450 core
+
+uniform sampler2D inTexture;
+in vec3 pass_Uvs;
+out vec4 out_Color;
+
+// Copies an RGBA frame into the canvas output, no color conversion
+void main() 
+{
+	out_Color = texture(inTexture, vec2(pass_Uvs.x, pass_Uvs.y));
+}
\ No newline at end of file
@@ -6,11 +6,37 @@
 
 uniform sampler2D inTexture;
 
+// Gamma corrected edge blend ramp, precomputed per output
+uniform sampler2D blendLut;
+
+uniform BLEND
+{
+	vec4 viewport;		// x, y, width and height of the output viewport in pixels
+	vec4 edges;			// left, right, bottom and top ramp width, relative to the viewport, 0 disables the edge
+} blend;
+
 in vec3 pass_Uvs;
 out vec4 out_Color;
 
+float ramp(float t)
+{
+	return texture(blendLut, vec2(clamp(t, 0.0, 1.0), 0.5)).r;
+}
+
 void main() 
 {
 	out_Color = texture(inTexture, vec2(pass_Uvs.x, pass_Uvs.y));
 
-}
\ No newline at end of file
+	// Viewport origin is top left
+	vec2 uv = (gl_FragCoord.xy - blend.viewport.xy) / blend.viewport.zw;
+	float weight = 1.0;
+	if (blend.edges.x > 0.0)
+		weight *= ramp(uv.x / blend.edges.x);
+	if (blend.edges.y > 0.0)
+		weight *= ramp((1.0 - uv.x) / blend.edges.y);
+	if (blend.edges.z > 0.0)
+		weight *= ramp((1.0 - uv.y) / blend.edges.z);
+	if (blend.edges.w > 0.0)
+		weight *= ramp(uv.y / blend.edges.w);
+	out_Color.rgb *= weight;
+}
@@ -0,0 +1,51 @@
+# Stock canvas shaders that are embedded into the napfoglio binary at build time
+set(FOGLIO_STOCK_SHADERS block canvasinterface frame mask warp)
+set(FOGLIO_STOCK_SHADER_DIR ${CMAKE_CURRENT_SOURCE_DIR}/data/shaders)
+set(FOGLIO_GENERATED_DIR ${CMAKE_CURRENT_BINARY_DIR}/generated)
+set(FOGLIO_EMBEDDED_SHADER_HEADER ${FOGLIO_GENERATED_DIR}/embeddedshaders.h)
+
+set(FOGLIO_STOCK_SHADER_FILES)
+foreach(shader ${FOGLIO_STOCK_SHADERS})
+    list(APPEND FOGLIO_STOCK_SHADER_FILES ${FOGLIO_STOCK_SHADER_DIR}/${shader}.vert ${FOGLIO_STOCK_SHADER_DIR}/${shader}.frag)
+endforeach()
+
+# Validate every stock shader with the Vulkan SDK front-end when it's available.
+# This is validation only: a syntax error in a stock shader fails the module build instead of the app at startup,
+# the SPIR-V output isn't embedded. NAP's Shader only loads GLSL, the embedded GLSL is still compiled at runtime.
+find_program(FOGLIO_GLSLANG_VALIDATOR glslangValidator
+    HINTS ${NAP_ROOT}/system_modules/naprender/thirdparty/vulkansdk/${NAP_THIRDPARTY_PLATFORM_DIR}/${ARCH}/bin
+    NO_CMAKE_FIND_ROOT_PATH)
+set(FOGLIO_SPIRV_COMMANDS)
+if(FOGLIO_GLSLANG_VALIDATOR)
+    foreach(shader_file ${FOGLIO_STOCK_SHADER_FILES})
+        get_filename_component(shader_file_name ${shader_file} NAME)
+        list(APPEND FOGLIO_SPIRV_COMMANDS
+            COMMAND ${FOGLIO_GLSLANG_VALIDATOR} -V --auto-map-bindings --auto-map-locations
+                    -o ${FOGLIO_GENERATED_DIR}/${shader_file_name}.spv ${shader_file})
+    endforeach()
+else()
+    message(STATUS "napfoglio: glslangValidator not found, stock shaders are embedded without SPIR-V validation")
+endif()
+
+add_custom_command(
+    OUTPUT ${FOGLIO_EMBEDDED_SHADER_HEADER}
+    COMMAND ${CMAKE_COMMAND} -E make_directory ${FOGLIO_GENERATED_DIR}
+    ${FOGLIO_SPIRV_COMMANDS}
+    COMMAND ${CMAKE_COMMAND}
+        -DSHADER_DIR=${FOGLIO_STOCK_SHADER_DIR}
+        "-DSHADERS=${FOGLIO_STOCK_SHADERS}"
+        -DOUTPUT=${FOGLIO_EMBEDDED_SHADER_HEADER}
+        -P ${CMAKE_CURRENT_SOURCE_DIR}/cmake/embedshaders.cmake
+    DEPENDS ${FOGLIO_STOCK_SHADER_FILES} ${CMAKE_CURRENT_SOURCE_DIR}/cmake/embedshaders.cmake
+    COMMENT "napfoglio: embedding stock shaders"
+    VERBATIM)
+
+target_sources(${PROJECT_NAME} PRIVATE ${FOGLIO_EMBEDDED_SHADER_HEADER})
+target_include_directories(${PROJECT_NAME} PRIVATE ${FOGLIO_GENERATED_DIR})
+target_compile_definitions(${PROJECT_NAME} PRIVATE FOGLIO_EMBEDDED_SHADERS)
+
+# CPU trace zones, FOGLIO_TRACE_ZONE compiles to nothing when disabled
+option(FOGLIO_TRACING "Record CPU trace zones that can be written as Chrome trace JSON" ON)
+if(FOGLIO_TRACING)
+    target_compile_definitions(${PROJECT_NAME} PUBLIC FOGLIO_TRACING)
+endif()
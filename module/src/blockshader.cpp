@@ -0,0 +1,24 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+ // Local includes
+#include "blockshader.h"
+
+// External includes
+#include <nap/core.h>
+
+// nap::BlockShader run time class definition
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::BlockShader)
+RTTI_CONSTRUCTOR(nap::Core&)
+RTTI_END_CLASS
+
+
+//////////////////////////////////////////////////////////////////////////
+// BlockShader
+//////////////////////////////////////////////////////////////////////////
+
+namespace nap
+{
+	BlockShader::BlockShader(Core& core) : StockShader(core, shader::block) { }
+}
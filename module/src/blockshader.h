@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+ // Local Includes
+#include "stockshader.h"
+
+namespace nap
+{
+	// block shader uniform and sampler names
+	namespace uniform
+	{
+		namespace block
+		{
+			namespace sampler
+			{
+				inline constexpr const char* inTexture = "inTexture";		///< block shader input sampler name, the RGBA16 block texture
+			}
+			inline constexpr const char* uboStruct = "UBO";				///< block shader uniform struct name
+			inline constexpr const char* size = "size";					///< frame size in pixels
+			inline constexpr const char* format = "format";				///< 0 for BC1, 1 for BC3
+		}
+	}
+
+	/**
+		shader that expands the BC1 or BC3 blocks of a frame into the canvas output
+	 */
+	class NAPAPI BlockShader : public StockShader
+	{
+		RTTI_ENABLE(StockShader)
+	public:
+		BlockShader(Core& core);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+// Local Includes
+#include "canvascommandrecorder.h"
+#include "tracer.h"
+
+// External Includes
+#include <mesh.h>
+#include <nap/logger.h>
+#include <utility/stringutils.h>
+#include <algorithm>
+
+namespace nap
+{
+	CanvasCommandRecorder::CanvasCommandRecorder(RenderService& renderService) :
+		mRenderService(renderService)
+	{ }
+
+
+	CanvasCommandRecorder::~CanvasCommandRecorder()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+		}
+		mStartCondition.notify_all();
+		for (auto& thread : mThreads)
+			thread.join();
+
+		// Destroying a pool frees its command buffers
+		std::vector<VkCommandPool> pools;
+		for (auto& worker : mWorkers)
+			pools.insert(pools.end(), worker.mPools.begin(), worker.mPools.end());
+		mRenderService.queueVulkanObjectDestructor([pools](RenderService& renderService)
+		{
+			for (VkCommandPool pool : pools)
+				vkDestroyCommandPool(renderService.getDevice(), pool, nullptr);
+		});
+	}
+
+
+	bool CanvasCommandRecorder::init(int threadCount, utility::ErrorState& errorState)
+	{
+		if (threadCount <= 0)
+			threadCount = std::max<int>(std::thread::hardware_concurrency(), 1);
+
+		mWorkers.resize(threadCount);
+		int frames_in_flight = mRenderService.getMaxFramesInFlight();
+		for (auto& worker : mWorkers)
+		{
+			worker.mPools.resize(frames_in_flight, VK_NULL_HANDLE);
+			worker.mCommandBuffers.resize(frames_in_flight);
+			for (auto& pool : worker.mPools)
+			{
+				VkCommandPoolCreateInfo pool_info = {};
+				pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				pool_info.queueFamilyIndex = mRenderService.getQueueIndex();
+				pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+				if (!errorState.check(vkCreateCommandPool(mRenderService.getDevice(), &pool_info, nullptr, &pool) == VK_SUCCESS, "Failed to create canvas recording command pool"))
+					return false;
+			}
+		}
+
+		// The calling thread records as worker 0
+		for (int i = 1; i < threadCount; i++)
+			mThreads.emplace_back(&CanvasCommandRecorder::threadLoop, this, i);
+		return true;
+	}
+
+
+	void CanvasCommandRecorder::record(std::vector<Packet>& packets, bool parallel)
+	{
+		if (packets.empty())
+			return;
+
+		// The frame fence has been waited on in beginFrame(), the pools of this frame are no longer in use
+		mFrameIndex = mRenderService.getCurrentFrameIndex();
+		for (auto& worker : mWorkers)
+		{
+			vkResetCommandPool(mRenderService.getDevice(), worker.mPools[mFrameIndex], 0);
+			worker.mUsed = 0;
+		}
+
+		mPackets = &packets;
+		mNextPacket = 0;
+		if (!parallel)
+		{
+			recordPackets(0);
+			mPackets = nullptr;
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mBusyWorkers = static_cast<int>(mThreads.size());
+			mGeneration++;
+		}
+		mStartCondition.notify_all();
+
+		recordPackets(0);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDoneCondition.wait(lock, [this]() { return mBusyWorkers == 0; });
+		mPackets = nullptr;
+	}
+
+
+	void CanvasCommandRecorder::execute(const std::vector<Packet>& packets)
+	{
+		VkCommandBuffer primary = mRenderService.getCurrentCommandBuffer();
+		for (const auto& packet : packets)
+		{
+			if (packet.mCommandBuffer == VK_NULL_HANDLE)
+			{
+				if (!mFailureReported)
+				{
+					nap::Logger::warn("Unable to record canvas pass into a secondary command buffer, recording inline");
+					mFailureReported = true;
+				}
+				packet.mTarget->beginRendering(VK_SUBPASS_CONTENTS_INLINE, packet.mClear);
+				recordDraw(primary, packet);
+				packet.mTarget->endRendering();
+				continue;
+			}
+			packet.mTarget->beginRendering(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, packet.mClear);
+			vkCmdExecuteCommands(primary, 1, &packet.mCommandBuffer);
+			packet.mTarget->endRendering();
+		}
+	}
+
+
+	void CanvasCommandRecorder::recordDraw(VkCommandBuffer commandBuffer, const Packet& packet)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.mPipeline.mPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.mPipeline.mLayout, 0, 1, &packet.mDescriptorSet, 0, nullptr);
+
+		// Bind buffers and draw
+		const std::vector<VkBuffer>& vertex_buffers = packet.mMesh->getVertexBuffers();
+		const std::vector<VkDeviceSize>& vertex_buffer_offsets = packet.mMesh->getVertexBufferOffsets();
+		vkCmdBindVertexBuffers(commandBuffer, 0, vertex_buffers.size(), vertex_buffers.data(), vertex_buffer_offsets.data());
+
+		MeshInstance& mesh_instance = packet.mMesh->getMesh().getMeshInstance();
+		GPUMesh& mesh = mesh_instance.getGPUMesh();
+		for (int index = 0; index < mesh_instance.getNumShapes(); ++index)
+		{
+			const IndexBuffer& index_buffer = mesh.getIndexBuffer(index);
+			vkCmdBindIndexBuffer(commandBuffer, index_buffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexed(commandBuffer, index_buffer.getCount(), 1, 0, 0, 0);
+		}
+	}
+
+
+	void CanvasCommandRecorder::threadLoop(int workerIndex)
+	{
+		FOGLIO_TRACE_THREAD(utility::stringFormat("recorder %d", workerIndex));
+		uint64 generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mStartCondition.wait(lock, [this, generation]() { return mStop || mGeneration != generation; });
+				if (mStop)
+					return;
+				generation = mGeneration;
+			}
+
+			recordPackets(workerIndex);
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mBusyWorkers--;
+			}
+			mDoneCondition.notify_one();
+		}
+	}
+
+
+	void CanvasCommandRecorder::recordPackets(int workerIndex)
+	{
+		FOGLIO_TRACE_ZONE("CanvasCommandRecorder::recordPackets");
+		Worker& worker = mWorkers[workerIndex];
+		std::vector<Packet>& packets = *mPackets;
+		for (size_t index = mNextPacket++; index < packets.size(); index = mNextPacket++)
+		{
+			Packet& packet = packets[index];
+			packet.mCommandBuffer = acquireCommandBuffer(worker);
+			if (packet.mCommandBuffer == VK_NULL_HANDLE)
+				continue;
+
+			VkCommandBufferInheritanceInfo inheritance_info = {};
+			inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritance_info.renderPass = packet.mTarget->getRenderPass();
+			inheritance_info.subpass = 0;
+			inheritance_info.framebuffer = packet.mTarget->getFramebuffer();
+
+			VkCommandBufferBeginInfo begin_info = {};
+			begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			begin_info.pInheritanceInfo = &inheritance_info;
+
+			// A packet without secondary is recorded inline by execute()
+			if (vkBeginCommandBuffer(packet.mCommandBuffer, &begin_info) != VK_SUCCESS)
+			{
+				packet.mCommandBuffer = VK_NULL_HANDLE;
+				continue;
+			}
+			packet.mTarget->setViewport(packet.mCommandBuffer);
+			recordDraw(packet.mCommandBuffer, packet);
+			if (vkEndCommandBuffer(packet.mCommandBuffer) != VK_SUCCESS)
+				packet.mCommandBuffer = VK_NULL_HANDLE;
+		}
+	}
+
+
+	VkCommandBuffer CanvasCommandRecorder::acquireCommandBuffer(Worker& worker)
+	{
+		std::vector<VkCommandBuffer>& buffers = worker.mCommandBuffers[mFrameIndex];
+		if (worker.mUsed == buffers.size())
+		{
+			VkCommandBufferAllocateInfo alloc_info = {};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.commandPool = worker.mPools[mFrameIndex];
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			alloc_info.commandBufferCount = 1;
+
+			VkCommandBuffer buffer = VK_NULL_HANDLE;
+			if (vkAllocateCommandBuffers(mRenderService.getDevice(), &alloc_info, &buffer) != VK_SUCCESS)
+				return VK_NULL_HANDLE;
+			buffers.emplace_back(buffer);
+		}
+		return buffers[worker.mUsed++];
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// Local Includes
+#include "canvasrendertarget.h"
+
+// External Includes
+#include <renderservice.h>
+#include <renderablemesh.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nap
+{
+	/**
+	 * Records the headless canvas passes into secondary command buffers on a group of worker threads.
+	 * Every worker owns a command pool per frame in flight, pools are never shared between threads.
+	 * Descriptor sets and pipelines are acquired up front on the main thread (see RenderCanvasComponentInstance::prepareHeadlessPasses),
+	 * the workers only record, after which the secondaries are executed in canvas order from the headless command buffer.
+	 */
+	class NAPAPI CanvasCommandRecorder
+	{
+	public:
+		/**
+		 * A single draw into a canvas target, everything required to record it without touching shared render state.
+		 */
+		struct Packet
+		{
+			CanvasRenderTarget*		mTarget = nullptr;
+			RenderService::Pipeline	mPipeline;
+			VkDescriptorSet			mDescriptorSet = VK_NULL_HANDLE;
+			const RenderableMesh*	mMesh = nullptr;
+			bool					mClear = true;						///< If the target is cleared before the pass draws
+			VkCommandBuffer			mCommandBuffer = VK_NULL_HANDLE;	///< Secondary command buffer the packet is recorded into, null when recording failed
+		};
+
+		CanvasCommandRecorder(RenderService& renderService);
+		~CanvasCommandRecorder();
+
+		/**
+		 * Creates the command pools and starts the worker threads.
+		 * @param threadCount number of threads that record, including the calling thread. 0 uses all cores
+		 * @param errorState contains the error if the command pools can't be created
+		 * @return if the recorder initialized
+		 */
+		bool init(int threadCount, utility::ErrorState& errorState);
+
+		/**
+		 * Records every packet into its own secondary command buffer, blocks until all packets are recorded.
+		 * Must be called between beginHeadlessRecording() and endHeadlessRecording().
+		 * Every call reuses the secondaries of this frame, only the packets of the last call can be executed.
+		 * @param packets the packets to record, mCommandBuffer is assigned
+		 * @param parallel if the worker threads record as well, false records on the calling thread only
+		 */
+		void record(std::vector<Packet>& packets, bool parallel = true);
+
+		/**
+		 * Executes the recorded secondaries, in order, from the current (headless) command buffer.
+		 * Packets that failed to record into a secondary are recorded inline instead.
+		 * @param packets the packets recorded by record()
+		 */
+		void execute(const std::vector<Packet>& packets);
+
+		/**
+		 * Records the draw call of a packet, shared with the inline path.
+		 * @param commandBuffer command buffer to record into
+		 * @param packet the draw to record
+		 */
+		static void recordDraw(VkCommandBuffer commandBuffer, const Packet& packet);
+
+		/**
+		 * @return number of threads that record, including the calling thread
+		 */
+		int getThreadCount() const														{ return static_cast<int>(mWorkers.size()); }
+
+	private:
+		struct Worker
+		{
+			std::vector<VkCommandPool>					mPools;				///< One pool per frame in flight
+			std::vector<std::vector<VkCommandBuffer>>	mCommandBuffers;	///< Secondaries allocated from each pool
+			size_t										mUsed = 0;			///< Secondaries handed out this frame
+		};
+
+		RenderService&				mRenderService;
+		std::vector<Worker>			mWorkers;
+		std::vector<std::thread>	mThreads;
+
+		std::mutex					mMutex;
+		std::condition_variable		mStartCondition;
+		std::condition_variable		mDoneCondition;
+		uint64						mGeneration = 0;
+		int							mBusyWorkers = 0;
+		bool						mStop = false;
+
+		std::vector<Packet>*		mPackets = nullptr;
+		std::atomic<size_t>			mNextPacket = { 0 };
+		int							mFrameIndex = 0;
+		bool						mFailureReported = false;		///< If the fallback to inline recording has been logged
+
+		void threadLoop(int workerIndex);
+		void recordPackets(int workerIndex);
+		VkCommandBuffer acquireCommandBuffer(Worker& worker);
+	};
+}
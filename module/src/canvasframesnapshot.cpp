@@ -0,0 +1,19 @@
+// Local Includes
+#include "canvasframesnapshot.h"
+
+namespace nap
+{
+	void CanvasSnapshotBuffer::publish()
+	{
+		// Release makes the captured state visible to the reader that takes the index
+		mWrite = mShared.exchange(mWrite | newFlag, std::memory_order_acq_rel) & ~newFlag;
+	}
+
+
+	const CanvasFrameSnapshot& CanvasSnapshotBuffer::acquire()
+	{
+		if ((mShared.load(std::memory_order_relaxed) & newFlag) != 0)
+			mRead = mShared.exchange(mRead, std::memory_order_acq_rel) & ~newFlag;
+		return mSnapshots[mRead];
+	}
+}
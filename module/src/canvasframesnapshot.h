@@ -0,0 +1,71 @@
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <atomic>
+#include <vector>
+
+namespace nap
+{
+	// Forward declares
+	class RenderCanvasComponentInstance;
+
+	/**
+	 * Immutable state of the canvases for one frame, as the outputs draw it: the draw list of every output with
+	 * the layout and warp of every canvas. Captured by the canvas group at the end of its update, edits made after that,
+	 * e.g. by the GUI, show from the next snapshot on. The canvases themselves provide the textures and pipelines.
+	 */
+	struct CanvasFrameSnapshot
+	{
+		// A canvas and the layout it is drawn with
+		struct Draw
+		{
+			RenderCanvasComponentInstance*	mCanvas = nullptr;
+			glm::mat4						mModelMatrix;
+			std::array<glm::vec2, 4>		mCornerOffsets;
+		};
+
+		uint64								mFrame = 0;			///< Frame the snapshot was captured on, 0 when it holds no frame yet
+		glm::ivec2							mVirtualSize;		///< Size of the virtual canvas space
+		std::vector<std::vector<Draw>>		mOutputs;			///< Per output, the canvases that intersect it, in draw order
+		std::vector<Draw>					mComposition;		///< Canvases of the composition of the entire virtual canvas space
+	};
+
+
+	/**
+	 * Three frame snapshots handed from the thread that captures them to the thread that draws them, the latest one wins.
+	 * Neither side blocks or allocates once the snapshots reached their size: the writer fills its own snapshot and publishes it,
+	 * the reader swaps in the latest published snapshot when there is a new one. A snapshot that is never drawn is overwritten.
+	 */
+	class NAPAPI CanvasSnapshotBuffer
+	{
+	public:
+		/**
+		 * Writer only.
+		 * @return the snapshot to capture into, the reader never sees it until it is published
+		 */
+		CanvasFrameSnapshot& getWriteSnapshot()						{ return mSnapshots[mWrite]; }
+
+		/**
+		 * Writer only. Publishes the write snapshot, the writer continues with another one.
+		 */
+		void publish();
+
+		/**
+		 * Reader only. Swaps in the latest published snapshot, if there is a newer one.
+		 * The snapshot stays valid and unchanged until the next acquire().
+		 * @return the latest published snapshot
+		 */
+		const CanvasFrameSnapshot& acquire();
+
+	private:
+		static constexpr int newFlag = 4;							///< Set on the shared index when it holds a snapshot the reader hasn't seen
+
+		std::array<CanvasFrameSnapshot, 3>	mSnapshots;
+		int									mWrite = 0;
+		int									mRead = 1;
+		std::atomic<int>					mShared = { 2 };
+	};
+}
@@ -2,18 +2,31 @@
 #include "canvasgroupcomponent.h"
 #include "rendercanvascomponent.h"
 #include "inputcomponent.h"
+#include "tracer.h"
 
 #include <sequencecanvascomponent.h>
 #include <entity.h>
 #include <nap/core.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 #include <imgui/imgui.h>
 #include <imguiutils.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <unordered_set>
 
 // nap::rendercanvascomponent run time class definition
 RTTI_BEGIN_CLASS(nap::CanvasGroupComponent)
 	RTTI_PROPERTY("SequencePlayerEditor", &nap::CanvasGroupComponent::mSequencePlayerEditor, nap::rtti::EPropertyMetaData::Required)
 	RTTI_PROPERTY("SequencePlayerEditorGUI", &nap::CanvasGroupComponent::mSequencePlayerEditorGUI, nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("RecordingThreads", &nap::CanvasGroupComponent::mRecordingThreads, nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Outputs", &nap::CanvasGroupComponent::mOutputs, nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("VirtualSize", &nap::CanvasGroupComponent::mVirtualSize, nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("MemoryBudget", &nap::CanvasGroupComponent::mMemoryBudget, nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("RefuseOverBudget", &nap::CanvasGroupComponent::mRefuseOverBudget, nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("KeyframeInterval", &nap::CanvasGroupComponent::mKeyframeInterval, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::CanvasGroupComponentInstance)
@@ -36,9 +49,87 @@ namespace nap
 		// Get resource
 		CanvasGroupComponent* resource = getComponent<CanvasGroupComponent>();
 		
-		mSelected = getEntityInstance()->getChildren()[0];
-		if (!initSelectedRenderTarget()) {
+		std::vector<std::string> canvas_ids;
+		for (EntityInstance* canvas_entity : getEntityInstance()->getChildren())
+		{
+			RenderCanvasComponentInstance& canvas = canvas_entity->getComponent<RenderCanvasComponentInstance>();
+			canvas_ids.emplace_back(canvas_entity->mID);
+			mCanvases.emplace_back(&canvas);
+			SequenceCanvasComponentInstance* sequence_comp = canvas_entity->findComponent<SequenceCanvasComponentInstance>();
+			if (sequence_comp == nullptr)
+				continue;
+			mSequenceCanvases.emplace_back(sequence_comp);
+			const auto& bindings = sequence_comp->getComponent<SequenceCanvasComponent>()->mCurveBindings;
+			if (!errorState.check(mCurveBindings.addCanvas(*sequence_comp->getSequencePlayer(), bindings, canvas, errorState), "%s: unable to bind sequence curves", canvas_entity->mID.c_str()))
+				return false;
+		}
+		mRenderService = getEntityInstance()->getCore()->getService<RenderService>();
+		FoglioService* foglio_service = getEntityInstance()->getCore()->getService<FoglioService>();
+		Metrics& metrics = foglio_service->getMetrics();
+		mHeadlessPassCounter = &metrics.getCounter("foglio_headless_passes_total", "Headless canvas passes recorded");
+		mDeferredCanvasCounter = &metrics.getCounter("foglio_canvases_deferred_total", "Active canvases whose headless passes waited for their turn in the update schedule");
+		mCanvasGauge = &metrics.getGauge("foglio_canvases", "Canvases in the scene");
+		mCulledCanvasGauge = &metrics.getGauge("foglio_canvases_culled", "Canvases whose headless passes were skipped in the last frame");
+
+		// Outputs
+		mOutputs = resource->mOutputs;
+		mVirtualSize = resource->mVirtualSize;
+		if (!errorState.check(!mOutputs.empty(), "%s: no outputs", resource->mID.c_str()))
+			return false;
+		if (!errorState.check(mVirtualSize.x > 0 && mVirtualSize.y > 0, "%s: invalid virtual size", resource->mID.c_str()))
 			return false;
+
+		// Canvases register as they init, in init order. Reloaded canvases take over the slot of their previous instance,
+		// canvases that were removed from the scene keep theirs until they are destroyed: the group restores its draw order.
+		mCanvasRegistry = &foglio_service->getCanvasRegistry();
+		VideoService* video_service = getEntityInstance()->getCore()->getService<VideoService>();
+		mCanvasRegistry->sort(canvas_ids);
+		mCanvasSlots.resize(mCanvases.size(), -1);
+		updateCanvasSlots();
+		mVisibleCanvases.resize(mOutputs.size());
+		for (auto& visible : mVisibleCanvases)
+			visible.reserve(mCanvases.size());
+		mActiveCanvases.reserve(mCanvases.size());
+		mScheduledCanvases.reserve(mCanvases.size());
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			RenderCanvasComponentInstance* canvas = mCanvases[i];
+			int slot = mCanvasSlots[i];
+			if (!errorState.check(slot >= 0, "%s: canvas %s isn't registered", resource->mID.c_str(), canvas_ids[i].c_str()))
+				return false;
+			VideoPlayer* player = canvas->getVideoPlayer();
+			if (player != nullptr && mVideoLadders.find(player) == mVideoLadders.end())
+				mVideoLadders.emplace(player, std::make_unique<VideoLadder>(*video_service, *player, resource->mKeyframeInterval));
+			canvas->updateLayout(mVirtualSize, mCanvasRegistry->getModelMatrices()[slot], mCanvasRegistry->getBounds()[slot], mCanvasRegistry->getOccluderBounds()[slot]);
+			canvas->setEdgeBlend(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f), mOutputs[0]->getBlendLut());
+		}
+
+		if (resource->mRecordingThreads != 1)
+		{
+			mRecorder = std::make_unique<CanvasCommandRecorder>(*mRenderService);
+			if (!errorState.check(mRecorder->init(resource->mRecordingThreads, errorState), "%s: unable to init canvas command recorder", resource->mID.c_str()))
+				return false;
+		}
+
+		if (!getEntityInstance()->getChildren().empty())
+		{
+			select(getEntityInstance()->getChildren()[0]);
+			if (!initSelectedRenderTarget(errorState))
+				return false;
+		}
+
+		// Check the scene against the memory budget once every canvas texture exists
+		mMemoryBudget = resource->mMemoryBudget;
+		if (mMemoryBudget > 0.0f)
+		{
+			std::vector<std::vector<GpuMemoryEntry>> entries;
+			double total = static_cast<double>(getGpuMemory(entries)) / (1024.0 * 1024.0);
+			if (total > mMemoryBudget)
+			{
+				if (!errorState.check(!resource->mRefuseOverBudget, "%s: canvases require %.1fMB of GPU memory, budget is %.1fMB", resource->mID.c_str(), total, mMemoryBudget))
+					return false;
+				nap::Logger::warn("%s: canvases require %.1fMB of GPU memory, budget is %.1fMB", resource->mID.c_str(), total, mMemoryBudget);
+			}
 		}
 		mSequenceEditor = resource->mSequencePlayerEditor.get();
 		if (!errorState.check(mSequenceEditor->init(errorState), "%s: unable to init sequence editor", resource->mID.c_str()))
@@ -47,55 +138,443 @@ namespace nap
 		if (!errorState.check(mSequenceEditorGUI->init(errorState), "%s: unable to init sequence editor GUI", resource->mID.c_str()))
 			return false;
 		//setSequencePlayer();
+		return true;
+	}
+
+	void CanvasGroupComponentInstance::update(double deltaTime)
+	{
+		// The frame that is prepared now is displayed after the frames in flight
+		FOGLIO_TRACE_ZONE("CanvasGroup::update");
+		double display_latency = deltaTime * mRenderService->getMaxFramesInFlight();
+		// Pointer moves are coalesced, the corners are moved once per frame
+		mDragStats.mUpdates = 0;
+		mDragStats.mEvents = 0;
+		if (mDragStressTest)
+			feedDragStressEvents(deltaTime);
+		applyCornerDrag();
+
+		mFrameTimes[mFrameTimeIndex] = deltaTime;
+		mFrameTimeIndex = (mFrameTimeIndex + 1) % mFrameTimes.size();
+		mFrameInterval += (std::min(deltaTime, 0.25) - mFrameInterval) * 0.05;
+		if (mCycleMasks && mSelectedCanvas != nullptr)
+		{
+			// Stress test of runtime mask changes, the frame time should stay flat while masks decode
+			if (mSelectedCanvas->getMaskCount() > 0)
+				mSelectedCanvas->selectMask((mSelectedCanvas->getMaskIndex() + 1) % mSelectedCanvas->getMaskCount());
+		}
+		for (SequenceCanvasComponentInstance* sequence_canvas : mSequenceCanvases)
+			sequence_canvas->applyCues(display_latency);
+
+		// Curves change through the editor, undo or a sequence load, re-sample the bound curves that changed since the last frame
+		mCurveBindings.bakeChanged();
+		mCurveBindings.evaluate();
+
+		// Lay out and cull once per frame, into and from the registry arrays, outputs only draw the canvases they intersect
+		updateCanvasSlots();
+		std::vector<glm::mat4>& matrices = mCanvasRegistry->getModelMatrices();
+		std::vector<glm::vec4>& bounds = mCanvasRegistry->getBounds();
+		std::vector<glm::vec4>& occluder_bounds = mCanvasRegistry->getOccluderBounds();
+		std::vector<uint8>& flags = mCanvasRegistry->getFlags();
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			int slot = mCanvasSlots[i];
+			if (slot < 0)
+				continue;
+			mCanvases[i]->updateLayout(mVirtualSize, matrices[slot], bounds[slot], occluder_bounds[slot]);
+			flags[slot] = static_cast<uint8>(mCanvases[i]->isVisible() ? flags[slot] | CanvasRegistry::flagVisible : flags[slot] & ~CanvasRegistry::flagVisible);
+		}
+		cullCanvases();
+		mCanvasGauge->set(mCanvases.size());
+		mCulledCanvasGauge->set(mCullStats.getTotal());
+		for (int i = 0; i < mOutputs.size(); i++)
+		{
+			mVisibleCanvases[i].clear();
+			for (int index : mActiveCanvases)
+			{
+				if (mOutputs[i]->intersects(bounds[mCanvasSlots[index]], mVirtualSize))
+					mVisibleCanvases[i].emplace_back(index);
+			}
+		}
+
+		// Videos are decoded at the smallest rendition that covers the lines they occupy on the outputs,
+		// canvases that don't show on any output request nothing and play the smallest rendition
+		for (int i = 0; i < mOutputs.size(); i++)
+		{
+			glm::vec4 region = mOutputs[i]->getRegionBounds(mVirtualSize);
+			float scale = mOutputs[i]->getViewport().height / std::max(region.w - region.y, 1.0f);
+			for (int index : mVisibleCanvases[i])
+			{
+				const glm::vec4& canvas_bounds = bounds[mCanvasSlots[index]];
+				requestVideoLines(*mCanvases[index], (canvas_bounds.w - canvas_bounds.y) * scale);
+			}
+		}
+		if (mDrawComposition)
+		{
+			for (int index : mActiveCanvases)
+			{
+				const glm::vec4& canvas_bounds = bounds[mCanvasSlots[index]];
+				requestVideoLines(*mCanvases[index], canvas_bounds.w - canvas_bounds.y);
+			}
+		}
+		for (auto& ladder : mVideoLadders)
+		{
+			if (!ladder.second->update(deltaTime))
+				continue;
+			for (RenderCanvasComponentInstance* canvas : mCanvases)
+			{
+				if (canvas->getVideoPlayer() == ladder.first)
+					canvas->setVideoSource(ladder.second->getActivePlayer());
+			}
+		}
+		mSnapshotCaptured = mDrawFromSnapshot;
+		if (mSnapshotCaptured)
+			captureSnapshot();
+	}
+
+
+	void CanvasGroupComponentInstance::captureSnapshot()
+	{
+		// The draw lists keep their capacity, capturing doesn't allocate once every list reached its size
+		FOGLIO_TRACE_ZONE("CanvasGroup::captureSnapshot");
+		CanvasFrameSnapshot& snapshot = mSnapshots.getWriteSnapshot();
+		const std::vector<glm::mat4>& matrices = mCanvasRegistry->getModelMatrices();
+		auto capture = [&](const std::vector<int>& indices, std::vector<CanvasFrameSnapshot::Draw>& outDraws)
+		{
+			outDraws.resize(indices.size());
+			for (int i = 0; i < indices.size(); i++)
+			{
+				RenderCanvasComponentInstance* canvas = mCanvases[indices[i]];
+				const std::vector<glm::vec2>& offsets = canvas->getCornerOffsets();
+				outDraws[i].mCanvas = canvas;
+				outDraws[i].mModelMatrix = matrices[mCanvasSlots[indices[i]]];
+				std::copy(offsets.begin(), offsets.end(), outDraws[i].mCornerOffsets.begin());
+			}
+		};
+
+		snapshot.mFrame = ++mSnapshotCount;
+		snapshot.mVirtualSize = mVirtualSize;
+		snapshot.mOutputs.resize(mOutputs.size());
+		for (int i = 0; i < mOutputs.size(); i++)
+			capture(mVisibleCanvases[i], snapshot.mOutputs[i]);
+		capture(mActiveCanvases, snapshot.mComposition);
+		mSnapshots.publish();
+	}
+
+
+	void CanvasGroupComponentInstance::requestVideoLines(RenderCanvasComponentInstance& canvas, float lines)
+	{
+		// The video is resampled into the canvas output, lines beyond its height are never seen
+		if (canvas.getVideoPlayer() == nullptr)
+			return;
+		int height = std::min(static_cast<int>(std::ceil(lines)), canvas.getOutputTexture()->getHeight());
+		mVideoLadders[canvas.getVideoPlayer()]->request(height);
+	}
+
+
+	void CanvasGroupComponentInstance::cullCanvases()
+	{
+		// Culled canvases skip their headless passes only, video players keep decoding so a canvas reappears instantly
+		mCullStats = CullStats();
+		mActiveCanvases.clear();
+		const std::vector<glm::vec4>& bounds = mCanvasRegistry->getBounds();
+		const std::vector<uint8>& flags = mCanvasRegistry->getFlags();
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			int slot = mCanvasSlots[i];
+			if (slot < 0)
+				continue;
+
+			// The selected canvas is previewed, published canvases are consumed elsewhere
+			if (mCanvases[i] == mSelectedCanvas || (flags[slot] & CanvasRegistry::flagPublished) != 0)
+			{
+				mActiveCanvases.emplace_back(i);
+				continue;
+			}
+
+			if ((flags[slot] & CanvasRegistry::flagVisible) == 0 || bounds[slot].z <= bounds[slot].x || bounds[slot].w <= bounds[slot].y)
+			{
+				mCullStats.mHidden++;
+				continue;
+			}
+
+			// The backdrop of the control window shows every canvas in full
+			if (!mDrawBackdrop)
+			{
+				if (!isOnScreen(bounds[slot]))
+				{
+					mCullStats.mOffscreen++;
+					continue;
+				}
+				if (isOccluded(i))
+				{
+					mCullStats.mOccluded++;
+					continue;
+				}
+			}
+			mActiveCanvases.emplace_back(i);
+		}
+	}
+
+
+	bool CanvasGroupComponentInstance::isOnScreen(const glm::vec4& bounds) const
+	{
+		if (mDrawComposition)
+			return bounds.x < mVirtualSize.x && bounds.z > 0.0f && bounds.y < mVirtualSize.y && bounds.w > 0.0f;
+		for (const auto& output : mOutputs)
+		{
+			if (output->intersects(bounds, mVirtualSize))
+				return true;
+		}
+		return false;
+	}
+
+
+	bool CanvasGroupComponentInstance::isOccluded(int index) const
+	{
+		// Canvases are drawn in order, only the ones after this canvas cover it
+		constexpr uint8 occluderFlags = CanvasRegistry::flagOpaque | CanvasRegistry::flagVisible;
+		const std::vector<uint8>& flags = mCanvasRegistry->getFlags();
+		const glm::vec4& bounds = mCanvasRegistry->getBounds()[mCanvasSlots[index]];
+		for (int i = index + 1; i < mCanvases.size(); i++)
+		{
+			int slot = mCanvasSlots[i];
+			if (slot < 0 || (flags[slot] & occluderFlags) != occluderFlags)
+				continue;
+			const glm::vec4& occluder_bounds = mCanvasRegistry->getOccluderBounds()[slot];
+			if (occluder_bounds.x <= bounds.x && occluder_bounds.y <= bounds.y && occluder_bounds.z >= bounds.z && occluder_bounds.w >= bounds.w)
+				return true;
+		}
+		return false;
+	}
+
+	void CanvasGroupComponentInstance::drawOutput(int index, const OrthoCameraComponentInstance& camera)
+	{
+		CanvasOutput& output = *mOutputs[index];
+		VkViewport viewport = output.getViewport();
+		VkRect2D scissor = { { static_cast<int32_t>(viewport.x), static_cast<int32_t>(viewport.y) }, { static_cast<uint32_t>(viewport.width), static_cast<uint32_t>(viewport.height) } };
+		VkCommandBuffer command_buffer = mRenderService->getCurrentCommandBuffer();
+		vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+		vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+		// Outputs are fixed for the lifetime of the group, a snapshot captured by this group has a draw list for every output
+		if (mSnapshotCaptured)
+		{
+			const CanvasFrameSnapshot& snapshot = mSnapshots.acquire();
+			drawCanvases(*output.mWindow, snapshot.mOutputs[index], output.getRegionBounds(snapshot.mVirtualSize), mOutputs[index].get(), camera);
+		}
+		else
+			drawCanvases(*output.mWindow, mVisibleCanvases[index], output.getRegionBounds(mVirtualSize), mOutputs[index].get(), camera);
+	}
+
+	void CanvasGroupComponentInstance::drawComposition(IRenderTarget& target, const OrthoCameraComponentInstance& camera)
+	{
+		if (mSnapshotCaptured)
+		{
+			const CanvasFrameSnapshot& snapshot = mSnapshots.acquire();
+			drawCanvases(target, snapshot.mComposition, glm::vec4(0.0f, 0.0f, snapshot.mVirtualSize.x, snapshot.mVirtualSize.y), nullptr, camera);
+		}
+		else
+			drawCanvases(target, mActiveCanvases, glm::vec4(0.0f, 0.0f, mVirtualSize.x, mVirtualSize.y), nullptr, camera);
+	}
+
+	void CanvasGroupComponentInstance::drawCanvases(IRenderTarget& target, const std::vector<int>& indices, const glm::vec4& region, CanvasOutput* output, const OrthoCameraComponentInstance& camera)
+	{
+		// Edge blending is part of the warp pass, the composition of the entire virtual canvas space isn't blended
+		glm::vec4 blend_edges = output != nullptr ? output->mBlendEdges : glm::vec4(0.0f);
+		VkViewport viewport = output != nullptr ? output->getViewport() : VkViewport{ 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+		glm::vec4 blend_viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+		Texture2D& blend_lut = output != nullptr ? output->getBlendLut() : mOutputs[0]->getBlendLut();
+
+		const OrthoCameraProperties& properties = camera.getProperties();
+		glm::mat4 projection = OrthoCameraComponentInstance::createRenderProjectionMatrix(region.x, region.z, region.y, region.w, properties.mNearClippingPlane, properties.mFarClippingPlane);
+		VkCommandBuffer command_buffer = mRenderService->getCurrentCommandBuffer();
+		for (int index : indices)
+		{
+			RenderCanvasComponentInstance* canvas = mCanvases[index];
+			canvas->mIsControlViewDraw = false;
+			canvas->setFinalSampler(false);
+			canvas->setEdgeBlend(blend_viewport, blend_edges, blend_lut);
+			canvas->draw(target, command_buffer, camera.getViewMatrix(), projection);
+		}
+	}
+
+	void CanvasGroupComponentInstance::drawCanvases(IRenderTarget& target, const std::vector<CanvasFrameSnapshot::Draw>& draws, const glm::vec4& region, CanvasOutput* output, const OrthoCameraComponentInstance& camera)
+	{
+		glm::vec4 blend_edges = output != nullptr ? output->mBlendEdges : glm::vec4(0.0f);
+		VkViewport viewport = output != nullptr ? output->getViewport() : VkViewport{ 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f };
+		glm::vec4 blend_viewport(viewport.x, viewport.y, viewport.width, viewport.height);
+		Texture2D& blend_lut = output != nullptr ? output->getBlendLut() : mOutputs[0]->getBlendLut();
+
+		const OrthoCameraProperties& properties = camera.getProperties();
+		glm::mat4 projection = OrthoCameraComponentInstance::createRenderProjectionMatrix(region.x, region.z, region.y, region.w, properties.mNearClippingPlane, properties.mFarClippingPlane);
+		VkCommandBuffer command_buffer = mRenderService->getCurrentCommandBuffer();
+		for (const auto& draw : draws)
+		{
+			draw.mCanvas->mIsControlViewDraw = false;
+			draw.mCanvas->setFinalSampler(false);
+			draw.mCanvas->setEdgeBlend(blend_viewport, blend_edges, blend_lut);
+			draw.mCanvas->drawSnapshot(target, command_buffer, camera.getViewMatrix(), projection, draw);
+		}
+	}
+
+	static const char* updateRateNames[] = { "Full", "Hz", "Frames" };
+
+
+	static float getSegmentDistance(const glm::vec2& point, const glm::vec2& a, const glm::vec2& b)
+	{
+		glm::vec2 ab = b - a;
+		float t = glm::clamp(glm::dot(point - a, ab) / std::max(glm::dot(ab, ab), 1e-6f), 0.0f, 1.0f);
+		return glm::distance(point, a + ab * t);
 	}
 
+
 	void CanvasGroupComponentInstance::trigger(const nap::InputEvent& inEvent) {
-		// Ensure it's a pointer event
+		// Runs for every pointer event, a fast drag sends hundreds per frame: only record the latest position here
 		rtti::TypeInfo event_type = inEvent.get_type().get_raw_type();
-		if (!event_type.is_derived_from(RTTI_OF(nap::PointerEvent)))
+		if (!event_type.is_derived_from(RTTI_OF(nap::PointerEvent)) || mSelected == nullptr)
 			return;
-		std::vector<glm::i16vec2> corners = calculateScreenSpacePosition(mSelected);
-		if (event_type == RTTI_OF(PointerPressEvent))
+		const PointerEvent& pointer_event = static_cast<const PointerEvent&>(inEvent);
+		glm::vec2 position(pointer_event.mX, pointer_event.mY);
+
+		if (event_type == RTTI_OF(PointerMoveEvent))
 		{
-			const PointerPressEvent& press_event = static_cast<const PointerPressEvent&>(inEvent);
-			nap::Logger::info("press event!!! upperLeft.x %i, upperLeft.y %i", corners[0].x, corners[0].y);
+			if (mCornerDrag.mActive)
+			{
+				mCornerDrag.mPosition = position;
+				mCornerDrag.mDirty = true;
+			}
 		}
-		else if (event_type == RTTI_OF(PointerMoveEvent))
+		else if (event_type == RTTI_OF(PointerPressEvent))
 		{
-			const PointerMoveEvent& move_event = static_cast<const PointerMoveEvent&>(inEvent);
-			
-			nap::Logger::info("move event!!!" + std::to_string(abs(corners[0].x - move_event.mX)));
-			if (abs(corners[0].x - move_event.mX) < 10 && abs(corners[0].y - move_event.mY) < 10) {
-				nap::Logger::info("touching upper left corner");
+			// Grab the nearest corner within reach, otherwise the nearest edge, which moves both its corners
+			static const int edges[4][2] = { { 0, 1 }, { 2, 3 }, { 0, 2 }, { 1, 3 } };
+			constexpr float grabDistance = 10.0f;
+			std::array<glm::vec2, 4> corners;
+			calculateScreenSpacePosition(mSelected, corners, mCornerDrag.mCanvasSize);
+			mCornerDrag.mCorners[0] = mCornerDrag.mCorners[1] = -1;
+			float nearest = grabDistance;
+			for (int i = 0; i < 4; i++)
+			{
+				float distance = glm::distance(position, corners[i]);
+				if (distance < nearest)
+				{
+					nearest = distance;
+					mCornerDrag.mCorners[0] = i;
+				}
+			}
+			for (int i = 0; i < 4 && mCornerDrag.mCorners[0] < 0; i++)
+			{
+				if (getSegmentDistance(position, corners[edges[i][0]], corners[edges[i][1]]) < grabDistance)
+				{
+					mCornerDrag.mCorners[0] = edges[i][0];
+					mCornerDrag.mCorners[1] = edges[i][1];
+				}
+			}
+			mCornerDrag.mActive = mCornerDrag.mCorners[0] >= 0;
+			if (!mCornerDrag.mActive)
+				return;
+
+			const std::vector<glm::vec2>& offsets = mSelectedCanvas->getCornerOffsets();
+			std::copy(offsets.begin(), offsets.end(), mCornerDrag.mStartOffsets.begin());
+			mCornerDrag.mStart = position;
+			mCornerDrag.mPosition = position;
+			mCornerDrag.mDirty = false;
+		}
+		else if (event_type == RTTI_OF(PointerReleaseEvent))
+		{
+			// The release position completes the drag, it is applied on the next update
+			if (mCornerDrag.mActive)
+			{
+				mCornerDrag.mPosition = position;
+				mCornerDrag.mDirty = true;
+				mCornerDrag.mActive = false;
 			}
 		}
 	}
 
-	std::vector<glm::i16vec2> CanvasGroupComponentInstance::calculateScreenSpacePosition(EntityInstance* entity) {
-		std::vector<glm::i16vec2> corners = std::vector<glm::i16vec2>(4);
 
-		glm::vec3				translate = entity->getComponent<TransformComponentInstance>().getTranslate();
-		glm::vec3				scale = entity->getComponent<TransformComponentInstance>().getScale();
-		glm::quat				rotate = entity->getComponent<TransformComponentInstance>().getRotate();
-		std::vector<glm::vec2>	cornerOffsets = entity->getComponent<RenderCanvasComponentInstance>().getCornerOffsets();
+	void CanvasGroupComponentInstance::applyCornerDrag()
+	{
+		if (!mCornerDrag.mDirty || mSelected == nullptr)
+			return;
+		mCornerDrag.mDirty = false;
+
+		// Offsets move corners inwards, in canvas units: left corners move right and top corners move down with positive offsets
+		glm::vec2 delta = (mCornerDrag.mPosition - mCornerDrag.mStart) / glm::max(mCornerDrag.mCanvasSize, glm::vec2(1.0f));
+		std::copy(mCornerDrag.mStartOffsets.begin(), mCornerDrag.mStartOffsets.end(), mCornerDrag.mOffsets.begin());
+		for (int corner : mCornerDrag.mCorners)
+		{
+			if (corner < 0)
+				continue;
+			glm::vec2 direction(corner % 2 == 0 ? 1.0f : -1.0f, corner < 2 ? -1.0f : 1.0f);
+			mCornerDrag.mOffsets[corner] = glm::clamp(mCornerDrag.mStartOffsets[corner] + delta * direction, 0.0f, 1.0f);
+		}
+		mSelectedCanvas->setCornerOffsets(mCornerDrag.mOffsets);
+		mDragStats.mUpdates++;
+	}
+
+
+	void CanvasGroupComponentInstance::feedDragStressEvents(double deltaTime)
+	{
+		// Synthetic pointer at 1 kHz, circling the top left corner of the selected canvas
+		constexpr double eventRate = 1000.0;
+		constexpr float radius = 40.0f;
+		if (mSelected == nullptr)
+			return;
+		if (!mCornerDrag.mActive)
+		{
+			std::array<glm::vec2, 4> corners;
+			glm::vec2 canvas_size;
+			calculateScreenSpacePosition(mSelected, corners, canvas_size);
+			mDragStats.mCenter = corners[0];
+			trigger(PointerPressEvent(static_cast<int>(corners[0].x), static_cast<int>(corners[0].y), EMouseButton::LEFT));
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		mDragStats.mPending += deltaTime * eventRate;
+		int count = static_cast<int>(mDragStats.mPending);
+		mDragStats.mPending -= count;
+		for (int i = 0; i < count; i++)
+		{
+			mDragStats.mPhase += glm::two_pi<double>() / eventRate;
+			glm::vec2 position = mDragStats.mCenter + glm::vec2(std::cos(mDragStats.mPhase), std::sin(mDragStats.mPhase)) * radius - glm::vec2(radius, 0.0f);
+			trigger(PointerMoveEvent(0, 0, static_cast<int>(position.x), static_cast<int>(position.y)));
+		}
+		mDragStats.mEvents = count;
+		mDragStats.mTriggerTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+
+	void CanvasGroupComponentInstance::calculateScreenSpacePosition(EntityInstance* entity, std::array<glm::vec2, 4>& outCorners, glm::vec2& outCanvasSize) {
+		const TransformComponentInstance& transform = entity->getComponent<TransformComponentInstance>();
+		const glm::vec3& translate = transform.getTranslate();
+		const glm::vec3& scale = transform.getScale();
+		const std::vector<glm::vec2>& cornerOffsets = entity->getComponent<RenderCanvasComponentInstance>().getCornerOffsets();
 		//canvasSize and windowSize are in pixels
-		glm::ivec2 canvasSize = entity->getComponent<RenderCanvasComponentInstance>().getOutputTexture()->getSize();
-		glm::ivec2 windowSize = entity->getCore()->getResourceManager()->findObject<RenderWindow>("ControlsWindow")->getSize();
+		glm::vec2 canvasSize = entity->getComponent<RenderCanvasComponentInstance>().getOutputTexture()->getSize();
+		glm::vec2 windowSize = entity->getCore()->getResourceManager()->findObject<RenderWindow>("ControlsWindow")->getSize();
 		//scale canvasSize values to window
 		if (canvasSize.x > canvasSize.y) {
-			canvasSize = {windowSize.x, windowSize.x * canvasSize.y / canvasSize.x};
+			canvasSize = { windowSize.x, windowSize.x * canvasSize.y / canvasSize.x };
 		}
 		else {
 			canvasSize = { windowSize.y * canvasSize.x / canvasSize.y, windowSize.y };
 		}
 
-		corners[0] = glm::i16vec2(((windowSize.x - canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) + cornerOffsets[0].x * canvasSize.x, ((canvasSize.y * scale.y + windowSize.y) / 2 + windowSize.y * translate.y) - cornerOffsets[0].y * canvasSize.y);
-		corners[1] = glm::i16vec2(((windowSize.x + canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) - cornerOffsets[1].x * canvasSize.x, ((canvasSize.y * scale.y + windowSize.y) / 2 + windowSize.y * translate.y) - cornerOffsets[1].y * canvasSize.y);
-		corners[2] = glm::i16vec2(((windowSize.x - canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) + cornerOffsets[2].x * canvasSize.x, ((windowSize.y - canvasSize.y * scale.y) / 2 + windowSize.y * translate.y) + cornerOffsets[2].y * canvasSize.y);
-		corners[3] = glm::i16vec2(((windowSize.x + canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) - cornerOffsets[3].x * canvasSize.x, ((windowSize.y - canvasSize.y * scale.y) / 2 + windowSize.y * translate.y) + cornerOffsets[3].y * canvasSize.y);
-		return corners;
+		outCorners[0] = glm::vec2(((windowSize.x - canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) + cornerOffsets[0].x * canvasSize.x, ((canvasSize.y * scale.y + windowSize.y) / 2 + windowSize.y * translate.y) - cornerOffsets[0].y * canvasSize.y);
+		outCorners[1] = glm::vec2(((windowSize.x + canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) - cornerOffsets[1].x * canvasSize.x, ((canvasSize.y * scale.y + windowSize.y) / 2 + windowSize.y * translate.y) - cornerOffsets[1].y * canvasSize.y);
+		outCorners[2] = glm::vec2(((windowSize.x - canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) + cornerOffsets[2].x * canvasSize.x, ((windowSize.y - canvasSize.y * scale.y) / 2 + windowSize.y * translate.y) + cornerOffsets[2].y * canvasSize.y);
+		outCorners[3] = glm::vec2(((windowSize.x + canvasSize.x * scale.x) / 2 + windowSize.x * translate.x) - cornerOffsets[3].x * canvasSize.x, ((windowSize.y - canvasSize.y * scale.y) / 2 + windowSize.y * translate.y) + cornerOffsets[3].y * canvasSize.y);
+		outCanvasSize = canvasSize;
+	}
+
+	void CanvasGroupComponentInstance::select(EntityInstance* entity)
+	{
+		mSelected = entity;
+		mSelectedCanvas = &entity->getComponent<RenderCanvasComponentInstance>();
 	}
 
+
 	void CanvasGroupComponentInstance::drawSequenceEditor() {
 		mSequenceEditorGUI->show();
 	}
@@ -109,44 +588,214 @@ namespace nap
 		}
 	}
 
-	bool CanvasGroupComponentInstance::initSelectedRenderTarget()
+	bool CanvasGroupComponentInstance::initSelectedRenderTarget(utility::ErrorState& errorState)
 	{
 		mSelectedOutputTexture = getEntityInstance()->getCore()->getResourceManager()->createObject<RenderTexture2D>();
-		ResourcePtr<RenderTexture2D> outputTexRef = mSelected->getComponent<RenderCanvasComponentInstance>().getOutputTexture();
+		ResourcePtr<RenderTexture2D> outputTexRef = mSelectedCanvas->getOutputTexture();
 		mSelectedOutputTexture->mWidth = outputTexRef->mWidth;
 		mSelectedOutputTexture->mHeight = outputTexRef->mHeight;
 		mSelectedOutputTexture->mFormat = outputTexRef->mFormat;
 		mSelectedOutputTexture->mUsage = ETextureUsage::Static;
-		nap::utility::ErrorState error;
-		if (!mSelectedOutputTexture->init(error))
-		{
-			error.fail("%s: Failed to initialize selected output texture", mSelectedOutputTexture->mID.c_str());
+		if (!errorState.check(mSelectedOutputTexture->init(errorState), "%s: Failed to initialize selected output texture", mSelectedOutputTexture->mID.c_str()))
 			return false;
-		}
 		mSelectedRenderTarget = getEntityInstance()->getCore()->getResourceManager()->createObject<RenderTarget>();
 		mSelectedRenderTarget->mColorTexture = mSelectedOutputTexture;
 		mSelectedRenderTarget->mClearColor = RGBAColor8(255, 255, 255, 0).convert<RGBAColorFloat>();
 		mSelectedRenderTarget->mSampleShading = false;
 		mSelectedRenderTarget->mRequestedSamples = ERasterizationSamples::One;
-		if (!mSelectedRenderTarget->init(error))
-		{
-			error.fail("%s: Failed to initialize internal render target", mSelectedRenderTarget->mID.c_str());
+		if (!errorState.check(mSelectedRenderTarget->init(errorState), "%s: Failed to initialize internal render target", mSelectedRenderTarget->mID.c_str()))
 			return false;
-		}
+		return true;
 	}
 
 	void CanvasGroupComponentInstance::drawAllHeadless()
 	{
-		std::vector<EntityInstance*> mCanvasEntities = getEntityInstance()->getChildren(); //TODO: maybe set in init() and update() when entityinstance children update call?
-		for (EntityInstance* canvasEntity : mCanvasEntities) {
-			canvasEntity->getComponent<RenderCanvasComponentInstance>().drawAllHeadlessPasses();
+		FOGLIO_TRACE_ZONE("CanvasGroup::drawAllHeadless");
+		auto start = std::chrono::steady_clock::now();
+		scheduleCanvases();
+		const std::vector<int>& pass_counts = mCanvasRegistry->getPassCounts();
+		if (mRecorder == nullptr)
+		{
+			for (int index : mScheduledCanvases)
+			{
+				mCanvases[index]->drawAllHeadlessPasses();
+				mHeadlessPassCounter->add(pass_counts[mCanvasSlots[index]]);
+			}
+		}
+		else
+		{
+			// Descriptor sets and pipelines come from shared caches, prepare serially, then record in parallel
+			mHeadlessPackets.clear();
+			for (int index : mScheduledCanvases)
+				mCanvases[index]->prepareHeadlessPasses(mHeadlessPackets);
+			if (mRecordBenchmarkIterations > 0)
+				benchmarkRecording();
+			mRecorder->record(mHeadlessPackets);
+			mRecorder->execute(mHeadlessPackets);
+			mHeadlessPassCounter->add(mHeadlessPackets.size());
 		}
+		for (int index : mScheduledCanvases)
+		{
+			if ((mCanvasRegistry->getFlags()[mCanvasSlots[index]] & CanvasRegistry::flagPublished) != 0)
+				mCanvases[index]->publish();
+		}
+		mHeadlessRecordTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+
+	void CanvasGroupComponentInstance::benchmarkRecording()
+	{
+		// The secondaries are recorded over and over, the regular record after this is the one that is executed
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < mRecordBenchmarkIterations; i++)
+			mRecorder->record(mHeadlessPackets, false);
+		auto serial_end = std::chrono::steady_clock::now();
+		for (int i = 0; i < mRecordBenchmarkIterations; i++)
+			mRecorder->record(mHeadlessPackets);
+		auto parallel_end = std::chrono::steady_clock::now();
+
+		mRecordBenchmarkSerial = std::chrono::duration<double>(serial_end - start).count() / mRecordBenchmarkIterations;
+		mRecordBenchmarkParallel = std::chrono::duration<double>(parallel_end - serial_end).count() / mRecordBenchmarkIterations;
+		nap::Logger::info("Headless recording of %d passes: 1 thread %.3fms, %d threads %.3fms", static_cast<int>(mHeadlessPackets.size()),
+			mRecordBenchmarkSerial * 1000.0, mRecorder->getThreadCount(), mRecordBenchmarkParallel * 1000.0);
+		mRecordBenchmarkIterations = 0;
+	}
+
+
+	void CanvasGroupComponentInstance::updateCanvasSlots()
+	{
+		// Slots move when canvases register or are removed, and when a reload sorts the registry. A canvas that a reload
+		// in progress replaced has no slot, it gets its slot back when the reload fails.
+		for (int i = 0; i < mCanvases.size(); i++)
+			mCanvasSlots[i] = mCanvases[i]->getRegistryIndex();
 	}
 
+
+	void CanvasGroupComponentInstance::scheduleCanvases()
+	{
+		// The cost of a canvas is estimated from the pixels its passes write, the schedule only rebuilds when a rate or a canvas changes
+		const std::vector<int>& pass_counts = mCanvasRegistry->getPassCounts();
+		mUpdatePeriods.resize(mCanvases.size(), 0);
+		mUpdateCosts.resize(mCanvases.size(), 0.0f);
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			const RenderCanvasComponentInstance& canvas = *mCanvases[i];
+			mUpdatePeriods[i] = CanvasUpdateScheduler::getPeriod(canvas.getUpdateRate(), canvas.getUpdateHz(), canvas.getUpdateFrames(), mFrameInterval, mUpdatePeriods[i]);
+			const RenderTexture2D& output = *canvas.getOutputTexture();
+			int pass_count = mCanvasSlots[i] >= 0 ? pass_counts[mCanvasSlots[i]] : 0;
+			mUpdateCosts[i] = static_cast<float>(pass_count) * static_cast<float>(output.getWidth()) * static_cast<float>(output.getHeight()) / 1e6f;
+		}
+		mScheduler.update(mUpdatePeriods, mUpdateCosts);
+
+		// Canvases that were built since their last turn render right away, their output is still empty
+		mScheduledCanvases.clear();
+		float load = 0.0f;
+		for (int index : mActiveCanvases)
+		{
+			if (mScheduler.isDue(index, mHeadlessFrame) || mCanvases[index]->isStale())
+			{
+				mScheduledCanvases.emplace_back(index);
+				load += mUpdateCosts[index];
+			}
+		}
+		mDeferredCount = static_cast<int>(mActiveCanvases.size() - mScheduledCanvases.size());
+		mDeferredCanvasCounter->add(mDeferredCount);
+		mHeadlessLoads[mHeadlessLoadIndex] = load;
+		mHeadlessLoadIndex = (mHeadlessLoadIndex + 1) % mHeadlessLoads.size();
+		mHeadlessFrame++;
+	}
+
+	size_t CanvasGroupComponentInstance::getGpuMemory(std::vector<std::vector<GpuMemoryEntry>>& outEntries)
+	{
+		outEntries.clear();
+		outEntries.resize(mCanvases.size() + 1);
+		for (int i = 0; i < mCanvases.size(); i++)
+			mCanvases[i]->getGpuMemory(outEntries[i]);
+
+		// The interface target has a depth attachment, estimated at 4 bytes per pixel
+		std::vector<GpuMemoryEntry>& group_entries = outEntries.back();
+		if (mSelectedOutputTexture != nullptr)
+		{
+			group_entries.push_back({ "interface", EGpuMemoryKind::Texture, mSelectedOutputTexture.get(), getTextureMemory(*mSelectedOutputTexture) });
+			group_entries.push_back({ "interface target", EGpuMemoryKind::RenderTarget, nullptr,
+				static_cast<size_t>(mSelectedOutputTexture->getWidth()) * static_cast<size_t>(mSelectedOutputTexture->getHeight()) * 4 });
+		}
+
+		size_t total = 0;
+		std::unordered_set<const Texture2D*> counted;
+		for (const auto& entries : outEntries)
+		{
+			for (const auto& entry : entries)
+			{
+				if (entry.mTexture == nullptr || counted.emplace(entry.mTexture).second)
+					total += entry.mBytes;
+			}
+		}
+		return total;
+	}
+
+
+	void CanvasGroupComponentInstance::drawGpuMemory()
+	{
+		std::vector<std::vector<GpuMemoryEntry>> entries;
+		double total = static_cast<double>(getGpuMemory(entries)) / (1024.0 * 1024.0);
+		if (mMemoryBudget > 0.0f)
+		{
+			ImVec4 color = total > mMemoryBudget ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImGui::GetStyleColorVec4(ImGuiCol_Text);
+			ImGui::TextColored(color, "Total: %.2fMB of %.2fMB", total, mMemoryBudget);
+		}
+		else
+		{
+			ImGui::Text("Total: %.2fMB", total);
+		}
+
+		for (int i = 0; i < entries.size(); i++)
+		{
+			const char* name = i < mCanvases.size() ? mCanvases[i]->getEntityInstance()->mID.c_str() : getEntityInstance()->mID.c_str();
+			size_t bytes = 0;
+			for (const auto& entry : entries[i])
+				bytes += entry.mBytes;
+			if (!ImGui::TreeNode(name, "%s: %.2fMB", name, static_cast<double>(bytes) / (1024.0 * 1024.0)))
+				continue;
+			for (const auto& entry : entries[i])
+			{
+				ImGui::Text("%-8s %-28s %10.2fKB (%s)", getGpuMemoryKindName(entry.mKind), entry.mName.c_str(), static_cast<double>(entry.mBytes) / 1024.0,
+					entry.mTexture != nullptr ? utility::stringFormat("%dx%d", entry.mTexture->getWidth(), entry.mTexture->getHeight()).c_str() : "-");
+			}
+			ImGui::TreePop();
+		}
+	}
+
+
+	void CanvasGroupComponentInstance::drawSchedule()
+	{
+		// Planned load covers every canvas, culled or not, the rendered load only the canvases that were drawn
+		const std::vector<float>& load = mScheduler.getLoad();
+		float peak = *std::max_element(load.begin(), load.end());
+		float total = 0.0f;
+		for (float frame_load : load)
+			total += frame_load;
+		ImGui::Text("Schedule: %d frames, planned load peak %.2f mean %.2f Mpix, rebuilt %d times", mScheduler.getLength(), peak,
+			total / static_cast<float>(load.size()), mScheduler.getRebuildCount());
+		ImGui::PlotHistogram("Planned##schedule", load.data(), static_cast<int>(load.size()), 0, nullptr, 0.0f, std::max(peak, 0.01f) * 1.2f, ImVec2(0.0f, 60.0f));
+		float rendered_peak = *std::max_element(mHeadlessLoads.begin(), mHeadlessLoads.end());
+		ImGui::PlotLines("Rendered##schedule", mHeadlessLoads.data(), static_cast<int>(mHeadlessLoads.size()), mHeadlessLoadIndex, nullptr, 0.0f,
+			std::max(std::max(rendered_peak, peak), 0.01f) * 1.2f, ImVec2(0.0f, 60.0f));
+		ImGui::Text("Deferred this frame: %d of %d active canvases, rendered peak %.2f Mpix (last %d frames)", mDeferredCount,
+			static_cast<int>(mActiveCanvases.size()), rendered_peak, static_cast<int>(mHeadlessLoads.size()));
+		for (int i = 0; i < std::min(static_cast<int>(mCanvases.size()), mScheduler.getCanvasCount()); i++)
+		{
+			const RenderCanvasComponentInstance& canvas = *mCanvases[i];
+			ImGui::Text("%-24s %-6s every %3d frames, phase %3d, %.2f Mpix", canvas.getEntityInstance()->mID.c_str(), updateRateNames[static_cast<int>(canvas.getUpdateRate())],
+				mScheduler.getPeriod(i), mScheduler.getPhase(i), mUpdateCosts[i]);
+		}
+	}
+
+
 	void CanvasGroupComponentInstance::drawSelectedInterface()
 	{
-		if (mSelected != nullptr) {
-			mSelected->getComponent<RenderCanvasComponentInstance>().drawInterface(mSelectedRenderTarget);
+		if (mSelectedCanvas != nullptr) {
+			mSelectedCanvas->drawInterface(mSelectedRenderTarget);
 		}
 	}
 
@@ -155,7 +804,28 @@ namespace nap
 		if (ImGui::Button("Toggle Backdrop")) {
 			mDrawBackdrop = !mDrawBackdrop;
 		}
-		for (EntityInstance* canvasEntity : getEntityInstance()->getChildren()) {
+		ImGui::Checkbox("Draw Outputs From Snapshot", &mDrawFromSnapshot);
+		ImGui::Text("Headless recording: %.3fms (%d threads)", mHeadlessRecordTime * 1000.0, mRecorder != nullptr ? mRecorder->getThreadCount() : 1);
+		if (mRecorder != nullptr)
+		{
+			if (ImGui::Button("Benchmark Recording"))
+				mRecordBenchmarkIterations = 50;
+			if (mRecordBenchmarkParallel > 0.0)
+			{
+				ImGui::SameLine();
+				ImGui::Text("1 thread %.3fms, %d threads %.3fms (%.1fx)", mRecordBenchmarkSerial * 1000.0, mRecorder->getThreadCount(),
+					mRecordBenchmarkParallel * 1000.0, mRecordBenchmarkSerial / mRecordBenchmarkParallel);
+			}
+		}
+		for (int i = 0; i < mOutputs.size(); i++)
+			ImGui::Text("Output %s: %d of %d canvases", mOutputs[i]->mID.c_str(), getVisibleCanvasCount(i), static_cast<int>(mCanvases.size()));
+		if (ImGui::CollapsingHeader("GPU Memory", ImGuiTreeNodeFlags_None))
+			drawGpuMemory();
+		ImGui::Text("Culled canvases: %d (hidden %d, off-screen %d, occluded %d)", mCullStats.getTotal(), mCullStats.mHidden, mCullStats.mOffscreen, mCullStats.mOccluded);
+		if (ImGui::CollapsingHeader("Update Schedule", ImGuiTreeNodeFlags_None))
+			drawSchedule();
+		for (int i = 0; i < mCanvases.size(); i++) {
+			EntityInstance* canvasEntity = mCanvases[i]->getEntityInstance();
 			ImGuiTreeNodeFlags node_flags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
 			if (mSelected == canvasEntity) {
 				node_flags |= ImGuiTreeNodeFlags_Selected;
@@ -163,13 +833,17 @@ namespace nap
 			ImGui::TreeNodeEx((EntityInstance*)canvasEntity, node_flags, canvasEntity->getEntity()->mID.c_str());
 			if (ImGui::IsItemClicked())
 			{
-				mSelected->getComponent<RenderCanvasComponentInstance>().setFinalSampler(false);
-				mSelected = canvasEntity;
+				mSelectedCanvas->setFinalSampler(false);
+				select(canvasEntity);
+				mCornerDrag.mActive = false;
+				mCornerDrag.mDirty = false;
 				setSequencePlayer();
 			}
 				
 		}
-		RenderCanvasComponentInstance& canvas_comp = mSelected->getComponent<RenderCanvasComponentInstance>();
+		if (mSelectedCanvas == nullptr)
+			return;
+		RenderCanvasComponentInstance& canvas_comp = *mSelectedCanvas;
 		TransformComponentInstance& canvas_transform_comp = mSelected->getComponent<TransformComponentInstance>();
 		
 		ResourcePtr<RenderTexture2D> canvas_tex = canvas_comp.getOutputTexture();
@@ -182,12 +856,18 @@ namespace nap
 		utility::ErrorState errorState;
 		if (canvas_comp.getVideoPlayer() != nullptr) {
 			VideoPlayer* video_player = canvas_comp.getVideoPlayer();
-			float current_time = canvas_comp.getVideoPlayer()->getCurrentTime();
-			if (ImGui::SliderFloat("", &current_time, 0.0f, canvas_comp.getVideoPlayer()->getDuration(), "%.3fs", 1.0f))
-				canvas_comp.getVideoPlayer()->seek(current_time);
-			ImGui::Text("Total time: %fs", canvas_comp.getVideoPlayer()->getDuration());
+			VideoLadder& ladder = *mVideoLadders[video_player];
+			VideoPlayer& active_player = ladder.getActivePlayer();
+			float current_time = active_player.getCurrentTime();
+			if (ImGui::SliderFloat("", &current_time, 0.0f, active_player.getDuration(), "%.3fs", 1.0f))
+				active_player.seek(current_time);
+			ImGui::Text("Total time: %fs", active_player.getDuration());
+			if (ladder.getRenditionHeight() > 0)
+				ImGui::Text("Rendition: %dp of %d%s", ladder.getRenditionHeight(), ladder.getRenditionCount(), ladder.isPrerolling() ? ", prerolling" : "");
+			else
+				ImGui::Text("Rendition: original of %d%s", ladder.getRenditionCount(), ladder.isPrerolling() ? ", prerolling" : "");
 			ImGui::BeginGroup();
-			std::string mediaControlSymbol = video_player->isPlaying() ? "X" : "O";
+			std::string mediaControlSymbol = active_player.isPlaying() ? "X" : "O";
 			
 			if (ImGui::ArrowButton("##left", ImGuiDir_Left)) {
 				if (video_player->getIndex() == 0) {
@@ -201,7 +881,7 @@ namespace nap
 			}
 			ImGui::SameLine();
 			if (ImGui::Button(mediaControlSymbol.c_str())) {
-				video_player->isPlaying() ? video_player->stopPlayback() : video_player->play();
+				active_player.isPlaying() ? active_player.stopPlayback() : active_player.play(active_player.getCurrentTime(), active_player.getSpeed());
 			}
 			ImGui::SameLine();
 			if (ImGui::ArrowButton("##right", ImGuiDir_Right)) {
@@ -211,6 +891,37 @@ namespace nap
 			ImGui::EndGroup();
 
 		}
+		if (canvas_comp.getImageSequence() != nullptr) {
+			ImageSequence* sequence = canvas_comp.getImageSequence();
+			float current_time = static_cast<float>(sequence->getCurrentTime());
+			if (ImGui::SliderFloat("##sequence", &current_time, 0.0f, static_cast<float>(sequence->getDuration()), "%.3fs", 1.0f))
+				sequence->seek(current_time);
+			if (ImGui::Button(sequence->isPlaying() ? "X##sequence" : "O##sequence")) {
+				sequence->isPlaying() ? sequence->stop() : sequence->play();
+			}
+			static const char* format_names[] = { "RGBA", "YUV", "BC1", "BC3" };
+			ImGui::Text("Sequence %s: %dx%d %s%s, frame %d of %d", sequence->mID.c_str(), sequence->getWidth(), sequence->getHeight(),
+				format_names[static_cast<int>(sequence->getFormat())], sequence->isCompressed() ? " LZ4" : "", sequence->getCurrentFrame(), sequence->getFrameCount());
+			ImGui::Text("Mapped %.1fMB, %.1fMB/s at %.2f fps", static_cast<double>(sequence->getMappedSize()) / (1024.0 * 1024.0),
+				static_cast<double>(sequence->getFrameSize()) * sequence->getFrameRate() * sequence->mSpeed / (1024.0 * 1024.0), sequence->getFrameRate());
+			ImGui::Text("Resident %d of %d ahead, late frames %d, upload %.3fms", sequence->getResidentFrameCount(), sequence->mPrefetchFrames + 1,
+				sequence->getLateFrameCount(), sequence->getUploadTime() * 1000.0);
+			if (sequence->isCompressed())
+				ImGui::Text("Decompress %.3fms per frame on the prefetch thread", sequence->getDecodeTime() * 1000.0);
+		}
+		int update_rate = static_cast<int>(canvas_comp.getUpdateRate());
+		float update_hz = canvas_comp.getUpdateHz();
+		int update_frames = canvas_comp.getUpdateFrames();
+		bool rate_changed = ImGui::Combo("Update Rate", &update_rate, updateRateNames, 3);
+		if (update_rate == static_cast<int>(ECanvasUpdateRate::Hz))
+			rate_changed |= ImGui::DragFloat("Update Hz", &update_hz, 0.1f, 0.1f, 240.0f, "%.1f");
+		else if (update_rate == static_cast<int>(ECanvasUpdateRate::Frames))
+			rate_changed |= ImGui::DragInt("Update Frames", &update_frames, 0.1f, 1, CanvasUpdateScheduler::maxLength);
+		if (rate_changed)
+			canvas_comp.setUpdateRate(static_cast<ECanvasUpdateRate>(update_rate), update_hz, update_frames);
+		int index = static_cast<int>(std::find(mCanvases.begin(), mCanvases.end(), &canvas_comp) - mCanvases.begin());
+		if (index < mScheduler.getCanvasCount())
+			ImGui::Text("Renders every %d frames, phase %d", mScheduler.getPeriod(index), mScheduler.getPhase(index));
 		ImGui::Text("Position");
 		glm::vec3 translate = canvas_transform_comp.getTranslate();
 		float tempXTransl = translate.x;
@@ -238,6 +949,9 @@ namespace nap
 		}
 		if (ImGui::CollapsingHeader("Corner Offsets", ImGuiTreeNodeFlags_None))
 		{
+			if (ImGui::Checkbox("Drag Stress Test (1 kHz)", &mDragStressTest) && !mDragStressTest)
+				trigger(PointerReleaseEvent(static_cast<int>(mCornerDrag.mPosition.x), static_cast<int>(mCornerDrag.mPosition.y), EMouseButton::LEFT));
+			ImGui::Text("Pointer events: %d, corner updates: %d, event handling: %.3fms", mDragStats.mEvents, mDragStats.mUpdates, mDragStats.mTriggerTime * 1000.0);
 			std::vector<glm::vec2> offsets = canvas_comp.getCornerOffsets();
 			ImGui::DragFloat("Top Left X", &offsets[0].x, 0.01f, 0.0f, 1.0f);
 			ImGui::DragFloat("Top Left Y", &offsets[0].y, 0.01f, 0.0f, 1.0f);
@@ -252,10 +966,34 @@ namespace nap
 			}
 		}
 		
+		if (canvas_comp.getMaskCount() > 0 && ImGui::CollapsingHeader("Masks", ImGuiTreeNodeFlags_None))
+		{
+			for (int i = 0; i < canvas_comp.getMaskCount(); i++) {
+				const std::string& path = canvas_comp.getComponent<RenderCanvasComponent>()->mMaskFiles[i];
+				if (ImGui::RadioButton(path.c_str(), canvas_comp.getMaskIndex() == i))
+					canvas_comp.selectMask(i);
+			}
+			ImGui::Checkbox("Cycle Every Frame", &mCycleMasks);
+			ImGui::Text("Loading %d, resident %d of %d", canvas_comp.getLoadingMaskCount(), canvas_comp.getResidentMaskCount(), canvas_comp.getComponent<RenderCanvasComponent>()->mMaxResidentMasks);
+			double total = 0.0;
+			double max = 0.0;
+			for (double frame_time : mFrameTimes) {
+				total += frame_time;
+				max = std::max(max, frame_time);
+			}
+			ImGui::Text("Frame time: avg %.2fms max %.2fms (last %d frames)", total * 1000.0 / mFrameTimes.size(), max * 1000.0, static_cast<int>(mFrameTimes.size()));
+		}
+
 		if (mSelected->hasComponent<SequenceCanvasComponentInstance>()) {
 			SequenceCanvasComponentInstance& seq_canvas_comp = mSelected->getComponent<SequenceCanvasComponentInstance>();
 			ResourcePtr<SequencePlayer> seq_player = seq_canvas_comp.getSequencePlayer();
 			ImGui::Text("Sequence %s", seq_player->getSequenceFilename());
+			const SequenceCanvasComponentInstance::CueStats& cue_stats = seq_canvas_comp.getCueStats();
+			ImGui::Text("Cues: %d applied, %d dropped, %d stale after seeks, latency avg %.2fms max %.2fms", cue_stats.mApplied, cue_stats.mDropped, cue_stats.mStale,
+				cue_stats.mAverageLatency * 1000.0, cue_stats.mMaxLatency * 1000.0);
+			const MetricHistogram& cue_latency = seq_canvas_comp.getCueLatency();
+			ImGui::Text("Cue latency, all sequences (last %ds): p50 %.2fms, p95 %.2fms, p99 %.2fms", Metrics::window,
+				cue_latency.getRollingPercentile(0.5) * 1000.0, cue_latency.getRollingPercentile(0.95) * 1000.0, cue_latency.getRollingPercentile(0.99) * 1000.0);
 			float playbackSpeed = seq_player->getPlaybackSpeed();
 			float tempPlaybackSpeed = playbackSpeed;
 			ImGui::DragFloat("Sequence Speed", &playbackSpeed, 0.01f, 0.0f, 100.0f);
@@ -265,14 +1003,33 @@ namespace nap
 			}
 		}
 		
-		if (canvas_comp.mCustomPostPass != nullptr) {
-			UniformStructInstance* ubo = canvas_comp.mCustomPostPass->mUBO;
-			ImGui::Text("Custom Post Pass");
-			float tempPowerTo = ubo->findUniform<UniformFloatInstance>("power_to")->getValue();
-			ImGui::DragFloat("Power to", &tempPowerTo, 0.01f, 0.0f, 1.0f);
-			if (tempPowerTo != ubo->findUniform<UniformFloatInstance>("power_to")->getValue()) {
-				ubo->findUniform<UniformFloatInstance>("power_to")->setValue(tempPowerTo);
+		for (const auto& shader_pass : canvas_comp.getShaderPasses()) {
+			ShaderParameterTable* parameters = shader_pass->mParameters.get();
+			if (parameters == nullptr || parameters->getParameters().empty())
+				continue;
+			ImGui::PushID(shader_pass.get());
+			ImGui::Text("Custom Post Pass: %s", shader_pass->mMaterial->mID.c_str());
+			for (int i = 0; i < parameters->getParameters().size(); i++) {
+				const ShaderParameter& parameter = parameters->getParameters()[i];
+				if (parameter.mType == EShaderParameterType::Int) {
+					int temp_int = parameters->getInt(i);
+					if (parameter.mSource != EShaderParameterSource::User)
+						ImGui::Text("%s: %d", parameter.mName.c_str(), temp_int);
+					else if (ImGui::DragInt(parameter.mName.c_str(), &temp_int))
+						parameters->setInt(i, temp_int);
+					continue;
+				}
+				const float* value = parameters->getValue(i);
+				if (parameter.mSource != EShaderParameterSource::User) {
+					ImGui::Text("%s: %.2f", parameter.mName.c_str(), value[0]);
+					continue;
+				}
+				float temp[4];
+				std::copy(value, value + parameter.mComponents, temp);
+				if (ImGui::DragScalarN(parameter.mName.c_str(), ImGuiDataType_Float, temp, parameter.mComponents, 0.01f))
+					parameters->set(i, temp);
 			}
+			ImGui::PopID();
 		}
 		
 		
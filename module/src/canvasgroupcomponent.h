@@ -1,6 +1,10 @@
 #pragma once
 
 #include "rendercanvascomponent.h"
+#include "sequencecurvebindings.h"
+#include "sequencecanvascomponent.h"
+#include "canvasoutput.h"
+#include "videoladder.h"
 
 #include <component.h>
 #include <inputcomponent.h>
@@ -10,6 +14,9 @@
 #include <sequence.h>
 #include <sequenceevent.h>
 #include <renderservice.h>
+#include <orthocameracomponent.h>
+#include <unordered_map>
+#include <array>
 
 
 namespace nap
@@ -26,6 +33,12 @@ namespace nap
 	public:
 		ResourcePtr<SequenceEditor> mSequencePlayerEditor = nullptr;
 		ResourcePtr<SequenceEditorGUI>	mSequencePlayerEditorGUI = nullptr;
+		int								mRecordingThreads = 1;		///< Property: 'RecordingThreads' threads that record the headless canvas passes, 1 records inline, 0 uses all cores
+		std::vector<ResourcePtr<CanvasOutput>>	mOutputs;			///< Property: 'Outputs' projector outputs, each shows a region of the virtual canvas space
+		glm::ivec2						mVirtualSize = { 1920, 1080 };	///< Property: 'VirtualSize' size in pixels of the virtual canvas space shared by all outputs
+		float							mMemoryBudget = 0.0f;		///< Property: 'MemoryBudget' GPU memory budget of all canvases in MB, 0 disables the budget
+		bool							mRefuseOverBudget = false;	///< Property: 'RefuseOverBudget' if a scene over budget fails to load, otherwise a warning is logged
+		float							mKeyframeInterval = 1.0f;	///< Property: 'KeyframeInterval' keyframe interval in seconds of the video renditions, 0 switches renditions immediately
 	};
 
 	class NAPAPI CanvasGroupComponentInstance : public InputComponentInstance
@@ -35,9 +48,80 @@ namespace nap
 		CanvasGroupComponentInstance(EntityInstance& entity, Component& resource);
 
 		virtual bool init(utility::ErrorState& errorState) override;
-		
+
+		/**
+		 * Applies the sequence cues that are due, evaluates the sequence curve bindings,
+		 * lays out all canvases in the virtual canvas space and culls them per output.
+		 * @param deltaTime time in seconds since last update
+		 */
+		virtual void update(double deltaTime) override;
+
+		/**
+		 * Renders the headless passes of the canvases that survived culling and are due this frame, see getScheduler().
+		 * Canvases with a reduced update rate are staggered over the frames, their output holds the last frame in between.
+		 */
 		void drawAllHeadless();
 
+		/**
+		 * @return schedule of the canvas update rates, indexed by the canvas index within this group
+		 */
+		const CanvasUpdateScheduler& getScheduler() const								{ return mScheduler; }
+
+		/**
+		 * @return all projector outputs
+		 */
+		const std::vector<ResourcePtr<CanvasOutput>>& getOutputs() const			{ return mOutputs; }
+
+		/**
+		 * Draws the canvases visible in an output into the viewport of that output.
+		 * Must be called between beginRendering() and endRendering() of the output window.
+		 * @param index output index
+		 * @param camera camera that provides the view matrix and clipping planes
+		 */
+		void drawOutput(int index, const OrthoCameraComponentInstance& camera);
+
+		/**
+		 * Draws all canvases, covering the entire virtual canvas space, into a target.
+		 * Must be called between beginRendering() and endRendering() of the target.
+		 * @param target the target to draw into
+		 * @param camera camera that provides the view matrix and clipping planes
+		 */
+		void drawComposition(IRenderTarget& target, const OrthoCameraComponentInstance& camera);
+
+		/**
+		 * @return size in pixels of the virtual canvas space shared by all outputs
+		 */
+		const glm::ivec2& getVirtualSize() const										{ return mVirtualSize; }
+
+		/**
+		 * @param index output index
+		 * @return number of canvases visible in an output this frame
+		 */
+		int getVisibleCanvasCount(int index) const										{ return static_cast<int>(mVisibleCanvases[index].size()); }
+
+		/**
+		 * Number of canvases whose headless passes were skipped this frame, per reason
+		 */
+		struct CullStats
+		{
+			int mHidden = 0;		///< Not visible or without area
+			int mOffscreen = 0;		///< Outside of every output
+			int mOccluded = 0;		///< Covered by an opaque canvas drawn on top
+			int getTotal() const	{ return mHidden + mOffscreen + mOccluded; }
+		};
+
+		/**
+		 * @return canvases culled this frame
+		 */
+		const CullStats& getCullStats() const											{ return mCullStats; }
+
+		/**
+		 * Lists the GPU memory used by all canvases, including the interface target of the selected canvas.
+		 * @param outEntries entries per canvas, in canvas order, followed by the entries of the group
+		 * @return total number of bytes, textures shared by canvases are counted once
+		 */
+		size_t getGpuMemory(std::vector<std::vector<GpuMemoryEntry>>& outEntries);
+
 		void drawSelectedInterface();
 
 		void drawOutliner();
@@ -46,13 +130,20 @@ namespace nap
 
 		void setSequencePlayer(); // for editor gui
 
-		bool initSelectedRenderTarget();
+		bool initSelectedRenderTarget(utility::ErrorState& errorState);
 
 		EntityInstance* getSelected() { return mSelected; }
 
+		/**
+		 * @return canvas of the selected entity
+		 */
+		RenderCanvasComponentInstance* getSelectedCanvas()								{ return mSelectedCanvas; }
+
 		ResourcePtr<RenderTarget>					mSelectedRenderTarget;
 		ResourcePtr<RenderTexture2D>				mSelectedOutputTexture;
 		bool										mDrawBackdrop = false;
+		bool										mDrawComposition = false;		///< If the entire virtual canvas space is drawn this frame, canvases outside of the outputs are then kept
+		bool										mDrawFromSnapshot = false;		///< If the outputs and the composition draw a snapshot captured at the end of update(), edits made after it show next frame
 
 	protected:
 		virtual void trigger(const nap::InputEvent& inEvent) override;
@@ -61,10 +152,92 @@ namespace nap
 		RenderService*								mRenderService = nullptr;
 		ResourcePtr<SequenceEditorGUI>				mSequenceEditorGUI = nullptr;
 		ResourcePtr<SequenceEditor>					mSequenceEditor = nullptr;
-		std::vector<RenderCanvasComponentInstance*> mCanvases;
+		CanvasRegistry*								mCanvasRegistry = nullptr;		///< All canvases, laid out and culled from its arrays
+		std::vector<RenderCanvasComponentInstance*>	mCanvases;						///< Canvases of the group, in draw order
+		std::vector<int>							mCanvasSlots;					///< Registry slot of every canvas of the group, -1 while a reload replaces it
 		EntityInstance*								mSelected = nullptr;
+		RenderCanvasComponentInstance*				mSelectedCanvas = nullptr;
+
+		std::unique_ptr<CanvasCommandRecorder>		mRecorder = nullptr;			///< Records the headless passes on multiple threads, null when recording inline
+		std::vector<CanvasCommandRecorder::Packet>	mHeadlessPackets;				///< Prepared headless passes of all canvases, in canvas order
+		double										mHeadlessRecordTime = 0.0;		///< CPU time in seconds spent preparing and recording the headless passes
+		int											mRecordBenchmarkIterations = 0;	///< Times the next frame records its headless passes serially and in parallel, 0 when no benchmark is requested
+		double										mRecordBenchmarkSerial = 0.0;	///< Seconds to record the headless passes of a frame on one thread, last benchmark
+		double										mRecordBenchmarkParallel = 0.0;	///< Seconds to record the headless passes of a frame on all recording threads, last benchmark
+		SequenceCurveBindings						mCurveBindings;					///< Sequence curves bound to properties of all canvases
+		std::vector<SequenceCanvasComponentInstance*> mSequenceCanvases;			///< Canvases with a sequence, cues are applied in this order
+		std::vector<ResourcePtr<CanvasOutput>>		mOutputs;
+		glm::ivec2									mVirtualSize;
+		std::vector<std::vector<int>>				mVisibleCanvases;				///< Indices of the canvases that intersect each output, in draw order
+		std::vector<int>							mActiveCanvases;				///< Indices of the canvases that survived culling, in draw order
+		CullStats									mCullStats;
+		CanvasUpdateScheduler						mScheduler;						///< Staggers the canvases with a reduced update rate over the frames
+		std::vector<int>							mUpdatePeriods;					///< Frames between updates of every canvas, input of the scheduler
+		std::vector<float>							mUpdateCosts;					///< Estimated headless cost of every canvas in megapixels, input of the scheduler
+		std::vector<int>							mScheduledCanvases;				///< Indices of the active canvases that render this frame, in draw order
+		uint64										mHeadlessFrame = 0;				///< Frames drawn headless, the position in the schedule
+		double										mFrameInterval = 1.0 / 60.0;	///< Smoothed frame interval in seconds, converts Hz rates to periods
+		int											mDeferredCount = 0;				///< Active canvases that weren't due this frame
+		std::vector<float>							mHeadlessLoads = std::vector<float>(120, 0.0f);	///< Megapixels rendered headless in the last frames, ring buffer
+		int											mHeadlessLoadIndex = 0;
+		std::unordered_map<VideoPlayer*, std::unique_ptr<VideoLadder>> mVideoLadders;	///< Resolution ladder of every video player, shared by the canvases that play it
+		CanvasSnapshotBuffer						mSnapshots;						///< Written by update(), read by drawOutput() and drawComposition()
+		uint64										mSnapshotCount = 0;				///< Snapshots captured
+		bool										mSnapshotCaptured = false;		///< If the last update captured a snapshot, the outputs draw the live state otherwise
+
+		float										mMemoryBudget = 0.0f;
+		MetricCounter*								mHeadlessPassCounter = nullptr;
+		MetricCounter*								mDeferredCanvasCounter = nullptr;
+		MetricGauge*								mCanvasGauge = nullptr;
+		MetricGauge*								mCulledCanvasGauge = nullptr;
+		// Corner or edge of the selected canvas that is dragged with the pointer, edges move both their corners
+		struct CornerDrag
+		{
+			int										mCorners[2] = { -1, -1 };		///< Dragged corners, the second is -1 when dragging a corner
+			glm::vec2								mStart = { 0.0f, 0.0f };		///< Pointer position on press
+			glm::vec2								mPosition = { 0.0f, 0.0f };		///< Latest pointer position, applied once per frame
+			glm::vec2								mCanvasSize = { 1.0f, 1.0f };	///< Canvas size in window pixels
+			std::vector<glm::vec2>					mStartOffsets = std::vector<glm::vec2>(4);
+			std::vector<glm::vec2>					mOffsets = std::vector<glm::vec2>(4);
+			bool									mActive = false;
+			bool									mDirty = false;					///< If the pointer moved since the last update
+		};
+
+		// Pointer events handled in the last frame, fed by the stress test or the window
+		struct DragStats
+		{
+			int										mEvents = 0;					///< Synthetic events fed this frame
+			int										mUpdates = 0;					///< Corner updates this frame, at most one
+			double									mTriggerTime = 0.0;				///< Seconds spent handling the synthetic events
+			double									mPending = 0.0;					///< Fraction of an event carried to the next frame
+			double									mPhase = 0.0;
+			glm::vec2								mCenter = { 0.0f, 0.0f };
+		};
+
+		CornerDrag									mCornerDrag;
+		DragStats									mDragStats;
+		bool										mDragStressTest = false;		///< Feeds synthetic pointer events at 1 kHz
+		bool										mCycleMasks = false;							///< Selects the next mask file of the selected canvas every frame
+		std::vector<double>							mFrameTimes = std::vector<double>(120, 0.0);	///< Frame times of the last frames, ring buffer
+		int											mFrameTimeIndex = 0;
+
+		void drawGpuMemory();
+		void drawSchedule();
+		void benchmarkRecording();
+		void updateCanvasSlots();
+		void scheduleCanvases();
+		void requestVideoLines(RenderCanvasComponentInstance& canvas, float lines);
+		void cullCanvases();
+		bool isOnScreen(const glm::vec4& bounds) const;
+		bool isOccluded(int index) const;
+		void drawCanvases(IRenderTarget& target, const std::vector<int>& indices, const glm::vec4& region, CanvasOutput* output, const OrthoCameraComponentInstance& camera);
+		void drawCanvases(IRenderTarget& target, const std::vector<CanvasFrameSnapshot::Draw>& draws, const glm::vec4& region, CanvasOutput* output, const OrthoCameraComponentInstance& camera);
+		void captureSnapshot();
 		
-		std::vector<glm::i16vec2> calculateScreenSpacePosition(EntityInstance* entity);
+		void calculateScreenSpacePosition(EntityInstance* entity, std::array<glm::vec2, 4>& outCorners, glm::vec2& outCanvasSize);
+		void select(EntityInstance* entity);
+		void applyCornerDrag();
+		void feedDragStressEvents(double deltaTime);
 
 	};
 }
\ No newline at end of file
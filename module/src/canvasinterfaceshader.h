@@ -5,16 +5,11 @@
 
 #pragma once
 
- // External Includes
-#include <shader.h>
+ // Local Includes
+#include "stockshader.h"
 
 namespace nap
 {
-	// Forward declares
-	class Core;
-	class RenderService;
-	class FoglioService;
-
 	// canvas shader sampler names 
 	namespace uniform
 	{
@@ -32,21 +27,10 @@ namespace nap
 	}
 
 
-	class NAPAPI CanvasInterfaceShader : public Shader
+	class NAPAPI CanvasInterfaceShader : public StockShader
 	{
-		RTTI_ENABLE(Shader)
+		RTTI_ENABLE(StockShader)
 	public:
 		CanvasInterfaceShader(Core& core);
-
-		/**
-		 * Cross compiles the canvas GLSL shader code to SPIR-V, creates the shader module and parses all the uniforms and samplers.
-		 * @param errorState contains the error if initialization fails.
-		 * @return if initialization succeeded.
-		 */
-		virtual bool init(utility::ErrorState& errorState) override;
-
-	private:
-		RenderService* mRenderService = nullptr;
-		FoglioService* mFoglioService = nullptr;
 	};
 }
\ No newline at end of file
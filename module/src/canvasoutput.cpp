@@ -0,0 +1,76 @@
+// Local Includes
+#include "canvasoutput.h"
+
+// External Includes
+#include <nap/core.h>
+#include <cmath>
+#include <vector>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::CanvasOutput)
+	RTTI_CONSTRUCTOR(nap::Core&)
+	RTTI_PROPERTY("Window",		&nap::CanvasOutput::mWindow,	nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Region",		&nap::CanvasOutput::mRegion,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Viewport",	&nap::CanvasOutput::mViewport,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("BlendEdges",	&nap::CanvasOutput::mBlendEdges,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("BlendGamma",	&nap::CanvasOutput::mBlendGamma,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("BlendCurve",	&nap::CanvasOutput::mBlendCurve,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+	CanvasOutput::CanvasOutput(Core& core) :
+		mCore(core)
+	{ }
+
+
+	bool CanvasOutput::init(utility::ErrorState& errorState)
+	{
+		if (!errorState.check(mRegion.z > 0.0f && mRegion.w > 0.0f, "%s: region is empty", mID.c_str()))
+			return false;
+		if (!errorState.check(mViewport.z > 0.0f && mViewport.w > 0.0f, "%s: viewport is empty", mID.c_str()))
+			return false;
+		if (!errorState.check(mBlendGamma > 0.0f && mBlendCurve > 0.0f, "%s: blend gamma and curve must be positive", mID.c_str()))
+			return false;
+		bool valid_edges = mBlendEdges.x >= 0.0f && mBlendEdges.y >= 0.0f && mBlendEdges.z >= 0.0f && mBlendEdges.w >= 0.0f &&
+			mBlendEdges.x + mBlendEdges.y <= 1.0f && mBlendEdges.z + mBlendEdges.w <= 1.0f;
+		if (!errorState.check(valid_edges, "%s: blend edges overlap or are negative", mID.c_str()))
+			return false;
+
+		// Symmetric ramp, overlapping outputs add up to 1 in linear light: the projector gamma is inverted
+		std::vector<uint16> ramp(blendLutSize);
+		for (int i = 0; i < blendLutSize; i++)
+		{
+			float x = static_cast<float>(i) / static_cast<float>(blendLutSize - 1);
+			float linear = x < 0.5f ?
+				0.5f * std::pow(2.0f * x, mBlendCurve) :
+				1.0f - 0.5f * std::pow(2.0f * (1.0f - x), mBlendCurve);
+			ramp[i] = static_cast<uint16>(std::round(std::pow(linear, 1.0f / mBlendGamma) * 65535.0f));
+		}
+
+		mBlendLut = std::make_unique<Texture2D>(mCore);
+		mBlendLut->mID = mID + "_blendlut";
+		SurfaceDescriptor descriptor(blendLutSize, 1, ESurfaceDataType::USHORT, ESurfaceChannels::R);
+		return mBlendLut->init(descriptor, false, ramp.data(), errorState);
+	}
+
+
+	glm::vec4 CanvasOutput::getRegionBounds(const glm::ivec2& virtualSize) const
+	{
+		glm::vec2 size(virtualSize);
+		return { mRegion.x * size.x, mRegion.y * size.y, (mRegion.x + mRegion.z) * size.x, (mRegion.y + mRegion.w) * size.y };
+	}
+
+
+	VkViewport CanvasOutput::getViewport() const
+	{
+		glm::vec2 size(mWindow->getBufferSize());
+		return { mViewport.x * size.x, mViewport.y * size.y, mViewport.z * size.x, mViewport.w * size.y, 0.0f, 1.0f };
+	}
+
+
+	bool CanvasOutput::intersects(const glm::vec4& bounds, const glm::ivec2& virtualSize) const
+	{
+		glm::vec4 region = getRegionBounds(virtualSize);
+		return bounds.x < region.z && bounds.z > region.x && bounds.y < region.w && bounds.w > region.y;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+// External Includes
+#include <nap/resource.h>
+#include <nap/resourceptr.h>
+#include <renderwindow.h>
+#include <texture2d.h>
+#include <glm/glm.hpp>
+
+namespace nap
+{
+	/**
+	 * A single projector output: a region of the shared virtual canvas space shown in (part of) a window.
+	 * Multiple outputs can share a window, each drawing into its own viewport.
+	 * Regions and viewports are normalized, the region origin is bottom left, the viewport origin top left.
+	 *
+	 * Edges that overlap with other projectors are blended with a ramp, applied by the canvas warp shader while the canvases are drawn.
+	 * The ramp is gamma corrected and precomputed into a small lookup texture, so blending doesn't need an additional pass.
+	 */
+	class NAPAPI CanvasOutput : public Resource
+	{
+		RTTI_ENABLE(Resource)
+	public:
+		static constexpr int blendLutSize = 256;
+
+		CanvasOutput(Core& core);
+
+		/**
+		 * Validates the region and viewport and creates the blend lookup texture.
+		 * @param errorState contains the error if the output is invalid
+		 * @return if initialization succeeded
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+		/**
+		 * @return the edge blend ramp, indexed by the normalized position within a blend edge
+		 */
+		Texture2D& getBlendLut()									{ return *mBlendLut; }
+
+		/**
+		 * @param virtualSize size of the virtual canvas space in pixels
+		 * @return region in virtual pixels: min x, min y, max x, max y
+		 */
+		glm::vec4 getRegionBounds(const glm::ivec2& virtualSize) const;
+
+		/**
+		 * @return viewport in window pixels
+		 */
+		VkViewport getViewport() const;
+
+		/**
+		 * @return if the given bounds, in virtual pixels, intersect the region of this output
+		 */
+		bool intersects(const glm::vec4& bounds, const glm::ivec2& virtualSize) const;
+
+		ResourcePtr<RenderWindow>	mWindow = nullptr;						///< Property: 'Window' window the output is drawn in
+		glm::vec4					mRegion = { 0.0f, 0.0f, 1.0f, 1.0f };	///< Property: 'Region' x, y, width and height of the virtual canvas space shown by this output
+		glm::vec4					mViewport = { 0.0f, 0.0f, 1.0f, 1.0f };	///< Property: 'Viewport' x, y, width and height of the window this output draws into
+		glm::vec4					mBlendEdges = { 0.0f, 0.0f, 0.0f, 0.0f };	///< Property: 'BlendEdges' left, right, bottom and top blend width relative to the viewport, 0 disables an edge
+		float						mBlendGamma = 2.2f;						///< Property: 'BlendGamma' gamma of the projector, the ramp is corrected for it
+		float						mBlendCurve = 2.0f;						///< Property: 'BlendCurve' steepness of the ramp around its center, 1 is linear
+
+	private:
+		Core&						mCore;
+		std::unique_ptr<Texture2D>	mBlendLut;
+	};
+}
@@ -0,0 +1,148 @@
+// Local Includes
+#include "canvasregistry.h"
+#include "rendercanvascomponent.h"
+
+// External Includes
+#include <algorithm>
+
+namespace nap
+{
+	template<typename T>
+	static void permute(std::vector<T>& values, const std::vector<int>& order)
+	{
+		std::vector<T> permuted;
+		permuted.reserve(values.size());
+		for (int index : order)
+			permuted.emplace_back(std::move(values[index]));
+		values = std::move(permuted);
+	}
+
+
+	void CanvasRegistry::add(const std::string& id, RenderCanvasComponentInstance& canvas)
+	{
+		auto it = mIndices.find(id);
+		if (it != mIndices.end())
+		{
+			int index = it->second;
+			if (mCanvases[index] != &canvas)
+			{
+				mReplaced[index] = mCanvases[index];
+				mReplaced[index]->mRegistryIndex = -1;
+			}
+			setSlot(index, canvas);
+			return;
+		}
+
+		int index = getCount();
+		mIndices.emplace(id, index);
+		mIDs.emplace_back(id);
+		mCanvases.emplace_back(nullptr);
+		mReplaced.emplace_back(nullptr);
+		mRenderables.emplace_back(nullptr);
+		mModelMatrices.emplace_back(1.0f);
+		mBounds.emplace_back(0.0f);
+		mOccluderBounds.emplace_back(0.0f);
+		mFlags.emplace_back(0);
+		mPassCounts.emplace_back(0);
+		setSlot(index, canvas);
+	}
+
+
+	void CanvasRegistry::remove(const std::string& id, RenderCanvasComponentInstance& canvas)
+	{
+		auto it = mIndices.find(id);
+		if (it == mIndices.end())
+			return;
+
+		int index = it->second;
+		if (mReplaced[index] == &canvas)
+		{
+			mReplaced[index] = nullptr;
+		}
+		else if (mCanvases[index] == &canvas)
+		{
+			canvas.mRegistryIndex = -1;
+			RenderCanvasComponentInstance* replaced = mReplaced[index];
+			mReplaced[index] = nullptr;
+			if (replaced != nullptr)
+				setSlot(index, *replaced);
+			else
+				erase(index);
+		}
+	}
+
+
+	RenderCanvasComponentInstance* CanvasRegistry::find(const std::string& id) const
+	{
+		auto it = mIndices.find(id);
+		return it != mIndices.end() ? mCanvases[it->second] : nullptr;
+	}
+
+
+	void CanvasRegistry::sort(const std::vector<std::string>& ids)
+	{
+		std::vector<int> order;
+		std::vector<bool> placed(mCanvases.size(), false);
+		order.reserve(mCanvases.size());
+		for (const auto& id : ids)
+		{
+			auto it = mIndices.find(id);
+			if (it == mIndices.end() || placed[it->second])
+				continue;
+			order.emplace_back(it->second);
+			placed[it->second] = true;
+		}
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			if (!placed[i])
+				order.emplace_back(i);
+		}
+
+		permute(mIDs, order);
+		permute(mCanvases, order);
+		permute(mReplaced, order);
+		permute(mRenderables, order);
+		permute(mModelMatrices, order);
+		permute(mBounds, order);
+		permute(mOccluderBounds, order);
+		permute(mFlags, order);
+		permute(mPassCounts, order);
+		for (int i = 0; i < mCanvases.size(); i++)
+		{
+			mIndices[mIDs[i]] = i;
+			mCanvases[i]->mRegistryIndex = i;
+		}
+	}
+
+
+	void CanvasRegistry::setSlot(int index, RenderCanvasComponentInstance& canvas)
+	{
+		// Structure dependent state is captured here, the per frame state is written by the canvas group
+		canvas.mRegistryIndex = index;
+		mCanvases[index] = &canvas;
+		mRenderables[index] = &canvas;
+		mPassCounts[index] = canvas.getHeadlessPassCount();
+		mFlags[index] = (canvas.isVisible() ? flagVisible : 0) | (canvas.isOpaque() ? flagOpaque : 0) | (canvas.hasPublisher() ? flagPublished : 0);
+	}
+
+
+	void CanvasRegistry::erase(int index)
+	{
+		// Stable, the remaining canvases keep their draw order
+		mIndices.erase(mIDs[index]);
+		mIDs.erase(mIDs.begin() + index);
+		mCanvases.erase(mCanvases.begin() + index);
+		mReplaced.erase(mReplaced.begin() + index);
+		mRenderables.erase(mRenderables.begin() + index);
+		mModelMatrices.erase(mModelMatrices.begin() + index);
+		mBounds.erase(mBounds.begin() + index);
+		mOccluderBounds.erase(mOccluderBounds.begin() + index);
+		mFlags.erase(mFlags.begin() + index);
+		mPassCounts.erase(mPassCounts.begin() + index);
+		for (int i = index; i < mCanvases.size(); i++)
+		{
+			mIndices[mIDs[i]] = i;
+			mCanvases[i]->mRegistryIndex = i;
+		}
+	}
+}
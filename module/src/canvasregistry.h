@@ -0,0 +1,115 @@
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nap
+{
+	// Forward declares
+	class RenderCanvasComponentInstance;
+	class RenderableComponentInstance;
+
+	/**
+	 * All live canvases, in draw order, with the state that is read every frame stored in contiguous arrays.
+	 * Canvases add themselves on init and remove themselves on destruction, the canvas group lays out,
+	 * culls and draws the canvases from the arrays, without walking entities or looking up components.
+	 * A canvas is registered under its entity ID, at most one canvas per ID is live.
+	 * A canvas that registers under a taken ID, the new instance on reload, takes over the slot of the previous canvas.
+	 * The previous canvas gets its slot back when the new one is destroyed first, as happens when a reload fails.
+	 */
+	class NAPAPI CanvasRegistry
+	{
+	public:
+		static constexpr uint8 flagVisible = 1 << 0;		///< The canvas is visible
+		static constexpr uint8 flagOpaque = 1 << 1;			///< The canvas output is opaque, it hides canvases drawn below it
+		static constexpr uint8 flagPublished = 1 << 2;		///< The canvas output is published, it is never culled
+
+		/**
+		 * Registers a canvas under its entity ID, the canvas takes over the slot of the canvas registered under that ID.
+		 * Call again when the state captured on registration changes, e.g. when the canvas adopts the structure of another.
+		 * @param id entity ID
+		 * @param canvas the canvas
+		 */
+		void add(const std::string& id, RenderCanvasComponentInstance& canvas);
+
+		/**
+		 * Removes a canvas from the registry, if it is still registered under the ID.
+		 * The canvas it replaced, if any, gets its slot back.
+		 * @param id entity ID
+		 * @param canvas the canvas
+		 */
+		void remove(const std::string& id, RenderCanvasComponentInstance& canvas);
+
+		/**
+		 * @param id entity ID
+		 * @return the canvas registered under the ID, nullptr if there is none
+		 */
+		RenderCanvasComponentInstance* find(const std::string& id) const;
+
+		/**
+		 * Moves the canvases with the given IDs to the front, in the given order.
+		 * Canvases register in init order, the canvas group restores its draw order after a reload.
+		 * @param ids entity IDs in draw order
+		 */
+		void sort(const std::vector<std::string>& ids);
+
+		/**
+		 * @return number of registered canvases
+		 */
+		int getCount() const																{ return static_cast<int>(mCanvases.size()); }
+
+		/**
+		 * @return all canvases, in draw order
+		 */
+		const std::vector<RenderCanvasComponentInstance*>& getCanvases() const				{ return mCanvases; }
+
+		/**
+		 * @return all canvases as renderable components, in draw order
+		 */
+		const std::vector<RenderableComponentInstance*>& getRenderables() const			{ return mRenderables; }
+
+		/**
+		 * @return model matrix of every canvas in the virtual canvas space
+		 */
+		std::vector<glm::mat4>& getModelMatrices()											{ return mModelMatrices; }
+
+		/**
+		 * @return bounds of every warped canvas in virtual pixels: min x, min y, max x, max y
+		 */
+		std::vector<glm::vec4>& getBounds()													{ return mBounds; }
+
+		/**
+		 * @return rectangle covered by every warped canvas in virtual pixels, empty (min > max) when the quad is flipped or folded
+		 */
+		std::vector<glm::vec4>& getOccluderBounds()											{ return mOccluderBounds; }
+
+		/**
+		 * @return flags of every canvas, see flagVisible and friends
+		 */
+		std::vector<uint8>& getFlags()														{ return mFlags; }
+
+		/**
+		 * @return number of headless passes every canvas records per frame
+		 */
+		const std::vector<int>& getPassCounts() const										{ return mPassCounts; }
+
+	private:
+		void setSlot(int index, RenderCanvasComponentInstance& canvas);
+		void erase(int index);
+
+		std::unordered_map<std::string, int>			mIndices;			///< Slot of every entity ID
+		std::vector<std::string>						mIDs;
+		std::vector<RenderCanvasComponentInstance*>		mCanvases;
+		std::vector<RenderCanvasComponentInstance*>		mReplaced;			///< Canvas the slot belonged to before a reload, nullptr when there is none
+		std::vector<RenderableComponentInstance*>		mRenderables;
+		std::vector<glm::mat4>							mModelMatrices;
+		std::vector<glm::vec4>							mBounds;
+		std::vector<glm::vec4>							mOccluderBounds;
+		std::vector<uint8>								mFlags;
+		std::vector<int>								mPassCounts;
+	};
+}
@@ -0,0 +1,213 @@
+// Local Includes
+#include "canvasrendergraph.h"
+
+// External Includes
+#include <algorithm>
+#include <unordered_map>
+
+RTTI_BEGIN_ENUM(nap::ECanvasPassType)
+	RTTI_ENUM_VALUE(nap::ECanvasPassType::Video,	"Video"),
+	RTTI_ENUM_VALUE(nap::ECanvasPassType::Shader,	"Shader"),
+	RTTI_ENUM_VALUE(nap::ECanvasPassType::Mask,		"Mask")
+RTTI_END_ENUM
+
+RTTI_BEGIN_ENUM(nap::ECanvasTextureFormat)
+	RTTI_ENUM_VALUE(nap::ECanvasTextureFormat::Auto,	"Auto"),
+	RTTI_ENUM_VALUE(nap::ECanvasTextureFormat::R8,		"R8"),
+	RTTI_ENUM_VALUE(nap::ECanvasTextureFormat::RGBA8,	"RGBA8"),
+	RTTI_ENUM_VALUE(nap::ECanvasTextureFormat::RGBA16,	"RGBA16"),
+	RTTI_ENUM_VALUE(nap::ECanvasTextureFormat::RGBA32,	"RGBA32")
+RTTI_END_ENUM
+
+RTTI_BEGIN_STRUCT(nap::CanvasPassNode)
+	RTTI_PROPERTY("Name",		&nap::CanvasPassNode::mName,		nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Type",		&nap::CanvasPassNode::mType,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Material",	&nap::CanvasPassNode::mMaterial,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Inputs",		&nap::CanvasPassNode::mInputs,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Samplers",	&nap::CanvasPassNode::mSamplers,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Format",		&nap::CanvasPassNode::mFormat,		nap::rtti::EPropertyMetaData::Default)
+RTTI_END_STRUCT
+
+namespace nap
+{
+	bool CanvasRenderGraph::compile(const std::vector<CanvasPassNode>& nodes, const std::string& output, const std::vector<bool>& opaque, const std::vector<bool>& external, ECanvasTextureFormat outputFormat, utility::ErrorState& errorState)
+	{
+		mSteps.clear();
+		mCulledNodes.clear();
+		mTargetFormats.clear();
+		mOutputFormat = outputFormat == ECanvasTextureFormat::Auto ? ECanvasTextureFormat::RGBA8 : outputFormat;
+		if (nodes.empty())
+			return true;
+
+		// Resolve names
+		std::unordered_map<std::string, int> node_map;
+		for (int i = 0; i < nodes.size(); i++)
+		{
+			if (!errorState.check(node_map.emplace(nodes[i].mName, i).second, "duplicate pass name: %s", nodes[i].mName.c_str()))
+				return false;
+		}
+
+		std::vector<std::vector<int>> inputs(nodes.size());
+		for (int i = 0; i < nodes.size(); i++)
+		{
+			const CanvasPassNode& node = nodes[i];
+			if (!errorState.check(node.mSamplers.empty() || node.mSamplers.size() == node.mInputs.size(), "%s: number of samplers doesn't match number of inputs", node.mName.c_str()))
+				return false;
+			if (!errorState.check(node.mSamplers.size() == node.mInputs.size() || node.mInputs.size() <= 1, "%s: multiple inputs require a sampler for every input", node.mName.c_str()))
+				return false;
+			if (!errorState.check(node.mType != ECanvasPassType::Video || node.mInputs.empty(), "%s: video pass can't have inputs", node.mName.c_str()))
+				return false;
+			if (!errorState.check(node.mType != ECanvasPassType::Mask || node.mInputs.size() == 1, "%s: mask pass requires a single input", node.mName.c_str()))
+				return false;
+			if (!errorState.check(node.mType != ECanvasPassType::Shader || node.mMaterial != nullptr, "%s: shader pass requires a material", node.mName.c_str()))
+				return false;
+
+			for (const auto& input : node.mInputs)
+			{
+				auto it = node_map.find(input);
+				if (!errorState.check(it != node_map.end(), "%s: unknown input pass: %s", node.mName.c_str(), input.c_str()))
+					return false;
+				inputs[i].emplace_back(it->second);
+			}
+		}
+
+		int output_node = static_cast<int>(nodes.size()) - 1;
+		if (!output.empty())
+		{
+			auto it = node_map.find(output);
+			if (!errorState.check(it != node_map.end(), "unknown output pass: %s", output.c_str()))
+				return false;
+			output_node = it->second;
+		}
+
+		// Cull every node the output doesn't depend on
+		std::vector<bool> live(nodes.size(), false);
+		std::vector<int> stack = { output_node };
+		while (!stack.empty())
+		{
+			int node = stack.back();
+			stack.pop_back();
+			if (live[node])
+				continue;
+			live[node] = true;
+			stack.insert(stack.end(), inputs[node].begin(), inputs[node].end());
+		}
+		for (int i = 0; i < nodes.size(); i++)
+		{
+			if (!live[i])
+				mCulledNodes.emplace_back(i);
+		}
+
+		// Topological sort, ties are resolved in declaration order so a plain list executes as written
+		std::vector<int> pending_inputs(nodes.size(), 0);
+		std::vector<std::vector<int>> readers(nodes.size());
+		for (int i = 0; i < nodes.size(); i++)
+		{
+			if (!live[i])
+				continue;
+			pending_inputs[i] = static_cast<int>(inputs[i].size());
+			for (int input : inputs[i])
+				readers[input].emplace_back(i);
+		}
+
+		std::vector<int> order;
+		std::vector<bool> scheduled(nodes.size(), false);
+		while (true)
+		{
+			int next = -1;
+			for (int i = 0; i < nodes.size() && next < 0; i++)
+			{
+				if (live[i] && !scheduled[i] && pending_inputs[i] == 0)
+					next = i;
+			}
+			if (next < 0)
+				break;
+			scheduled[next] = true;
+			order.emplace_back(next);
+			for (int reader : readers[next])
+				pending_inputs[reader]--;
+		}
+		if (!errorState.check(order.size() + mCulledNodes.size() == nodes.size(), "canvas render graph contains a cycle"))
+			return false;
+
+		// Last step that reads the output of each node
+		std::vector<int> last_read(nodes.size(), -1);
+		for (int step = 0; step < order.size(); step++)
+		{
+			for (int input : inputs[order[step]])
+				last_read[input] = step;
+		}
+
+		// Resolve formats in execution order, automatic formats keep the precision of their inputs.
+		// Video and mask passes output color, so they never go below RGBA8.
+		std::vector<ECanvasTextureFormat> formats(nodes.size(), ECanvasTextureFormat::RGBA8);
+		for (int node : order)
+		{
+			ECanvasTextureFormat format = nodes[node].mFormat;
+			if (format == ECanvasTextureFormat::Auto)
+			{
+				format = ECanvasTextureFormat::RGBA8;
+				for (int input : inputs[node])
+					format = std::max(format, formats[input]);
+			}
+			formats[node] = format;
+		}
+		if (outputFormat == ECanvasTextureFormat::Auto)
+			mOutputFormat = std::max(formats[output_node], ECanvasTextureFormat::RGBA8);
+		formats[output_node] = mOutputFormat;
+
+		// Assign targets, an intermediate target returns to the pool after the last step that reads it.
+		// Targets are released after the step allocated its own target, so a step never writes what it reads.
+		std::vector<int> node_target(nodes.size(), finalTarget);
+		std::vector<int> free_targets;
+		for (int step = 0; step < order.size(); step++)
+		{
+			int node = order[step];
+			if (node != output_node && node < external.size() && external[node])
+			{
+				node_target[node] = externalTarget;
+				continue;
+			}
+
+			int target = finalTarget;
+			if (node != output_node)
+			{
+				auto it = std::find_if(free_targets.rbegin(), free_targets.rend(), [&](int free) { return mTargetFormats[free] == formats[node]; });
+				if (it == free_targets.rend())
+				{
+					target = static_cast<int>(mTargetFormats.size());
+					mTargetFormats.emplace_back(formats[node]);
+				}
+				else
+				{
+					target = *it;
+					free_targets.erase(std::next(it).base());
+				}
+			}
+			node_target[node] = target;
+
+			Step plan_step;
+			plan_step.mNode = node;
+			plan_step.mTarget = target;
+			plan_step.mFormat = formats[node];
+			plan_step.mClear = node >= opaque.size() || !opaque[node];
+			for (int i = 0; i < inputs[node].size(); i++)
+			{
+				const std::string& sampler = nodes[node].mSamplers.empty() ? std::string("inTexture") : nodes[node].mSamplers[i];
+				plan_step.mInputs.push_back({ node_target[inputs[node][i]], inputs[node][i], sampler });
+			}
+			mSteps.emplace_back(std::move(plan_step));
+
+			for (int input : inputs[node])
+			{
+				// Release once, a node can read the same input through multiple samplers
+				if (last_read[input] == step && node_target[input] >= 0)
+				{
+					free_targets.emplace_back(node_target[input]);
+					last_read[input] = -1;
+				}
+			}
+		}
+		return true;
+	}
+}
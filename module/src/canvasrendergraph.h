@@ -0,0 +1,125 @@
+#pragma once
+
+// External Includes
+#include <nap/resourceptr.h>
+#include <material.h>
+#include <utility/errorstate.h>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Kind of work a canvas pass node does
+	 */
+	enum class ECanvasPassType : int
+	{
+		Video	= 0,	///< Frames of the canvas video player or image sequence, YUV frames are converted to RGBA, has no inputs
+		Shader	= 1,	///< Renders a custom material, inputs are bound to the material samplers
+		Mask	= 2		///< Applies the canvas mask image to its single input
+	};
+
+
+	/**
+	 * Texture format of a canvas pass output, ordered by precision
+	 */
+	enum class ECanvasTextureFormat : int
+	{
+		Auto	= 0,	///< Derived from the pass chain: at least RGBA8 and at least the precision of every input
+		R8		= 1,	///< Single 8 bit channel, for masks and other single channel intermediates
+		RGBA8	= 2,	///< 8 bit per channel color
+		RGBA16	= 3,	///< 16 bit normalized per channel color, for precision in grading chains
+		RGBA32	= 4		///< 32 bit float per channel color, for values outside of 0-1
+	};
+
+
+	/**
+	 * Declares a single pass of the canvas render graph.
+	 * Passes read the outputs of other passes by name, which allows chains and DAGs of post shaders.
+	 */
+	struct NAPAPI CanvasPassNode
+	{
+		std::string					mName;								///< Property: 'Name' unique name, used by other nodes to read the output of this node
+		ECanvasPassType				mType = ECanvasPassType::Shader;	///< Property: 'Type' kind of pass
+		ResourcePtr<Material>		mMaterial = nullptr;				///< Property: 'Material' material to render, Shader passes only
+		std::vector<std::string>	mInputs;							///< Property: 'Inputs' names of the nodes this node samples
+		std::vector<std::string>	mSamplers;							///< Property: 'Samplers' sampler each input is bound to, defaults to 'inTexture' for a single input
+		ECanvasTextureFormat		mFormat = ECanvasTextureFormat::Auto;	///< Property: 'Format' format of the pass output, ignored by the output pass
+	};
+
+
+	/**
+	 * Execution plan of a canvas render graph.
+	 * Compiling sorts the nodes topologically, culls every node that doesn't contribute to the output
+	 * and assigns render targets based on the lifetime of each output: a target is reused as soon as
+	 * its last reader has executed, which results in the minimum number of intermediate targets.
+	 * Targets are only shared by passes with the same output format.
+	 * External nodes already have their output in a texture, they don't execute: their readers sample that texture.
+	 */
+	class NAPAPI CanvasRenderGraph
+	{
+	public:
+		static constexpr int finalTarget = -1;		///< Target index of the canvas output texture
+		static constexpr int externalTarget = -2;	///< Target index of an external node, the reader binds the texture of the node
+
+		struct Input
+		{
+			int			mTarget;					///< Target the input reads from, or externalTarget
+			int			mNode;						///< Index of the node the input reads
+			std::string	mSampler;					///< Sampler the target is bound to
+		};
+
+		struct Step
+		{
+			int					mNode;				///< Index of the node in the declaration
+			int					mTarget;			///< Intermediate target index, or finalTarget
+			std::vector<Input>	mInputs;			///< Targets this step reads
+			bool				mClear;				///< If the target needs to be cleared, false when the pass overwrites every pixel
+			ECanvasTextureFormat mFormat;			///< Resolved format of the pass output, never Auto
+		};
+
+		/**
+		 * Compiles the graph into an execution plan.
+		 * @param nodes declared nodes
+		 * @param output name of the node that renders into the canvas output, the last node when empty
+		 * @param opaque per node, if the pass overwrites every pixel of its target (opaque blending)
+		 * @param external per node, if its output is an existing texture. The output node always executes.
+		 * @param outputFormat format of the canvas output, Auto derives it from the output pass
+		 * @param errorState contains the error if the graph is invalid
+		 * @return if the graph compiled
+		 */
+		bool compile(const std::vector<CanvasPassNode>& nodes, const std::string& output, const std::vector<bool>& opaque, const std::vector<bool>& external, ECanvasTextureFormat outputFormat, utility::ErrorState& errorState);
+
+		/**
+		 * @return the steps to execute, in order
+		 */
+		const std::vector<Step>& getSteps() const						{ return mSteps; }
+
+		/**
+		 * @return number of intermediate targets the plan requires
+		 */
+		int getIntermediateTargetCount() const							{ return static_cast<int>(mTargetFormats.size()); }
+
+		/**
+		 * @param index intermediate target index
+		 * @return format of an intermediate target
+		 */
+		ECanvasTextureFormat getIntermediateTargetFormat(int index) const	{ return mTargetFormats[index]; }
+
+		/**
+		 * @return resolved format of the canvas output, RGBA8 when the graph is empty
+		 */
+		ECanvasTextureFormat getOutputFormat() const					{ return mOutputFormat; }
+
+		/**
+		 * @return indices of nodes that were culled because their output is never used
+		 */
+		const std::vector<int>& getCulledNodes() const					{ return mCulledNodes; }
+
+	private:
+		std::vector<Step>	mSteps;
+		std::vector<int>	mCulledNodes;
+		std::vector<ECanvasTextureFormat> mTargetFormats;
+		ECanvasTextureFormat mOutputFormat = ECanvasTextureFormat::RGBA8;
+	};
+}
@@ -0,0 +1,146 @@
+// Local Includes
+#include "canvasrendertarget.h"
+
+// External Includes
+#include <renderservice.h>
+#include <array>
+
+namespace nap
+{
+	CanvasRenderTarget::CanvasRenderTarget(RenderService& renderService) :
+		mRenderService(renderService)
+	{ }
+
+
+	CanvasRenderTarget::~CanvasRenderTarget()
+	{
+		// The GPU might still be using the pass, destroy after the frame completed
+		std::array<VkRenderPass, 2> render_passes = { mRenderPass, mRenderPassNoClear };
+		VkFramebuffer framebuffer = mFramebuffer;
+		mRenderService.queueVulkanObjectDestructor([render_passes, framebuffer](RenderService& renderService)
+		{
+			if (framebuffer != VK_NULL_HANDLE)
+				vkDestroyFramebuffer(renderService.getDevice(), framebuffer, nullptr);
+			for (VkRenderPass render_pass : render_passes)
+			{
+				if (render_pass != VK_NULL_HANDLE)
+					vkDestroyRenderPass(renderService.getDevice(), render_pass, nullptr);
+			}
+		});
+	}
+
+
+	bool CanvasRenderTarget::init(RenderTexture2D& colorTexture, const RGBAColorFloat& clearColor, utility::ErrorState& errorState)
+	{
+		mColorTexture = &colorTexture;
+		mClearColor = clearColor;
+
+		VkAttachmentDescription color_attachment = {};
+		color_attachment.format = getColorFormat();
+		color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		color_attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkAttachmentReference color_attachment_ref = {};
+		color_attachment_ref.attachment = 0;
+		color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &color_attachment_ref;
+
+		// Previous reads of the texture must complete before it is written, and the write must complete before it is sampled
+		std::array<VkSubpassDependency, 2> dependencies = {};
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+		dependencies[1].srcSubpass = 0;
+		dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		VkRenderPassCreateInfo render_pass_info = {};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		render_pass_info.attachmentCount = 1;
+		render_pass_info.pAttachments = &color_attachment;
+		render_pass_info.subpassCount = 1;
+		render_pass_info.pSubpasses = &subpass;
+		render_pass_info.dependencyCount = dependencies.size();
+		render_pass_info.pDependencies = dependencies.data();
+		if (!errorState.check(vkCreateRenderPass(mRenderService.getDevice(), &render_pass_info, nullptr, &mRenderPass) == VK_SUCCESS, "Failed to create canvas render pass"))
+			return false;
+
+		// Load ops don't affect render pass compatibility, pipelines and the framebuffer work with both passes
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		if (!errorState.check(vkCreateRenderPass(mRenderService.getDevice(), &render_pass_info, nullptr, &mRenderPassNoClear) == VK_SUCCESS, "Failed to create canvas render pass"))
+			return false;
+
+		VkImageView attachment = colorTexture.getHandle().getView();
+		glm::ivec2 size = colorTexture.getSize();
+		VkFramebufferCreateInfo framebuffer_info = {};
+		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebuffer_info.renderPass = mRenderPass;
+		framebuffer_info.attachmentCount = 1;
+		framebuffer_info.pAttachments = &attachment;
+		framebuffer_info.width = size.x;
+		framebuffer_info.height = size.y;
+		framebuffer_info.layers = 1;
+		return errorState.check(vkCreateFramebuffer(mRenderService.getDevice(), &framebuffer_info, nullptr, &mFramebuffer) == VK_SUCCESS, "Failed to create canvas framebuffer");
+	}
+
+
+	void CanvasRenderTarget::beginRendering(VkSubpassContents contents, bool clear)
+	{
+		glm::ivec2 size = getBufferSize();
+		VkClearValue clear_value = {};
+		clear_value.color = { mClearColor[0], mClearColor[1], mClearColor[2], mClearColor[3] };
+
+		VkRenderPassBeginInfo render_pass_info = {};
+		render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		render_pass_info.renderPass = clear ? mRenderPass : mRenderPassNoClear;
+		render_pass_info.framebuffer = mFramebuffer;
+		render_pass_info.renderArea.offset = { 0, 0 };
+		render_pass_info.renderArea.extent = { (uint32_t)size.x, (uint32_t)size.y };
+		render_pass_info.clearValueCount = clear ? 1 : 0;
+		render_pass_info.pClearValues = clear ? &clear_value : nullptr;
+
+		VkCommandBuffer command_buffer = mRenderService.getCurrentCommandBuffer();
+		vkCmdBeginRenderPass(command_buffer, &render_pass_info, contents);
+		if (contents == VK_SUBPASS_CONTENTS_INLINE)
+			setViewport(command_buffer);
+	}
+
+
+	void CanvasRenderTarget::endRendering()
+	{
+		vkCmdEndRenderPass(mRenderService.getCurrentCommandBuffer());
+	}
+
+
+	void CanvasRenderTarget::setViewport(VkCommandBuffer commandBuffer) const
+	{
+		glm::ivec2 size = getBufferSize();
+		VkViewport viewport = { 0.0f, 0.0f, (float)size.x, (float)size.y, 0.0f, 1.0f };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = { { 0, 0 }, { (uint32_t)size.x, (uint32_t)size.y } };
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	}
+
+
+	VkFormat CanvasRenderTarget::getColorFormat() const
+	{
+		return mColorTexture->getFormat();
+	}
+}
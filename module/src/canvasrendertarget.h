@@ -0,0 +1,85 @@
+#pragma once
+
+// External Includes
+#include <irendertarget.h>
+#include <rendertexture2d.h>
+#include <color.h>
+
+namespace nap
+{
+	// Forward declares
+	class RenderService;
+
+	/**
+	 * Color only render target for the internal canvas passes.
+	 * Unlike nap::RenderTarget it exposes its framebuffer, which allows the render pass
+	 * to be started with secondary command buffer contents that are recorded on another thread.
+	 * Canvas passes never depth test, so no depth attachment is created.
+	 */
+	class NAPAPI CanvasRenderTarget : public IRenderTarget
+	{
+	public:
+		CanvasRenderTarget(RenderService& renderService);
+		virtual ~CanvasRenderTarget();
+
+		/**
+		 * Creates the render pass and framebuffer for the given texture.
+		 * @param colorTexture texture to render into, must outlive this target
+		 * @param clearColor color the texture is cleared to when rendering starts
+		 * @param errorState contains the error if creation fails
+		 * @return if the target was created
+		 */
+		bool init(RenderTexture2D& colorTexture, const RGBAColorFloat& clearColor, utility::ErrorState& errorState);
+
+		/**
+		 * Starts the render pass in the current command buffer, draw calls are recorded inline.
+		 */
+		virtual void beginRendering() override							{ beginRendering(VK_SUBPASS_CONTENTS_INLINE, true); }
+
+		/**
+		 * Starts the render pass in the current command buffer.
+		 * @param contents VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the draw calls are executed from secondary command buffers
+		 * @param clear if the target is cleared, passes that overwrite every pixel skip the clear
+		 */
+		void beginRendering(VkSubpassContents contents, bool clear);
+
+		/**
+		 * Ends the render pass in the current command buffer.
+		 */
+		virtual void endRendering() override;
+
+		/**
+		 * Sets the viewport and scissor to the full target, dynamic state isn't inherited by secondary command buffers.
+		 * @param commandBuffer the command buffer to record into
+		 */
+		void setViewport(VkCommandBuffer commandBuffer) const;
+
+		virtual const glm::ivec2 getBufferSize() const override			{ return mColorTexture->getSize(); }
+		virtual void setClearColor(const RGBAColorFloat& color) override	{ mClearColor = color; }
+		virtual const RGBAColorFloat& getClearColor() const override		{ return mClearColor; }
+		virtual ECullWindingOrder getWindingOrder() const override		{ return ECullWindingOrder::Clockwise; }
+		virtual VkRenderPass getRenderPass() const override				{ return mRenderPass; }
+		virtual VkFormat getColorFormat() const override;
+		virtual VkFormat getDepthFormat() const override					{ return VK_FORMAT_UNDEFINED; }
+		virtual VkSampleCountFlagBits getSampleCount() const override		{ return VK_SAMPLE_COUNT_1_BIT; }
+		virtual bool getSampleShadingEnabled() const override				{ return false; }
+
+		/**
+		 * @return framebuffer, used as inheritance info for secondary command buffers
+		 */
+		VkFramebuffer getFramebuffer() const								{ return mFramebuffer; }
+
+		/**
+		 * @return the texture this target renders into
+		 */
+		RenderTexture2D& getColorTexture()								{ return *mColorTexture; }
+
+	private:
+		RenderService&		mRenderService;
+		RenderTexture2D*	mColorTexture = nullptr;
+		RGBAColorFloat		mClearColor;
+		VkRenderPass		mRenderPass = VK_NULL_HANDLE;			///< Clears the target
+		VkRenderPass		mRenderPassNoClear = VK_NULL_HANDLE;	///< Compatible pass that leaves the contents undefined
+		VkFramebuffer		mFramebuffer = VK_NULL_HANDLE;
+	};
+}
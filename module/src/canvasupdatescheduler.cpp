@@ -0,0 +1,93 @@
+// Local Includes
+#include "canvasupdatescheduler.h"
+
+// External Includes
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+RTTI_BEGIN_ENUM(nap::ECanvasUpdateRate)
+	RTTI_ENUM_VALUE(nap::ECanvasUpdateRate::Full,	"Full"),
+	RTTI_ENUM_VALUE(nap::ECanvasUpdateRate::Hz,		"Hz"),
+	RTTI_ENUM_VALUE(nap::ECanvasUpdateRate::Frames,	"Frames")
+RTTI_END_ENUM
+
+namespace nap
+{
+	int CanvasUpdateScheduler::getPeriod(ECanvasUpdateRate rate, float hz, int frames, double frameInterval, int previous)
+	{
+		switch (rate)
+		{
+		case ECanvasUpdateRate::Full:
+			return 1;
+		case ECanvasUpdateRate::Frames:
+			return std::clamp(frames, 1, maxLength);
+		case ECanvasUpdateRate::Hz:
+		{
+			// Keep the previous period until the exact one is three quarters of a frame away, jitter in the frame rate doesn't move canvases around
+			double exact = 1.0 / std::max(static_cast<double>(hz) * frameInterval, 1e-6);
+			if (previous > 0 && std::abs(exact - previous) < 0.75)
+				return previous;
+			return std::clamp(static_cast<int>(std::lround(exact)), 1, maxLength);
+		}
+		}
+		return 1;
+	}
+
+
+	bool CanvasUpdateScheduler::update(const std::vector<int>& periods, const std::vector<float>& costs)
+	{
+		if (periods == mPeriods && costs == mCosts)
+			return false;
+		mPeriods = periods;
+		mCosts = costs;
+		mPhases.assign(periods.size(), 0);
+		mRebuildCount++;
+
+		// The schedule repeats after the least common multiple of the periods, canvases at full rate add to every frame
+		int length = 1;
+		float base = 0.0f;
+		for (int i = 0; i < mPeriods.size(); i++)
+		{
+			if (mPeriods[i] <= 1)
+				base += mCosts[i];
+			else
+				length = std::min(std::lcm(length, mPeriods[i]), maxLength);
+		}
+		mLoad.assign(length, base);
+
+		// Most expensive first, each canvas takes the phase that keeps the peak of its frames lowest, ties go to the least loaded phase
+		mOrder.clear();
+		for (int i = 0; i < mPeriods.size(); i++)
+		{
+			if (mPeriods[i] > 1)
+				mOrder.emplace_back(i);
+		}
+		std::stable_sort(mOrder.begin(), mOrder.end(), [this](int a, int b) { return mCosts[a] > mCosts[b]; });
+		for (int index : mOrder)
+		{
+			int period = mPeriods[index];
+			float best_peak = 0.0f;
+			float best_total = 0.0f;
+			for (int phase = 0; phase < period; phase++)
+			{
+				float peak = 0.0f;
+				float total = 0.0f;
+				for (int slot = phase; slot < length; slot += period)
+				{
+					peak = std::max(peak, mLoad[slot]);
+					total += mLoad[slot];
+				}
+				if (phase == 0 || peak < best_peak || (peak == best_peak && total < best_total))
+				{
+					best_peak = peak;
+					best_total = total;
+					mPhases[index] = phase;
+				}
+			}
+			for (int slot = mPhases[index]; slot < length; slot += period)
+				mLoad[slot] += mCosts[index];
+		}
+		return true;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <rtti/typeinfo.h>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * How often the headless passes of a canvas render
+	 */
+	enum class ECanvasUpdateRate : int
+	{
+		Full	= 0,	///< Every frame
+		Hz		= 1,	///< At a fixed rate, rounded to a whole number of frames at the current frame rate
+		Frames	= 2		///< Every N frames
+	};
+
+
+	/**
+	 * Spreads the canvases with a reduced update rate over frame slots, so the headless cost per frame stays level.
+	 * Every canvas renders once per period, in the frame of its phase. Phases are assigned greedily, most expensive canvas first,
+	 * each to the phase whose frames carry the least load. The schedule repeats after the least common multiple of the periods.
+	 */
+	class NAPAPI CanvasUpdateScheduler
+	{
+	public:
+		static constexpr int maxLength = 360;		///< Longest schedule, periods that don't divide it are spread approximately
+
+		/**
+		 * Frames between updates of a canvas, the period of Hz rates only changes when the frame rate moved well past a rounding boundary.
+		 * @param rate update rate of the canvas
+		 * @param hz updates per second, Hz rates only
+		 * @param frames frames between updates, Frames rates only
+		 * @param frameInterval current frame interval in seconds
+		 * @param previous period of the canvas in the current schedule, 0 when it has none
+		 * @return frames between updates, 1 renders every frame
+		 */
+		static int getPeriod(ECanvasUpdateRate rate, float hz, int frames, double frameInterval, int previous);
+
+		/**
+		 * Rebuilds the schedule when the periods or costs changed.
+		 * @param periods per canvas, frames between updates
+		 * @param costs per canvas, estimated cost of its headless passes
+		 * @return if the schedule was rebuilt
+		 */
+		bool update(const std::vector<int>& periods, const std::vector<float>& costs);
+
+		/**
+		 * @param index canvas index
+		 * @param frame frame counter
+		 * @return if the canvas renders in the frame
+		 */
+		bool isDue(int index, uint64 frame) const					{ return mPeriods[index] <= 1 || static_cast<int>(frame % mPeriods[index]) == mPhases[index]; }
+
+		/**
+		 * @return number of scheduled canvases
+		 */
+		int getCanvasCount() const									{ return static_cast<int>(mPeriods.size()); }
+
+		/**
+		 * @param index canvas index
+		 * @return frames between updates of the canvas
+		 */
+		int getPeriod(int index) const								{ return mPeriods[index]; }
+
+		/**
+		 * @param index canvas index
+		 * @return frame within its period in which the canvas renders
+		 */
+		int getPhase(int index) const								{ return mPhases[index]; }
+
+		/**
+		 * @return frames after which the schedule repeats
+		 */
+		int getLength() const										{ return static_cast<int>(mLoad.size()); }
+
+		/**
+		 * @return planned cost per frame of the schedule, of all canvases whether they are culled or not
+		 */
+		const std::vector<float>& getLoad() const					{ return mLoad; }
+
+		/**
+		 * @return number of times the schedule was rebuilt
+		 */
+		int getRebuildCount() const									{ return mRebuildCount; }
+
+	private:
+		std::vector<int>	mPeriods;
+		std::vector<int>	mPhases;
+		std::vector<float>	mCosts;
+		std::vector<float>	mLoad = std::vector<float>(1, 0.0f);
+		std::vector<int>	mOrder;
+		int					mRebuildCount = 0;
+	};
+}
@@ -4,16 +4,11 @@
 
 #pragma once
 
- // External Includes
-#include <shader.h>
+ // Local Includes
+#include "stockshader.h"
 
 namespace nap
 {
-	// Forward declares
-	class Core;
-	class RenderService;
-	class FoglioService;
-
 	// canvas shader sampler names 
 	namespace uniform
 	{
@@ -25,30 +20,24 @@ namespace nap
 			inline constexpr const char* bottomLeft = "bottomLeft";
 			inline constexpr const char* bottomRight = "bottomRight";
 
+			inline constexpr const char* uboStructBlend = "BLEND";
+			inline constexpr const char* blendViewport = "viewport";
+			inline constexpr const char* blendEdges = "edges";
+
 			namespace sampler
 			{
 				inline constexpr const char* inTexture = "inTexture";
+				inline constexpr const char* blendLut = "blendLut";
 			}
 
 		}
 	}
 
 
-	class NAPAPI CanvasWarpShader : public Shader
+	class NAPAPI CanvasWarpShader : public StockShader
 	{
-		RTTI_ENABLE(Shader)
+		RTTI_ENABLE(StockShader)
 	public:
 		CanvasWarpShader(Core& core);
-
-		/**
-		 * Cross compiles the canvas GLSL shader code to SPIR-V, creates the shader module and parses all the uniforms and samplers.
-		 * @param errorState contains the error if initialization fails.
-		 * @return if initialization succeeded.
-		 */
-		virtual bool init(utility::ErrorState& errorState) override;
-
-	private:
-		RenderService* mRenderService = nullptr;
-		FoglioService* mFoglioService = nullptr;
 	};
 }
\ No newline at end of file
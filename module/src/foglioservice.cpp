@@ -1,11 +1,23 @@
 // Local Includes
 #include "foglioservice.h"
+#include "tracer.h"
+#include "imagesequence.h"
 
 // External Includes
 #include <nap/core.h>
 #include <nap/resourcemanager.h>
 #include <nap/logger.h>
+#include <nap/projectinfo.h>
+#include <utility/fileutils.h>
+#include <rapidjson/document.h>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <unordered_set>
+
+#ifdef FOGLIO_EMBEDDED_SHADERS
+	#include <embeddedshaders.h>
+#endif
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::FoglioService)
 	RTTI_CONSTRUCTOR(nap::ServiceConfiguration*)
@@ -13,15 +25,81 @@ RTTI_END_CLASS
 
 namespace nap
 {
+	// Resource properties that point to media on disk
+	static const std::unordered_set<std::string> prefetchProperties = { "Path", "ImagePath", "VertShader", "FragShader" };
+
+	// Bytes read from the start and the end of large files, enough to cover container headers and the first frames
+	static constexpr std::streamsize prefetchHeadSize = 8 * 1024 * 1024;
+	static constexpr std::streamsize prefetchTailSize = 1024 * 1024;
+
+	static void collectMediaPaths(const rapidjson::Value& value, const std::string& dataDir, std::vector<std::string>& outPaths)
+	{
+		if (value.IsArray())
+		{
+			for (const auto& element : value.GetArray())
+				collectMediaPaths(element, dataDir, outPaths);
+		}
+		else if (value.IsObject())
+		{
+			for (const auto& member : value.GetObject())
+			{
+				if (member.value.IsString() && member.value.GetStringLength() > 0 && prefetchProperties.count(member.name.GetString()) > 0)
+				{
+					std::string path = member.value.GetString();
+					outPaths.emplace_back(utility::isAbsolutePath(path) ? path : utility::joinPath({ dataDir, path }));
+					continue;
+				}
+				collectMediaPaths(member.value, dataDir, outPaths);
+			}
+		}
+	}
+
+
+	static bool indexScene(const std::string& json, const std::string& dataDir, std::vector<std::string>& outFiles)
+	{
+		rapidjson::Document document;
+		document.Parse<rapidjson::kParseStopWhenDoneFlag>(json.c_str());
+		if (document.HasParseError())
+			return false;
+
+		// Keep the document order, that's the order in which the resource manager will consume the files
+		std::vector<std::string> paths;
+		collectMediaPaths(document, dataDir, paths);
+		std::unordered_set<std::string> unique_paths;
+		for (const auto& path : paths)
+		{
+			if (unique_paths.insert(path).second)
+				outFiles.emplace_back(path);
+		}
+		return true;
+	}
+
+
 	bool FoglioService::init(nap::utility::ErrorState& errorState)
 	{
-		//Logger::info("Initializing FoglioService");
+		// The scene is loaded after all services are initialized,
+		// start warming the media it references so the serial resource loader doesn't wait on a cold disk.
+		startPrefetch();
+
+		// Runtime mask changes decode in the background, a few threads keep up with a mask change per frame
+		mMaskLoader = std::make_unique<MaskLoader>(getCore());
+		mMaskLoader->start(std::min<int>(std::max<int>(std::thread::hardware_concurrency() / 2, 1), 4));
 		return true;
 	}
 
 
 	void FoglioService::update(double deltaTime)
 	{
+		mFrameTime.mTime = static_cast<float>(getCore().getElapsedTime());
+		mFrameTime.mDeltaTime = static_cast<float>(deltaTime);
+		mFrameTime.mFrame++;
+		mMetrics.beginFrame(mFrameTime.mTime, deltaTime);
+
+		for (auto* sequence : mImageSequences)
+			sequence->update(deltaTime);
+
+		if (isPrefetching() && mActivePrefetchWorkers == 0)
+			joinPrefetchThreads();
 	}
 	
 
@@ -32,5 +110,127 @@ namespace nap
 
 	void FoglioService::shutdown()
 	{
+		mStopPrefetch = true;
+		joinPrefetchThreads();
+		mMaskLoader->stop();
+	}
+
+
+	void FoglioService::addImageSequence(ImageSequence& sequence)
+	{
+		mImageSequences.emplace_back(&sequence);
+	}
+
+
+	void FoglioService::removeImageSequence(ImageSequence& sequence)
+	{
+		mImageSequences.erase(std::remove(mImageSequences.begin(), mImageSequences.end(), &sequence), mImageSequences.end());
+	}
+
+
+	void FoglioService::startPrefetch()
+	{
+		const ProjectInfo* project_info = getCore().getProjectInfo();
+		if (project_info == nullptr)
+			return;
+
+		const std::string data_file = project_info->getDataFile();
+		std::string json;
+		utility::ErrorState error;
+		if (data_file.empty() || !utility::readFileToString(data_file, json, error))
+			return;
+
+		{
+			FOGLIO_TRACE_ZONE("FoglioService::indexScene");
+			ScopedStartupTimer timer(mStartupTimeline, "scene", "index");
+			if (!indexScene(json, utility::getFileDir(data_file), mPrefetchFiles))
+				return;
+		}
+		if (mPrefetchFiles.empty())
+			return;
+
+		int thread_count = std::min<int>(mPrefetchFiles.size(), std::max<int>(std::thread::hardware_concurrency(), 2));
+		mActivePrefetchWorkers = thread_count;
+		for (int i = 0; i < thread_count; i++)
+			mPrefetchThreads.emplace_back(&FoglioService::prefetchWorker, this);
+	}
+
+
+	void FoglioService::prefetchWorker()
+	{
+		FOGLIO_TRACE_THREAD("prefetch");
+		std::vector<char> buffer(prefetchTailSize);
+		while (!mStopPrefetch)
+		{
+			size_t index = mPrefetchIndex.fetch_add(1);
+			if (index >= mPrefetchFiles.size())
+				break;
+
+			// Reading the file pulls it into the OS page cache, open and probe on the main thread then hit memory
+			const std::string& path = mPrefetchFiles[index];
+			FOGLIO_TRACE_ZONE_DETAIL("FoglioService::prefetch", utility::getFileName(path));
+			ScopedStartupTimer timer(mStartupTimeline, "prefetch", utility::getFileName(path));
+			std::ifstream stream(path, std::ios::binary | std::ios::ate);
+			if (!stream.is_open())
+				continue;
+
+			std::streamsize size = stream.tellg();
+			stream.seekg(0);
+			std::streamsize head = std::min(size, prefetchHeadSize);
+			for (std::streamsize offset = 0; offset < head && !mStopPrefetch; offset += buffer.size())
+				stream.read(buffer.data(), std::min<std::streamsize>(buffer.size(), head - offset));
+
+			// Some containers store their index at the end of the file
+			if (size > head)
+			{
+				stream.seekg(std::max(head, size - prefetchTailSize));
+				stream.read(buffer.data(), buffer.size());
+			}
+		}
+		mActivePrefetchWorkers--;
+	}
+
+
+	void FoglioService::joinPrefetchThreads()
+	{
+		for (auto& thread : mPrefetchThreads)
+			thread.join();
+		mPrefetchThreads.clear();
+	}
+
+
+	bool FoglioService::getStockShaderSource(const std::string& name, std::string& outVert, std::string& outFrag, utility::ErrorState& errorState)
+	{
+#ifdef FOGLIO_EMBEDDED_SHADERS
+		for (const auto& source : shader::embedded::sources)
+		{
+			if (name != source.mName)
+				continue;
+			outVert.assign(reinterpret_cast<const char*>(source.mVert), source.mVertSize);
+			outFrag.assign(reinterpret_cast<const char*>(source.mFrag), source.mFragSize);
+			return true;
+		}
+#endif
+		// Not embedded, the module was built without the stock shaders or the name is unknown
+		return readStockShaderFromDisk(name, outVert, outFrag, errorState);
+	}
+
+
+	bool FoglioService::readStockShaderFromDisk(const std::string& name, std::string& outVert, std::string& outFrag, utility::ErrorState& errorState)
+	{
+		std::string relative_path = utility::joinPath({ "shaders", utility::appendFileExtension(name, "vert") });
+		const std::string vertex_shader_path = getModule().findAsset(relative_path);
+		if (!errorState.check(!vertex_shader_path.empty(), "%s: Unable to find %s vertex shader %s", getModule().getName().c_str(), name.c_str(), relative_path.c_str()))
+			return false;
+
+		relative_path = utility::joinPath({ "shaders", utility::appendFileExtension(name, "frag") });
+		const std::string fragment_shader_path = getModule().findAsset(relative_path);
+		if (!errorState.check(!fragment_shader_path.empty(), "%s: Unable to find %s frag shader %s", getModule().getName().c_str(), name.c_str(), relative_path.c_str()))
+			return false;
+
+		if (!errorState.check(utility::readFileToString(vertex_shader_path, outVert, errorState), "Unable to read %s vertex shader file", name.c_str()))
+			return false;
+
+		return errorState.check(utility::readFileToString(fragment_shader_path, outFrag, errorState), "Unable to read %s fragment shader file", name.c_str());
 	}
 }
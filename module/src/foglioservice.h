@@ -1,10 +1,33 @@
 #pragma once
 
+// Local Includes
+#include "startuptimeline.h"
+#include "maskloader.h"
+#include "metrics.h"
+#include "canvasregistry.h"
+
 // External Includes
 #include <nap/service.h>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 namespace nap
 {
+	// Forward declares
+	class ImageSequence;
+
+	/**
+	 * Per frame time values shared by all canvases, updated once per frame by the FoglioService.
+	 */
+	struct FrameTime
+	{
+		float	mTime = 0.0f;			///< Seconds since start
+		float	mDeltaTime = 0.0f;		///< Seconds since previous frame
+		int		mFrame = 0;				///< Frame number
+	};
+
+
 	class NAPAPI FoglioService : public Service
 	{
 		RTTI_ENABLE(Service)
@@ -42,5 +65,79 @@ namespace nap
 		 */
 		virtual void shutdown() override;
 
+		/**
+		 * Returns the GLSL source of one of the stock canvas shaders (warp, mask, frame, block, canvasinterface).
+		 * The source embedded in the binary is used, the module data directory is only read when the shader isn't embedded.
+		 * Only the GLSL source is embedded: the caller still compiles it to SPIR-V at runtime.
+		 * @param name stock shader name, without extension
+		 * @param outVert the vertex shader source
+		 * @param outFrag the fragment shader source
+		 * @param errorState contains the error if the shader can't be found
+		 * @return if the shader source was found
+		 */
+		bool getStockShaderSource(const std::string& name, std::string& outVert, std::string& outFrag, utility::ErrorState& errorState);
+
+		/**
+		 * @return timeline of all startup work, including the time to first frame
+		 */
+		StartupTimeline& getStartupTimeline()									{ return mStartupTimeline; }
+
+		/**
+		 * Prefetching only warms the page cache: the resource manager still initializes the scene resources one at a time.
+		 * @return if media referenced by the scene is still being prefetched
+		 */
+		bool isPrefetching() const												{ return !mPrefetchThreads.empty(); }
+
+		/**
+		 * @return time of the current frame, shared by all canvases
+		 */
+		const FrameTime& getFrameTime() const									{ return mFrameTime; }
+
+		/**
+		 * Canvases register on init and unregister on destruction.
+		 * Canvases find their previous instance on reload through the registry.
+		 * @return all live canvases, in draw order
+		 */
+		CanvasRegistry& getCanvasRegistry()										{ return mCanvasRegistry; }
+
+		/**
+		 * @return pool that decodes mask images off the main thread
+		 */
+		MaskLoader& getMaskLoader()												{ return *mMaskLoader; }
+
+		/**
+		 * @return counters, gauges and histograms of the app, frame timing is recorded by the service
+		 */
+		Metrics& getMetrics()													{ return mMetrics; }
+
+		/**
+		 * Image sequences add themselves on init and remove themselves on destruction.
+		 * The service advances every sequence once per frame, before the app update.
+		 * @param sequence the sequence to advance
+		 */
+		void addImageSequence(ImageSequence& sequence);
+
+		/**
+		 * @param sequence the sequence to stop advancing
+		 */
+		void removeImageSequence(ImageSequence& sequence);
+
+	private:
+		StartupTimeline							mStartupTimeline;
+		FrameTime								mFrameTime;
+		Metrics									mMetrics;
+		CanvasRegistry							mCanvasRegistry;
+		std::vector<ImageSequence*>				mImageSequences;
+		std::unique_ptr<MaskLoader>				mMaskLoader = nullptr;
+		std::vector<std::string>				mPrefetchFiles;
+		std::vector<std::thread>				mPrefetchThreads;
+		std::atomic<size_t>						mPrefetchIndex = { 0 };
+		std::atomic<int>						mActivePrefetchWorkers = { 0 };
+		std::atomic<bool>						mStopPrefetch = { false };
+
+		void startPrefetch();
+		void prefetchWorker();
+		void joinPrefetchThreads();
+		bool readStockShaderFromDisk(const std::string& name, std::string& outVert, std::string& outFrag, utility::ErrorState& errorState);
 	};
 }
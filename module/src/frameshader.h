@@ -0,0 +1,33 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+ // Local Includes
+#include "stockshader.h"
+
+namespace nap
+{
+	// frame shader sampler names
+	namespace uniform
+	{
+		namespace frame
+		{
+			namespace sampler
+			{
+				inline constexpr const char* inTexture = "inTexture";		///< frame shader input sampler name
+			}
+		}
+	}
+
+	/**
+		shader that copies an RGBA frame into the canvas output without color conversion
+	 */
+	class NAPAPI FrameShader : public StockShader
+	{
+		RTTI_ENABLE(StockShader)
+	public:
+		FrameShader(Core& core);
+	};
+}
\ No newline at end of file
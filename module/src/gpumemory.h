@@ -0,0 +1,74 @@
+#pragma once
+
+// External Includes
+#include <texture2d.h>
+#include <algorithm>
+#include <string>
+
+namespace nap
+{
+	/**
+	 * Kind of GPU resource listed in the memory accounting view
+	 */
+	enum class EGpuMemoryKind : int
+	{
+		Texture			= 0,	///< Texture a canvas renders into
+		RenderTarget	= 1,	///< Render target, its own attachments only
+		Video			= 2,	///< Plane of a video player
+		Mask			= 3		///< Mask image
+	};
+
+
+	/**
+	 * A single GPU allocation, used to account for the memory a scene requires
+	 */
+	struct GpuMemoryEntry
+	{
+		std::string			mName;								///< Display name
+		EGpuMemoryKind		mKind = EGpuMemoryKind::Texture;	///< Kind of resource
+		const Texture2D*	mTexture = nullptr;					///< Texture that owns the memory, shared textures are accounted once
+		size_t				mBytes = 0;							///< Size in bytes
+	};
+
+
+	/**
+	 * @param texture the texture
+	 * @param mipChain if the texture has a full mip chain, e.g. an image created with 'GenerateLods'
+	 * @return size in bytes of the texture, including every mip level when it has a mip chain
+	 */
+	inline size_t getTextureMemory(const Texture2D& texture, bool mipChain = false)
+	{
+		const SurfaceDescriptor& descriptor = texture.getDescriptor();
+		size_t bytes = static_cast<size_t>(descriptor.getPitch()) * static_cast<size_t>(descriptor.getHeight());
+		if (!mipChain)
+			return bytes;
+
+		// Every level halves both dimensions down to 1x1, about a third on top of the base level
+		size_t pixel_size = static_cast<size_t>(descriptor.getBytesPerPixel());
+		size_t width = static_cast<size_t>(descriptor.getWidth());
+		size_t height = static_cast<size_t>(descriptor.getHeight());
+		while (width > 1 || height > 1)
+		{
+			width = std::max<size_t>(width / 2, 1);
+			height = std::max<size_t>(height / 2, 1);
+			bytes += width * height * pixel_size;
+		}
+		return bytes;
+	}
+
+
+	/**
+	 * @return display name of a memory kind
+	 */
+	inline const char* getGpuMemoryKindName(EGpuMemoryKind kind)
+	{
+		switch (kind)
+		{
+		case EGpuMemoryKind::Texture:		return "texture";
+		case EGpuMemoryKind::RenderTarget:	return "target";
+		case EGpuMemoryKind::Video:			return "video";
+		case EGpuMemoryKind::Mask:			return "mask";
+		}
+		return "";
+	}
+}
@@ -0,0 +1,524 @@
+// Local Includes
+#include "imagesequence.h"
+#include "foglioservice.h"
+#include "lz4block.h"
+#include "tracer.h"
+
+// External Includes
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::ImageSequence)
+	RTTI_CONSTRUCTOR(nap::Core&)
+	RTTI_PROPERTY("Path",			&nap::ImageSequence::mPath,				nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Loop",			&nap::ImageSequence::mLoop,				nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Speed",			&nap::ImageSequence::mSpeed,			nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("PrefetchFrames",	&nap::ImageSequence::mPrefetchFrames,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+	// Pages of a frame are touched at this interval, the smallest page size of the supported platforms
+	static constexpr size_t touchInterval = 4096;
+
+	static const uint8* mapFile(const std::string& path, size_t& outSize, utility::ErrorState& errorState)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (!errorState.check(file != INVALID_HANDLE_VALUE, "unable to open image sequence: %s", path.c_str()))
+			return nullptr;
+		LARGE_INTEGER size;
+		bool sized = GetFileSizeEx(file, &size) && size.QuadPart > 0;
+		HANDLE mapping = sized ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+		CloseHandle(file);
+		void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		if (!errorState.check(data != nullptr, "unable to map image sequence: %s", path.c_str()))
+			return nullptr;
+		outSize = static_cast<size_t>(size.QuadPart);
+		return static_cast<const uint8*>(data);
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (!errorState.check(fd >= 0, "unable to open image sequence: %s", path.c_str()))
+			return nullptr;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0)
+		{
+			close(fd);
+			errorState.fail("empty image sequence: %s", path.c_str());
+			return nullptr;
+		}
+		size_t size = static_cast<size_t>(info.st_size);
+		void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (!errorState.check(data != MAP_FAILED, "unable to map image sequence: %s", path.c_str()))
+			return nullptr;
+		outSize = size;
+		return static_cast<const uint8*>(data);
+#endif
+	}
+
+
+	static void unmapFile(const uint8* data, size_t size)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<uint8*>(data), size);
+#endif
+	}
+
+
+	// Starts reading a range of the mapping ahead, or releases its pages from the mapping, the page cache keeps them
+	static void advise(const uint8* data, size_t size, bool willNeed)
+	{
+#ifndef _WIN32
+		static const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+		uintptr_t start = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+		size_t length = reinterpret_cast<uintptr_t>(data) + size - start;
+		madvise(reinterpret_cast<void*>(start), length, willNeed ? MADV_WILLNEED : MADV_DONTNEED);
+#endif
+	}
+
+
+	ImageSequence::ImageSequence(Core& core) :
+		mCore(core),
+		mFoglioService(core.getService<FoglioService>()),
+		mUploadedBytes(core.getService<FoglioService>()->getMetrics().getCounter("foglio_sequence_uploaded_bytes_total", "Bytes copied from mapped image sequences into staging buffers")),
+		mLateFrameCounter(core.getService<FoglioService>()->getMetrics().getCounter("foglio_sequence_late_frames_total", "Image sequence frames uploaded before they were prefetched")),
+		mDecodedBytes(core.getService<FoglioService>()->getMetrics().getCounter("foglio_sequence_decoded_bytes_total", "Bytes decompressed by the prefetch threads of compressed image sequences"))
+	{ }
+
+
+	ImageSequence::~ImageSequence()
+	{
+		destroy();
+	}
+
+
+	bool ImageSequence::init(utility::ErrorState& errorState)
+	{
+		if (!errorState.check(mPrefetchFrames >= 0, "%s: prefetch frames can't be negative", mID.c_str()))
+			return false;
+		if (!errorState.check(mSpeed >= 0.0f, "%s: speed can't be negative", mID.c_str()))
+			return false;
+
+		mMapped = mapFile(mPath, mMappedSize, errorState);
+		if (mMapped == nullptr)
+			return false;
+
+		// Validate the layout before anything is read from the frames
+		if (!errorState.check(mMappedSize >= sizeof(imagesequence::Header), "%s: image sequence is truncated: %s", mID.c_str(), mPath.c_str()))
+			return false;
+		std::memcpy(&mHeader, mMapped, sizeof(imagesequence::Header));
+		if (!errorState.check(mHeader.mMagic == imagesequence::magic && mHeader.mVersion == imagesequence::version, "%s: not an image sequence or unsupported version: %s", mID.c_str(), mPath.c_str()))
+			return false;
+		if (!errorState.check(isRGBA() || isYUV() || isBlockCompressed(), "%s: unsupported pixel format: %d", mID.c_str(), static_cast<int>(mHeader.mFormat)))
+			return false;
+		if (!errorState.check(mHeader.mCompression == imagesequence::ECompression::None || mHeader.mCompression == imagesequence::ECompression::LZ4,
+			"%s: unsupported compression: %d", mID.c_str(), static_cast<int>(mHeader.mCompression)))
+			return false;
+		if (!errorState.check(mHeader.mWidth > 0 && mHeader.mHeight > 0 && mHeader.mFrameCount > 0 && mHeader.mFrameRate > 0.0f, "%s: image sequence is empty: %s", mID.c_str(), mPath.c_str()))
+			return false;
+		if (!errorState.check(mHeader.mFrameSize == imagesequence::getFrameSize(mHeader.mFormat, mHeader.mWidth, mHeader.mHeight) &&
+			(isCompressed() || mHeader.mFrameStride >= mHeader.mFrameSize) && mHeader.mDataOffset >= sizeof(imagesequence::Header), "%s: invalid frame layout: %s", mID.c_str(), mPath.c_str()))
+			return false;
+		if (isCompressed())
+		{
+			// Every frame of the index has to lie within the mapping, frames are decompressed without further checks on their location
+			uint64 index_end = sizeof(imagesequence::Header) + sizeof(imagesequence::FrameEntry) * static_cast<uint64>(mHeader.mFrameCount);
+			if (!errorState.check(index_end <= mHeader.mDataOffset && mHeader.mDataOffset <= mMappedSize, "%s: image sequence is truncated, frame index doesn't fit: %s", mID.c_str(), mPath.c_str()))
+				return false;
+			mEntries.resize(mHeader.mFrameCount);
+			std::memcpy(mEntries.data(), mMapped + sizeof(imagesequence::Header), sizeof(imagesequence::FrameEntry) * mEntries.size());
+			for (const auto& entry : mEntries)
+			{
+				if (!errorState.check(entry.mOffset >= mHeader.mDataOffset && entry.mSize <= mMappedSize && entry.mOffset <= mMappedSize - entry.mSize,
+					"%s: image sequence is truncated, %d frames don't fit: %s", mID.c_str(), mHeader.mFrameCount, mPath.c_str()))
+					return false;
+			}
+		}
+		else
+		{
+			uint64 end = mHeader.mDataOffset + mHeader.mFrameStride * (mHeader.mFrameCount - 1) + mHeader.mFrameSize;
+			if (!errorState.check(end <= mMappedSize, "%s: image sequence is truncated, %d frames don't fit: %s", mID.c_str(), mHeader.mFrameCount, mPath.c_str()))
+				return false;
+		}
+
+		// Frames are uploaded every time the playhead moves, the textures keep a staging buffer per frame in flight.
+		// The first frame is uploaded on creation, the sequence has a valid image before it starts playing.
+		auto create_texture = [&](int width, int height, ESurfaceDataType type, ESurfaceChannels channels, const uint8* data)
+		{
+			auto texture = std::make_unique<Texture2D>(mCore);
+			texture->mID = utility::stringFormat("%s_%d", mID.c_str(), static_cast<int>(mTextures.size()));
+			texture->mUsage = ETextureUsage::DynamicWrite;
+			SurfaceDescriptor descriptor(width, height, type, channels);
+			if (!texture->init(descriptor, false, data, errorState))
+				return false;
+			mTextures.emplace_back(std::move(texture));
+			return true;
+		};
+
+		const uint8* frame = getFrame(0);
+		if (isCompressed())
+		{
+			mDecodeBuffer.resize(getFrameSize());
+			if (!errorState.check(decode(0, mDecodeBuffer.data()), "%s: unable to decompress first frame: %s", mID.c_str(), mPath.c_str()))
+				return false;
+			frame = mDecodeBuffer.data();
+		}
+
+		if (isRGBA())
+		{
+			if (!create_texture(getWidth(), getHeight(), ESurfaceDataType::BYTE, ESurfaceChannels::RGBA, frame))
+				return false;
+		}
+		else if (isBlockCompressed())
+		{
+			// 8 bytes of block data per RGBA16 texel, BC3 blocks span two texels
+			int texels_per_block = static_cast<int>(imagesequence::getBlockSize(mHeader.mFormat) / 8);
+			int blocks_x = static_cast<int>(imagesequence::getBlockCount(mHeader.mWidth));
+			int blocks_y = static_cast<int>(imagesequence::getBlockCount(mHeader.mHeight));
+			if (!create_texture(blocks_x * texels_per_block, blocks_y, ESurfaceDataType::USHORT, ESurfaceChannels::RGBA, frame))
+				return false;
+		}
+		else
+		{
+			int chroma_width = static_cast<int>(imagesequence::getChromaSize(mHeader.mWidth));
+			int chroma_height = static_cast<int>(imagesequence::getChromaSize(mHeader.mHeight));
+			size_t y_size = static_cast<size_t>(getWidth()) * getHeight();
+			size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+			if (!create_texture(getWidth(), getHeight(), ESurfaceDataType::BYTE, ESurfaceChannels::R, frame) ||
+				!create_texture(chroma_width, chroma_height, ESurfaceDataType::BYTE, ESurfaceChannels::R, frame + y_size) ||
+				!create_texture(chroma_width, chroma_height, ESurfaceDataType::BYTE, ESurfaceChannels::R, frame + y_size + chroma_size))
+				return false;
+		}
+		mUploadedFrame = 0;
+
+		// Every frame in the prefetch window, including the playhead, has its own slot
+		if (isCompressed())
+		{
+			mDecodedCount = mPrefetchFrames + 1;
+			mDecoded = std::make_unique<DecodedFrame[]>(mDecodedCount);
+			for (int i = 0; i < mDecodedCount; i++)
+				mDecoded[i].mData.resize(getFrameSize());
+		}
+
+		mResident = std::make_unique<std::atomic<bool>[]>(mHeader.mFrameCount);
+		for (int i = 0; i < getFrameCount(); i++)
+			mResident[i].store(false, std::memory_order_relaxed);
+		mPrefetchThread = std::thread(&ImageSequence::prefetchThread, this);
+		mFoglioService->addImageSequence(*this);
+		return true;
+	}
+
+
+	void ImageSequence::onDestroy()
+	{
+		destroy();
+	}
+
+
+	void ImageSequence::destroy()
+	{
+		if (mPrefetchThread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(mPrefetchMutex);
+				mStopPrefetch = true;
+			}
+			mPrefetchCondition.notify_one();
+			mPrefetchThread.join();
+			mFoglioService->removeImageSequence(*this);
+		}
+		if (mMapped != nullptr)
+		{
+			unmapFile(mMapped, mMappedSize);
+			mMapped = nullptr;
+			mMappedSize = 0;
+		}
+	}
+
+
+	const uint8* ImageSequence::getFrame(int frame) const
+	{
+		if (isCompressed())
+			return mMapped + mEntries[frame].mOffset;
+		return mMapped + mHeader.mDataOffset + static_cast<size_t>(frame) * mHeader.mFrameStride;
+	}
+
+
+	size_t ImageSequence::getStoredSize(int frame) const
+	{
+		return isCompressed() ? static_cast<size_t>(mEntries[frame].mSize) : getFrameSize();
+	}
+
+
+	bool ImageSequence::decode(int frame, uint8* destination) const
+	{
+		return lz4::decompress(getFrame(frame), getStoredSize(frame), destination, getFrameSize());
+	}
+
+
+	double ImageSequence::getDuration() const
+	{
+		return static_cast<double>(mHeader.mFrameCount) / static_cast<double>(mHeader.mFrameRate);
+	}
+
+
+	int ImageSequence::getFrameAt(double time) const
+	{
+		return std::clamp(static_cast<int>(time * mHeader.mFrameRate), 0, getFrameCount() - 1);
+	}
+
+
+	void ImageSequence::seek(double time)
+	{
+		mTime = std::clamp(time, 0.0, getDuration());
+	}
+
+
+	void ImageSequence::update(double deltaTime)
+	{
+		if (mPlaying)
+		{
+			mTime += deltaTime * mSpeed;
+			double duration = getDuration();
+			if (mTime >= duration)
+			{
+				if (mLoop)
+				{
+					mTime = std::fmod(mTime, duration);
+				}
+				else
+				{
+					mTime = duration;
+					mPlaying = false;
+				}
+			}
+		}
+
+		int frame = getFrameAt(mTime);
+		if (frame != mUploadedFrame)
+			upload(frame);
+	}
+
+
+	void ImageSequence::upload(int frame)
+	{
+		FOGLIO_TRACE_ZONE_DETAIL("ImageSequence::upload", mID);
+		auto start = std::chrono::steady_clock::now();
+
+		const uint8* data = nullptr;
+		std::unique_lock<std::mutex> slot_lock;
+		if (isCompressed())
+		{
+			// The slot stays locked while it is copied, the prefetch thread can't reuse it halfway
+			for (int i = 0; i < mDecodedCount && data == nullptr; i++)
+			{
+				DecodedFrame& slot = mDecoded[i];
+				if (slot.mFrame.load(std::memory_order_acquire) != frame)
+					continue;
+				std::unique_lock<std::mutex> lock(slot.mMutex, std::try_to_lock);
+				if (lock.owns_lock() && slot.mFrame.load(std::memory_order_relaxed) == frame)
+				{
+					data = slot.mData.data();
+					slot_lock = std::move(lock);
+				}
+			}
+
+			// A frame that isn't decompressed yet is decompressed on the main thread
+			if (data == nullptr)
+			{
+				mLateFrames++;
+				mLateFrameCounter.add();
+				if (decode(frame, mDecodeBuffer.data()))
+					data = mDecodeBuffer.data();
+				else
+					nap::Logger::error("%s: unable to decompress frame %d", mID.c_str(), frame);
+			}
+		}
+		else
+		{
+			// Reading a frame that isn't resident faults its pages in on the main thread
+			if (!mResident[frame].load(std::memory_order_acquire))
+			{
+				mLateFrames++;
+				mLateFrameCounter.add();
+			}
+			data = getFrame(frame);
+		}
+
+		// A corrupt frame keeps the previous one bound
+		if (data != nullptr)
+		{
+			uploadData(data);
+			mUploadedBytes.add(mHeader.mFrameSize);
+		}
+		if (slot_lock.owns_lock())
+			slot_lock.unlock();
+		mUploadedFrame = frame;
+		mUploadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		{
+			std::lock_guard<std::mutex> lock(mPrefetchMutex);
+			mPlayhead = frame;
+		}
+		mPrefetchCondition.notify_one();
+	}
+
+
+	void ImageSequence::uploadData(const uint8* data)
+	{
+		// Copied into the staging buffer of the current frame, the GPU copy is recorded at the start of the render frame
+		if (isRGBA())
+		{
+			mTextures[0]->update(data, getWidth(), getHeight(), getWidth() * 4, ESurfaceChannels::RGBA);
+		}
+		else if (isBlockCompressed())
+		{
+			Texture2D& texture = *mTextures[0];
+			texture.update(data, texture.getWidth(), texture.getHeight(), texture.getWidth() * 8, ESurfaceChannels::RGBA);
+		}
+		else
+		{
+			int chroma_width = mTextures[1]->getWidth();
+			int chroma_height = mTextures[1]->getHeight();
+			size_t y_size = static_cast<size_t>(getWidth()) * getHeight();
+			size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+			mTextures[0]->update(data, getWidth(), getHeight(), getWidth(), ESurfaceChannels::R);
+			mTextures[1]->update(data + y_size, chroma_width, chroma_height, chroma_width, ESurfaceChannels::R);
+			mTextures[2]->update(data + y_size + chroma_size, chroma_width, chroma_height, chroma_width, ESurfaceChannels::R);
+		}
+	}
+
+
+	bool ImageSequence::decodeAhead(int frame)
+	{
+		// The slots outnumber the frames in the window, released frames free their slot
+		DecodedFrame* slot = nullptr;
+		for (int i = 0; i < mDecodedCount && slot == nullptr; i++)
+		{
+			if (mDecoded[i].mFrame.load(std::memory_order_relaxed) < 0)
+				slot = &mDecoded[i];
+		}
+		assert(slot != nullptr);
+
+		FOGLIO_TRACE_ZONE("ImageSequence::decode");
+		auto start = std::chrono::steady_clock::now();
+		std::lock_guard<std::mutex> lock(slot->mMutex);
+		if (!decode(frame, slot->mData.data()))
+			return false;
+		slot->mFrame.store(frame, std::memory_order_release);
+		mDecodedBytes.add(mHeader.mFrameSize);
+		mDecodeTime.store(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+		return true;
+	}
+
+
+	void ImageSequence::releaseDecoded(int frame)
+	{
+		for (int i = 0; i < mDecodedCount; i++)
+		{
+			DecodedFrame& slot = mDecoded[i];
+			if (slot.mFrame.load(std::memory_order_relaxed) != frame)
+				continue;
+			std::lock_guard<std::mutex> lock(slot.mMutex);
+			slot.mFrame.store(-1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+
+	void ImageSequence::prefetchThread()
+	{
+		FOGLIO_TRACE_THREAD("image sequence prefetch");
+		std::vector<int> resident;
+		int count = getFrameCount();
+		int playhead = -1;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mPrefetchMutex);
+				mPrefetchCondition.wait(lock, [&]() { return mStopPrefetch || mPlayhead != playhead; });
+				if (mStopPrefetch)
+					return;
+				playhead = mPlayhead;
+			}
+
+			// Release the frames the playhead passed, a frame stays resident as long as it is within the window ahead
+			for (auto it = resident.begin(); it != resident.end();)
+			{
+				int distance = *it - playhead;
+				if (distance < 0 && mLoop)
+					distance += count;
+				if (distance >= 0 && distance <= mPrefetchFrames)
+				{
+					++it;
+					continue;
+				}
+				mResident[*it].store(false, std::memory_order_release);
+				advise(getFrame(*it), getStoredSize(*it), false);
+				if (isCompressed())
+					releaseDecoded(*it);
+				it = resident.erase(it);
+			}
+
+			// Read ahead, nearest frame first. Touching every page makes the frame resident,
+			// the main thread then copies it without faulting. Compressed frames are decompressed instead.
+			for (int i = 0; i <= mPrefetchFrames; i++)
+			{
+				int frame = playhead + i;
+				if (frame >= count && !mLoop)
+					break;
+				frame %= count;
+				if (mResident[frame].load(std::memory_order_relaxed))
+					continue;
+
+				FOGLIO_TRACE_ZONE("ImageSequence::prefetch");
+				const uint8* data = getFrame(frame);
+				size_t size = getStoredSize(frame);
+				advise(data, size, true);
+				if (isCompressed())
+				{
+					// A corrupt frame isn't marked, the main thread reports it when it gets there
+					if (!decodeAhead(frame))
+						break;
+				}
+				else
+				{
+					volatile uint8 sink = 0;
+					for (size_t offset = 0; offset < size; offset += touchInterval)
+						sink = sink + data[offset];
+				}
+				mResident[frame].store(true, std::memory_order_release);
+				resident.emplace_back(frame);
+				mResidentCount.store(static_cast<int>(resident.size()), std::memory_order_relaxed);
+
+				// Stop reading frames that are no longer ahead after a seek
+				std::lock_guard<std::mutex> lock(mPrefetchMutex);
+				if (mStopPrefetch || mPlayhead != playhead)
+					break;
+			}
+			mResidentCount.store(static_cast<int>(resident.size()), std::memory_order_relaxed);
+		}
+	}
+}
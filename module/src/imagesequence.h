@@ -0,0 +1,263 @@
+#pragma once
+
+// Local Includes
+#include "imagesequenceformat.h"
+#include "metrics.h"
+
+// External Includes
+#include <nap/resource.h>
+#include <texture2d.h>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nap
+{
+	// Forward declares
+	class Core;
+	class FoglioService;
+
+	/**
+	 * Plays a packed sequence of raw RGBA, YUV420 or BC1/BC3 block compressed frames, see imagesequenceformat.h for the file layout.
+	 * The file is memory mapped, nothing is decoded: the current frame is copied from the mapped pages into
+	 * the staging buffers of its textures, which are allocated once. A prefetch thread keeps the frames ahead
+	 * of the playhead resident and releases the frames behind it, so playback is bound by disk bandwidth, not CPU.
+	 * RGBA sequences are sampled directly by the canvas passes, YUV sequences are converted by the video pass.
+	 *
+	 * Block compressed frames are uploaded as they are, at a quarter (BC3) or an eighth (BC1) of the size of RGBA.
+	 * Texture2D has no block compressed formats, the blocks are stored in an RGBA16 texture, one texel per 8 bytes,
+	 * and expanded by the block shader in the video pass. LZ4 compressed sequences are decompressed ahead of the
+	 * playhead by the prefetch thread, into a slot per prefetched frame, the main thread only copies.
+	 * Sequences are advanced by the FoglioService, before the app update.
+	 */
+	class NAPAPI ImageSequence : public Resource
+	{
+		RTTI_ENABLE(Resource)
+	public:
+		ImageSequence(Core& core);
+		virtual ~ImageSequence() override;
+
+		/**
+		 * Maps the file, validates the header, creates the textures and starts the prefetch thread.
+		 * @param errorState contains the error if the sequence can't be opened
+		 * @return if initialization succeeded
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+		/**
+		 * Stops the prefetch thread and unmaps the file.
+		 */
+		virtual void onDestroy() override;
+
+		/**
+		 * Advances the playhead and uploads the frame under it when it changed.
+		 * Called once per frame by the FoglioService, from the main thread.
+		 * @param deltaTime time in seconds since last update
+		 */
+		void update(double deltaTime);
+
+		/**
+		 * Starts playback from the current position.
+		 */
+		void play()																	{ mPlaying = true; }
+
+		/**
+		 * Stops playback, the current frame stays bound.
+		 */
+		void stop()																	{ mPlaying = false; }
+
+		/**
+		 * @return if the sequence is playing
+		 */
+		bool isPlaying() const														{ return mPlaying; }
+
+		/**
+		 * Moves the playhead, the frame is uploaded on the next update.
+		 * @param time time in seconds
+		 */
+		void seek(double time);
+
+		/**
+		 * @return playhead in seconds
+		 */
+		double getCurrentTime() const												{ return mTime; }
+
+		/**
+		 * @return duration in seconds
+		 */
+		double getDuration() const;
+
+		/**
+		 * @return frame that is bound to the textures
+		 */
+		int getCurrentFrame() const													{ return mUploadedFrame; }
+
+		/**
+		 * @return number of frames in the sequence
+		 */
+		int getFrameCount() const													{ return static_cast<int>(mHeader.mFrameCount); }
+
+		/**
+		 * @return width in pixels
+		 */
+		int getWidth() const														{ return static_cast<int>(mHeader.mWidth); }
+
+		/**
+		 * @return height in pixels
+		 */
+		int getHeight() const														{ return static_cast<int>(mHeader.mHeight); }
+
+		/**
+		 * @return frame rate in frames per second
+		 */
+		float getFrameRate() const													{ return mHeader.mFrameRate; }
+
+		/**
+		 * @return if the frames are RGBA, they can then be sampled without conversion through getTexture()
+		 */
+		bool isRGBA() const															{ return mHeader.mFormat == imagesequence::EFormat::RGBA8; }
+
+		/**
+		 * @return if the frames are YUV420, converted by the video shader from getYTexture(), getUTexture() and getVTexture()
+		 */
+		bool isYUV() const															{ return mHeader.mFormat == imagesequence::EFormat::YUV420; }
+
+		/**
+		 * @return if the frames are BC1 or BC3 blocks, expanded by the block shader from getBlockTexture()
+		 */
+		bool isBlockCompressed() const												{ return imagesequence::isBlockCompressed(mHeader.mFormat); }
+
+		/**
+		 * @return if the frames are LZ4 compressed in the file
+		 */
+		bool isCompressed() const													{ return mHeader.mCompression != imagesequence::ECompression::None; }
+
+		/**
+		 * @return pixel format of the frames
+		 */
+		imagesequence::EFormat getFormat() const									{ return mHeader.mFormat; }
+
+		/**
+		 * @return the RGBA texture, RGBA sequences only
+		 */
+		Texture2D& getTexture()														{ assert(isRGBA()); return *mTextures[0]; }
+
+		/**
+		 * @return the Y plane, YUV sequences only
+		 */
+		Texture2D& getYTexture()													{ assert(isYUV()); return *mTextures[0]; }
+
+		/**
+		 * @return the U plane, YUV sequences only
+		 */
+		Texture2D& getUTexture()													{ assert(isYUV()); return *mTextures[1]; }
+
+		/**
+		 * @return the V plane, YUV sequences only
+		 */
+		Texture2D& getVTexture()													{ assert(isYUV()); return *mTextures[2]; }
+
+		/**
+		 * @return the RGBA16 texture that holds the blocks of the frame, a row of blocks per texel row, BC1 and BC3 sequences only
+		 */
+		Texture2D& getBlockTexture()												{ assert(isBlockCompressed()); return *mTextures[0]; }
+
+		/**
+		 * @return the textures the frames are uploaded into, one for RGBA and blocks, the Y, U and V planes for YUV
+		 */
+		const std::vector<std::unique_ptr<Texture2D>>& getTextures() const			{ return mTextures; }
+
+		/**
+		 * @return size of the mapped file in bytes
+		 */
+		size_t getMappedSize() const												{ return mMappedSize; }
+
+		/**
+		 * @return bytes of pixel data per frame, after decompression
+		 */
+		size_t getFrameSize() const													{ return static_cast<size_t>(mHeader.mFrameSize); }
+
+		/**
+		 * @return number of frames the prefetch thread holds resident
+		 */
+		int getResidentFrameCount() const											{ return mResidentCount.load(std::memory_order_relaxed); }
+
+		/**
+		 * @return number of frames that were uploaded before the prefetch thread made them resident, their upload could stall on the disk
+		 */
+		int getLateFrameCount() const												{ return mLateFrames; }
+
+		/**
+		 * @return seconds the last upload took, the copy from the mapping into the staging buffers
+		 */
+		double getUploadTime() const												{ return mUploadTime; }
+
+		/**
+		 * @return seconds the last decompression on the prefetch thread took, compressed sequences only
+		 */
+		double getDecodeTime() const												{ return mDecodeTime.load(std::memory_order_relaxed); }
+
+		std::string		mPath;											///< Property: 'Path' path to the packed sequence
+		bool			mLoop = true;									///< Property: 'Loop' if playback wraps around at the end
+		float			mSpeed = 1.0f;									///< Property: 'Speed' playback speed, 1 plays at the frame rate of the sequence
+		int				mPrefetchFrames = 8;							///< Property: 'PrefetchFrames' number of frames ahead of the playhead that are kept resident, or decompressed
+
+	private:
+		/**
+		 * Frame decompressed by the prefetch thread. The thread holds the mutex while it writes,
+		 * the main thread only tries to lock it, a slot that is being written isn't ready.
+		 */
+		struct DecodedFrame
+		{
+			std::mutex							mMutex;
+			std::atomic<int>					mFrame = { -1 };
+			std::vector<uint8>					mData;
+		};
+
+		Core&									mCore;
+		FoglioService*							mFoglioService = nullptr;
+		imagesequence::Header					mHeader = {};
+		const uint8*							mMapped = nullptr;
+		size_t									mMappedSize = 0;
+		std::vector<std::unique_ptr<Texture2D>>	mTextures;
+		std::vector<imagesequence::FrameEntry>	mEntries;						///< Compressed sequences only
+		MetricCounter&							mUploadedBytes;
+		MetricCounter&							mLateFrameCounter;
+		MetricCounter&							mDecodedBytes;
+
+		// Main thread only
+		bool									mPlaying = false;
+		double									mTime = 0.0;
+		int										mUploadedFrame = -1;
+		int										mLateFrames = 0;
+		double									mUploadTime = 0.0;
+		std::vector<uint8>						mDecodeBuffer;					///< Late compressed frames are decompressed here
+
+		// Prefetch thread
+		std::thread								mPrefetchThread;
+		std::mutex								mPrefetchMutex;
+		std::condition_variable					mPrefetchCondition;
+		int										mPlayhead = 0;					///< Guarded by the prefetch mutex
+		bool									mStopPrefetch = false;			///< Guarded by the prefetch mutex
+		std::unique_ptr<std::atomic<bool>[]>	mResident;						///< Per frame, if the prefetch thread made it resident
+		std::atomic<int>						mResidentCount = { 0 };
+		std::unique_ptr<DecodedFrame[]>			mDecoded;						///< Compressed sequences only, a slot per prefetched frame
+		int										mDecodedCount = 0;
+		std::atomic<double>						mDecodeTime = { 0.0 };
+
+		const uint8* getFrame(int frame) const;
+		size_t getStoredSize(int frame) const;
+		bool decode(int frame, uint8* destination) const;
+		int getFrameAt(double time) const;
+		void upload(int frame);
+		void uploadData(const uint8* data);
+		bool decodeAhead(int frame);
+		void releaseDecoded(int frame);
+		void prefetchThread();
+		void destroy();
+	};
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// External Includes
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * File layout of a packed image sequence: raw or block compressed frames that are played without video decoding.
+ * This header has no dependencies on NAP so that packing tools can include it directly.
+ *
+ * The file starts with a Header. Uncompressed frame N starts at mDataOffset + N * mFrameStride.
+ * The stride is a multiple of mAlignment, every frame starts on its own page and can be mapped,
+ * prefetched and released independently. Rows are stored top to bottom without padding, like decoded video.
+ * RGBA8 frames store 4 bytes per pixel. YUV420 frames store the full resolution Y plane,
+ * followed by the U and V planes at half the width and height, rounded up.
+ * BC1 and BC3 frames store rows of 4x4 texel blocks, top to bottom, in the layout GPUs sample them (DXT1 and DXT5).
+ *
+ * Compressed sequences (mCompression is not None) have a frame of variable size. A FrameEntry per frame follows
+ * the header, the frames themselves still start on their own page. mFrameSize is the size after decompression.
+ */
+namespace nap
+{
+	namespace imagesequence
+	{
+		inline constexpr uint32_t magic = 0x464f5331;		///< 'FOS1'
+		inline constexpr uint32_t version = 1;
+		inline constexpr uint32_t alignment = 4096;			///< Default frame alignment, the page size of common platforms
+
+		/**
+		 * Pixel format of the frames in a sequence
+		 */
+		enum class EFormat : uint32_t
+		{
+			RGBA8	= 0,
+			YUV420	= 1,
+			BC1		= 2,				///< 8 bytes per block, RGB with 1 bit alpha
+			BC3		= 3					///< 16 bytes per block, RGB with interpolated alpha
+		};
+
+		/**
+		 * Compression applied to every frame in a sequence
+		 */
+		enum class ECompression : uint32_t
+		{
+			None	= 0,
+			LZ4		= 1					///< LZ4 block format, without frame header
+		};
+
+		struct Header
+		{
+			uint32_t	mMagic;
+			uint32_t	mVersion;
+			uint32_t	mWidth;
+			uint32_t	mHeight;
+			EFormat		mFormat;
+			uint32_t	mFrameCount;
+			float		mFrameRate;					///< Frames per second
+			uint32_t	mAlignment;					///< Frame alignment in bytes
+			uint64_t	mFrameSize;					///< Bytes of pixel data per frame
+			uint64_t	mFrameStride;				///< Distance in bytes between the starts of consecutive frames
+			uint64_t	mDataOffset;				///< Offset in bytes of the first frame
+			ECompression mCompression;				///< Zero in files written before compression was supported
+			uint8_t		mPadding[4];
+		};
+		static_assert(sizeof(Header) == 64, "image sequence header must be 64 bytes");
+
+		/**
+		 * Location of a compressed frame, the index of a compressed sequence starts right after the header
+		 */
+		struct FrameEntry
+		{
+			uint64_t	mOffset;					///< Offset in bytes from the start of the file
+			uint64_t	mSize;						///< Compressed size in bytes
+		};
+		static_assert(sizeof(FrameEntry) == 16, "image sequence frame entry must be 16 bytes");
+
+		/**
+		 * @return if the frames are stored as 4x4 texel blocks
+		 */
+		inline bool isBlockCompressed(EFormat format)
+		{
+			return format == EFormat::BC1 || format == EFormat::BC3;
+		}
+
+		/**
+		 * @return bytes per 4x4 block of a block compressed format
+		 */
+		inline uint32_t getBlockSize(EFormat format)
+		{
+			return format == EFormat::BC1 ? 8 : 16;
+		}
+
+		/**
+		 * @return number of blocks along a width or height, partial blocks are padded
+		 */
+		inline uint32_t getBlockCount(uint32_t size)
+		{
+			return (size + 3) / 4;
+		}
+
+		/**
+		 * @return width or height of the U and V planes of a YUV420 frame
+		 */
+		inline uint32_t getChromaSize(uint32_t size)
+		{
+			return (size + 1) / 2;
+		}
+
+		/**
+		 * @return bytes of pixel data of a single frame
+		 */
+		inline uint64_t getFrameSize(EFormat format, uint32_t width, uint32_t height)
+		{
+			if (format == EFormat::RGBA8)
+				return static_cast<uint64_t>(width) * height * 4;
+			if (isBlockCompressed(format))
+				return static_cast<uint64_t>(getBlockCount(width)) * getBlockCount(height) * getBlockSize(format);
+			return static_cast<uint64_t>(width) * height + 2 * static_cast<uint64_t>(getChromaSize(width)) * getChromaSize(height);
+		}
+
+		/**
+		 * @return value rounded up to a multiple of the alignment
+		 */
+		inline uint64_t align(uint64_t value, uint32_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		/**
+		 * Fills in a header for a sequence with the default alignment.
+		 * The frames of a compressed sequence have no fixed stride, the data starts after its frame index.
+		 */
+		inline Header createHeader(EFormat format, uint32_t width, uint32_t height, uint32_t frameCount, float frameRate, ECompression compression = ECompression::None)
+		{
+			Header header = {};
+			header.mMagic = magic;
+			header.mVersion = version;
+			header.mWidth = width;
+			header.mHeight = height;
+			header.mFormat = format;
+			header.mFrameCount = frameCount;
+			header.mFrameRate = frameRate;
+			header.mAlignment = alignment;
+			header.mFrameSize = getFrameSize(format, width, height);
+			header.mCompression = compression;
+			if (compression == ECompression::None)
+			{
+				header.mFrameStride = align(header.mFrameSize, alignment);
+				header.mDataOffset = align(sizeof(Header), alignment);
+			}
+			else
+			{
+				header.mFrameStride = 0;
+				header.mDataOffset = align(sizeof(Header) + sizeof(FrameEntry) * static_cast<uint64_t>(frameCount), alignment);
+			}
+			return header;
+		}
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+// External Includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * LZ4 block format, the light compression of block compressed image sequences.
+ * Blocks are compatible with LZ4_compress_default and LZ4_decompress_safe, without the frame format around them.
+ * This header has no dependencies on NAP so that packing tools can include it directly.
+ */
+namespace nap
+{
+	namespace lz4
+	{
+		/**
+		 * @return capacity of the destination buffer that any input of the given size compresses into
+		 */
+		inline size_t getMaxCompressedSize(size_t size)
+		{
+			return size + size / 255 + 16;
+		}
+
+
+		/**
+		 * Compresses a buffer with a single pass greedy matcher, fast enough for packing and close to the ratio of the reference encoder.
+		 * @param src data to compress
+		 * @param size size of the data in bytes
+		 * @param dst destination, at least getMaxCompressedSize(size) bytes
+		 * @return compressed size in bytes
+		 */
+		inline size_t compress(const uint8_t* src, size_t size, uint8_t* dst)
+		{
+			constexpr int hash_bits = 16;
+			constexpr size_t max_offset = 65535;
+			std::vector<uint32_t> table(size_t(1) << hash_bits, 0);
+
+			uint8_t* op = dst;
+			auto write_length = [&op](size_t length)
+			{
+				for (; length >= 255; length -= 255)
+					*op++ = 255;
+				*op++ = static_cast<uint8_t>(length);
+			};
+			auto write_literals = [&](const uint8_t* literals, size_t count, uint8_t*& token)
+			{
+				token = op++;
+				*token = static_cast<uint8_t>((count < 15 ? count : 15) << 4);
+				if (count >= 15)
+					write_length(count - 15);
+				std::memcpy(op, literals, count);
+				op += count;
+			};
+
+			// The format requires the last match to start at least 12 bytes before the end, the last 5 bytes are always literals
+			const uint8_t* ip = src;
+			const uint8_t* anchor = src;
+			const uint8_t* end = src + size;
+			const uint8_t* match_limit = size > 12 ? end - 12 : src;
+			while (ip < match_limit)
+			{
+				uint32_t sequence;
+				std::memcpy(&sequence, ip, 4);
+				uint32_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+				const uint8_t* ref = src + table[hash];
+				table[hash] = static_cast<uint32_t>(ip - src);
+
+				uint32_t candidate;
+				std::memcpy(&candidate, ref, 4);
+				if (ref >= ip || static_cast<size_t>(ip - ref) > max_offset || candidate != sequence)
+				{
+					ip++;
+					continue;
+				}
+
+				const uint8_t* match_end = ip + 4;
+				while (match_end < end - 5 && *match_end == ref[match_end - ip])
+					match_end++;
+
+				uint8_t* token;
+				write_literals(anchor, static_cast<size_t>(ip - anchor), token);
+				size_t offset = static_cast<size_t>(ip - ref);
+				*op++ = static_cast<uint8_t>(offset & 0xff);
+				*op++ = static_cast<uint8_t>(offset >> 8);
+				size_t length = static_cast<size_t>(match_end - ip) - 4;
+				*token |= static_cast<uint8_t>(length < 15 ? length : 15);
+				if (length >= 15)
+					write_length(length - 15);
+				ip = match_end;
+				anchor = ip;
+			}
+
+			uint8_t* token;
+			write_literals(anchor, static_cast<size_t>(end - anchor), token);
+			return static_cast<size_t>(op - dst);
+		}
+
+
+		/**
+		 * Decompresses a block, every read and write is bounds checked, corrupt input fails instead of overrunning.
+		 * @param src compressed block
+		 * @param srcSize size of the compressed block in bytes
+		 * @param dst destination buffer
+		 * @param dstSize exact size of the decompressed data in bytes
+		 * @return if the block decompressed to exactly dstSize bytes
+		 */
+		inline bool decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+		{
+			const uint8_t* ip = src;
+			const uint8_t* src_end = src + srcSize;
+			uint8_t* op = dst;
+			uint8_t* dst_end = dst + dstSize;
+			auto read_length = [&](size_t& length)
+			{
+				uint8_t value;
+				do
+				{
+					if (ip >= src_end)
+						return false;
+					value = *ip++;
+					length += value;
+				} while (value == 255);
+				return true;
+			};
+
+			while (ip < src_end)
+			{
+				uint8_t token = *ip++;
+				size_t literals = token >> 4;
+				if (literals == 15 && !read_length(literals))
+					return false;
+				if (literals > static_cast<size_t>(src_end - ip) || literals > static_cast<size_t>(dst_end - op))
+					return false;
+				std::memcpy(op, ip, literals);
+				ip += literals;
+				op += literals;
+
+				// The last sequence has no match
+				if (ip == src_end)
+					break;
+
+				if (src_end - ip < 2)
+					return false;
+				size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+				ip += 2;
+				size_t length = token & 15;
+				if (length == 15 && !read_length(length))
+					return false;
+				length += 4;
+				if (offset == 0 || offset > static_cast<size_t>(op - dst) || length > static_cast<size_t>(dst_end - op))
+					return false;
+
+				// Matches closer than their length repeat the bytes just written, copied a period at a time
+				while (length > 0)
+				{
+					size_t count = offset < length ? offset : length;
+					std::memcpy(op, op - offset, count);
+					op += count;
+					length -= count;
+				}
+			}
+			return op == dst_end;
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#include "maskloader.h"
+#include "tracer.h"
+
+#include <utility/fileutils.h>
+#include <chrono>
+
+namespace nap
+{
+	void MaskLoader::start(int threadCount)
+	{
+		mStop = false;
+		for (int i = 0; i < threadCount; i++)
+			mThreads.emplace_back(&MaskLoader::worker, this);
+	}
+
+
+	void MaskLoader::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStop = true;
+			mQueue.clear();
+		}
+		mCondition.notify_all();
+		for (auto& thread : mThreads)
+			thread.join();
+		mThreads.clear();
+	}
+
+
+	std::shared_ptr<MaskLoader::Request> MaskLoader::load(const std::string& path)
+	{
+		auto request = std::make_shared<Request>(mCore, path);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQueue.emplace_back(request);
+		}
+		mCondition.notify_one();
+		return request;
+	}
+
+
+	void MaskLoader::worker()
+	{
+		FOGLIO_TRACE_THREAD("mask loader");
+		while (true)
+		{
+			std::shared_ptr<Request> request;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mCondition.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+				if (mStop)
+					return;
+				request = std::move(mQueue.front());
+				mQueue.pop_front();
+			}
+
+			// The caller dropped the request, a newer mask replaced it before it was decoded
+			if (request.use_count() == 1)
+				continue;
+
+			FOGLIO_TRACE_ZONE_DETAIL("MaskLoader::decode", utility::getFileName(request->mPath));
+			auto start = std::chrono::steady_clock::now();
+			utility::ErrorState error_state;
+			request->mSucceeded = request->mBitmap.initFromFile(request->mPath, error_state);
+			request->mError = error_state.toString();
+			request->mDecodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			request->mDone = true;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// External Includes
+#include <bitmap.h>
+#include <nap/core.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Decodes mask images on a pool of worker threads, so masks can be changed at runtime without stalling the frame.
+	 * The caller polls the returned request and uploads the decoded bitmap on the main thread.
+	 */
+	class NAPAPI MaskLoader
+	{
+	public:
+		/**
+		 * A single mask decode. Owned by the caller and the worker that decodes it, dropping it cancels the decode.
+		 */
+		struct Request
+		{
+			Request(Core& core, const std::string& path) : mPath(path), mBitmap(core)	{ }
+
+			std::string			mPath;
+			Bitmap				mBitmap;					///< The decoded image, valid once done and succeeded
+			bool				mSucceeded = false;
+			std::string			mError;
+			double				mDecodeTime = 0.0;			///< Seconds spent decoding
+			std::atomic<bool>	mDone = { false };			///< Set by the worker, everything above is readable after
+		};
+
+		MaskLoader(Core& core) : mCore(core)					{ }
+		~MaskLoader()											{ stop(); }
+
+		/**
+		 * Starts the worker threads.
+		 * @param threadCount number of decode threads
+		 */
+		void start(int threadCount);
+
+		/**
+		 * Stops and joins the worker threads, queued decodes are dropped.
+		 */
+		void stop();
+
+		/**
+		 * Queues a mask for decoding.
+		 * @param path path to the image
+		 * @return the request, poll mDone from the main thread
+		 */
+		std::shared_ptr<Request> load(const std::string& path);
+
+	private:
+		Core&									mCore;
+		std::vector<std::thread>				mThreads;
+		std::deque<std::shared_ptr<Request>>	mQueue;
+		std::mutex								mMutex;
+		std::condition_variable					mCondition;
+		bool									mStop = false;
+
+		void worker();
+	};
+}
@@ -4,16 +4,11 @@
 
 #pragma once
 
- // External Includes
-#include <shader.h>
+ // Local Includes
+#include "stockshader.h"
 
 namespace nap
 {
-	// Forward declares
-	class Core;
-	class RenderService;
-	class FoglioService;
-
 	// canvas shader sampler names 
 	namespace uniform
 	{
@@ -33,21 +28,10 @@ namespace nap
 	/**
 		shader that turns pixels transparent according to image representing a mask
 	 */
-	class NAPAPI MaskShader : public Shader
+	class NAPAPI MaskShader : public StockShader
 	{
-		RTTI_ENABLE(Shader)
+		RTTI_ENABLE(StockShader)
 	public:
 		MaskShader(Core& core);
-
-		/**
-		 * Cross compiles the canvas GLSL shader code to SPIR-V, creates the shader module and parses all the uniforms and samplers.
-		 * @param errorState contains the error if initialization fails.
-		 * @return if initialization succeeded.
-		 */
-		virtual bool init(utility::ErrorState& errorState) override;
-
-	private:
-		RenderService* mRenderService = nullptr;
-		FoglioService* mFoglioService = nullptr;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "metrics.h"
+
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace nap
+{
+	// Frame time buckets in seconds, dense around the 60 and 30 Hz frame intervals
+	static const std::vector<double> frameBuckets =
+	{
+		0.002, 0.004, 0.006, 0.008, 0.010, 0.012, 0.014, 0.016, 0.0175, 0.020,
+		0.025, 0.0333, 0.040, 0.050, 0.0667, 0.100, 0.250, 0.500, 1.0
+	};
+
+
+	MetricHistogram::MetricHistogram(const std::vector<double>& bounds, int window) :
+		mBounds(bounds),
+		mCounts(new std::atomic<uint64>[bounds.size() + 1]),
+		mSnapshots(window + 1, std::vector<uint64>(bounds.size() + 1, 0)),
+		mWindowCounts(bounds.size() + 1, 0)
+	{
+		for (int i = 0; i <= mBounds.size(); i++)
+			mCounts[i].store(0, std::memory_order_relaxed);
+	}
+
+
+	void MetricHistogram::observe(double value)
+	{
+		size_t bucket = std::lower_bound(mBounds.begin(), mBounds.end(), value) - mBounds.begin();
+		mCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		// No atomic add for doubles before C++20
+		double sum = mSum.load(std::memory_order_relaxed);
+		while (!mSum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+			;
+	}
+
+
+	void MetricHistogram::snapshot()
+	{
+		std::vector<uint64>& snapshot = mSnapshots[mSnapshotIndex];
+		for (int i = 0; i < snapshot.size(); i++)
+			snapshot[i] = mCounts[i].load(std::memory_order_relaxed);
+		mSnapshotIndex = (mSnapshotIndex + 1) % mSnapshots.size();
+		mSnapshotCount = std::min<int>(mSnapshotCount + 1, mSnapshots.size());
+	}
+
+
+	double MetricHistogram::getRollingPercentile(double percentile) const
+	{
+		// The window spans from the oldest snapshot to now
+		int oldest = mSnapshotCount < mSnapshots.size() ? -1 : mSnapshotIndex;
+		uint64 total = 0;
+		for (int i = 0; i < mWindowCounts.size(); i++)
+		{
+			mWindowCounts[i] = mCounts[i].load(std::memory_order_relaxed) - (oldest < 0 ? 0 : mSnapshots[oldest][i]);
+			total += mWindowCounts[i];
+		}
+		if (total == 0)
+			return 0.0;
+
+		double rank = percentile * static_cast<double>(total);
+		uint64 cumulative = 0;
+		for (int i = 0; i < mBounds.size(); i++)
+		{
+			if (cumulative + mWindowCounts[i] >= rank && mWindowCounts[i] > 0)
+			{
+				double lower = i == 0 ? 0.0 : mBounds[i - 1];
+				double fraction = (rank - static_cast<double>(cumulative)) / static_cast<double>(mWindowCounts[i]);
+				return lower + (mBounds[i] - lower) * std::max(fraction, 0.0);
+			}
+			cumulative += mWindowCounts[i];
+		}
+		return mBounds.back();
+	}
+
+
+	void MetricHistogram::getCounts(std::vector<uint64>& outCounts) const
+	{
+		outCounts.resize(mBounds.size() + 1);
+		for (int i = 0; i < outCounts.size(); i++)
+			outCounts[i] = mCounts[i].load(std::memory_order_relaxed);
+	}
+
+
+	Metrics::Metrics()
+	{
+		mFrameTime = &getHistogram("foglio_frame_time_seconds", "Time between the starts of consecutive frames", frameBuckets);
+		mPresentInterval = &getHistogram("foglio_present_interval_seconds", "Time between consecutive frame submissions", frameBuckets);
+		mFrames = &getCounter("foglio_frames_total", "Frames rendered");
+		mMissedVsyncs = &getCounter("foglio_missed_vsync_total", "Frames presented more than 1.5 times the median interval after the previous one");
+	}
+
+
+	Metrics::Entry* Metrics::findEntry(const std::string& name, EType type)
+	{
+		auto it = std::find_if(mEntries.begin(), mEntries.end(), [&name](const Entry& entry) { return entry.mName == name; });
+		if (it == mEntries.end())
+			return nullptr;
+		assert(it->mType == type);
+		return &(*it);
+	}
+
+
+	MetricCounter& Metrics::getCounter(const std::string& name, const std::string& help)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry* entry = findEntry(name, EType::Counter);
+		if (entry == nullptr)
+		{
+			mEntries.push_back({ name, help, EType::Counter, std::make_unique<MetricCounter>(), nullptr, nullptr });
+			entry = &mEntries.back();
+		}
+		return *entry->mCounter;
+	}
+
+
+	MetricGauge& Metrics::getGauge(const std::string& name, const std::string& help)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry* entry = findEntry(name, EType::Gauge);
+		if (entry == nullptr)
+		{
+			mEntries.push_back({ name, help, EType::Gauge, nullptr, std::make_unique<MetricGauge>(), nullptr });
+			entry = &mEntries.back();
+		}
+		return *entry->mGauge;
+	}
+
+
+	MetricHistogram& Metrics::getHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		Entry* entry = findEntry(name, EType::Histogram);
+		if (entry == nullptr)
+		{
+			mEntries.push_back({ name, help, EType::Histogram, nullptr, nullptr, std::make_unique<MetricHistogram>(bounds, window) });
+			entry = &mEntries.back();
+		}
+		return *entry->mHistogram;
+	}
+
+
+	void Metrics::beginFrame(double time, double deltaTime)
+	{
+		mFrames->add();
+		mFrameTime->observe(deltaTime);
+		if (time - mLastSnapshot < 1.0)
+			return;
+
+		mLastSnapshot = time;
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto& entry : mEntries)
+		{
+			if (entry.mType == EType::Histogram)
+				entry.mHistogram->snapshot();
+		}
+	}
+
+
+	void Metrics::markPresent(double time, int frame)
+	{
+		if (mLastPresent < 0.0)
+		{
+			mLastPresent = time;
+			return;
+		}
+		double interval = time - mLastPresent;
+		mLastPresent = time;
+
+		// The median interval is the display rate as long as most frames make vsync
+		double expected = mPresentInterval->getRollingPercentile(0.5);
+		mPresentInterval->observe(interval);
+		mIntervals[mIntervalIndex] = static_cast<float>(interval);
+		mIntervalIndex = (mIntervalIndex + 1) % intervalCapacity;
+		if (expected <= 0.0 || interval <= expected * 1.5)
+			return;
+
+		mMissedVsyncs->add();
+		if (mSpikes.size() == spikeCapacity)
+			mSpikes.pop_front();
+		mSpikes.push_back({ time, frame, interval });
+	}
+
+
+	std::string Metrics::toPrometheus() const
+	{
+		std::ostringstream stream;
+		std::vector<uint64> counts;
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto& entry : mEntries)
+		{
+			stream << "# HELP " << entry.mName << " " << entry.mHelp << "\n";
+			switch (entry.mType)
+			{
+			case EType::Counter:
+				stream << "# TYPE " << entry.mName << " counter\n" << entry.mName << " " << entry.mCounter->get() << "\n";
+				break;
+			case EType::Gauge:
+				stream << "# TYPE " << entry.mName << " gauge\n" << entry.mName << " " << utility::stringFormat("%.9g", entry.mGauge->get()) << "\n";
+				break;
+			case EType::Histogram:
+			{
+				// Prometheus buckets are cumulative
+				stream << "# TYPE " << entry.mName << " histogram\n";
+				entry.mHistogram->getCounts(counts);
+				uint64 cumulative = 0;
+				for (int i = 0; i < counts.size(); i++)
+				{
+					cumulative += counts[i];
+					std::string bound = i < entry.mHistogram->getBounds().size() ? utility::stringFormat("%.9g", entry.mHistogram->getBounds()[i]) : "+Inf";
+					stream << entry.mName << "_bucket{le=\"" << bound << "\"} " << cumulative << "\n";
+				}
+				stream << entry.mName << "_sum " << utility::stringFormat("%.9g", entry.mHistogram->getSum()) << "\n";
+				stream << entry.mName << "_count " << cumulative << "\n";
+				break;
+			}
+			}
+		}
+		return stream.str();
+	}
+
+
+	bool Metrics::writePrometheus(const std::string& path, const std::string& text, utility::ErrorState& errorState)
+	{
+		std::string temp_path = path + ".tmp";
+		{
+			std::ofstream stream(temp_path, std::ios::trunc);
+			if (!errorState.check(stream.is_open(), "unable to write metrics: %s", temp_path.c_str()))
+				return false;
+			stream << text;
+			if (!errorState.check(stream.good(), "unable to write metrics: %s", temp_path.c_str()))
+				return false;
+		}
+#ifdef _WIN32
+		std::remove(path.c_str());
+#endif
+		return errorState.check(std::rename(temp_path.c_str(), path.c_str()) == 0, "unable to replace metrics: %s", path.c_str());
+	}
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+// External Includes
+#include <utility/errorstate.h>
+#include <nap/numeric.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Monotonic counter, can be incremented from any thread without locking.
+	 */
+	class NAPAPI MetricCounter
+	{
+	public:
+		void add(uint64 count = 1)										{ mValue.fetch_add(count, std::memory_order_relaxed); }
+		uint64 get() const												{ return mValue.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<uint64>		mValue = { 0 };
+	};
+
+
+	/**
+	 * Value that can go up and down, can be set from any thread without locking.
+	 */
+	class NAPAPI MetricGauge
+	{
+	public:
+		void set(double value)											{ mValue.store(value, std::memory_order_relaxed); }
+		double get() const												{ return mValue.load(std::memory_order_relaxed); }
+
+	private:
+		std::atomic<double>		mValue = { 0.0 };
+	};
+
+
+	/**
+	 * Histogram with fixed buckets, observations can be added from any thread without locking.
+	 * Keeps one snapshot of its buckets per second for the last seconds, percentiles are computed over that window.
+	 */
+	class NAPAPI MetricHistogram
+	{
+	public:
+		/**
+		 * @param bounds ascending upper bounds of the buckets, an overflow bucket is added
+		 * @param window number of seconds the rolling percentiles cover
+		 */
+		MetricHistogram(const std::vector<double>& bounds, int window);
+
+		/**
+		 * Adds a value to its bucket, lock free.
+		 * @param value the value
+		 */
+		void observe(double value);
+
+		/**
+		 * Stores the current bucket counts as the newest snapshot of the rolling window.
+		 * Called once per second, from the main thread.
+		 */
+		void snapshot();
+
+		/**
+		 * Percentile of the observations in the rolling window, interpolated within its bucket.
+		 * Main thread only.
+		 * @param percentile the percentile, 0-1
+		 * @return value at the percentile, 0 without observations
+		 */
+		double getRollingPercentile(double percentile) const;
+
+		/**
+		 * @return upper bounds of the buckets, without the overflow bucket
+		 */
+		const std::vector<double>& getBounds() const					{ return mBounds; }
+
+		/**
+		 * @param outCounts receives the count of every bucket, including the overflow bucket
+		 */
+		void getCounts(std::vector<uint64>& outCounts) const;
+
+		/**
+		 * @return sum of all observed values
+		 */
+		double getSum() const											{ return mSum.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<double>						mBounds;
+		std::unique_ptr<std::atomic<uint64>[]>	mCounts;
+		std::atomic<double>						mSum = { 0.0 };
+		std::vector<std::vector<uint64>>		mSnapshots;					///< Ring of bucket counts, one per second
+		int										mSnapshotIndex = 0;
+		int										mSnapshotCount = 0;
+		mutable std::vector<uint64>				mWindowCounts;
+	};
+
+
+	/**
+	 * Registry of all counters, gauges and histograms of the app, plus the frame timing metrics.
+	 * Metrics are created once, at init, and updated without locking from any thread.
+	 * Written as Prometheus text format, for the node_exporter textfile collector.
+	 */
+	class NAPAPI Metrics
+	{
+	public:
+		/**
+		 * A frame whose present interval exceeded the expected interval.
+		 */
+		struct Spike
+		{
+			double		mTime = 0.0;				///< Seconds since start
+			int			mFrame = 0;					///< Frame number
+			double		mInterval = 0.0;			///< Present interval in seconds
+		};
+
+		static constexpr int spikeCapacity = 32;		///< Spikes kept for the timeline
+		static constexpr int intervalCapacity = 240;	///< Present intervals kept for the timeline
+		static constexpr int window = 10;				///< Seconds covered by the rolling percentiles
+
+		Metrics();
+
+		/**
+		 * Finds or creates a counter.
+		 * @param name Prometheus metric name
+		 * @param help description of the metric
+		 * @return the counter, valid as long as the registry
+		 */
+		MetricCounter& getCounter(const std::string& name, const std::string& help);
+
+		/**
+		 * Finds or creates a gauge.
+		 * @param name Prometheus metric name
+		 * @param help description of the metric
+		 * @return the gauge, valid as long as the registry
+		 */
+		MetricGauge& getGauge(const std::string& name, const std::string& help);
+
+		/**
+		 * Finds or creates a histogram with the given bucket bounds.
+		 * @param name Prometheus metric name
+		 * @param help description of the metric
+		 * @param bounds ascending upper bounds of the buckets
+		 * @return the histogram, valid as long as the registry
+		 */
+		MetricHistogram& getHistogram(const std::string& name, const std::string& help, const std::vector<double>& bounds);
+
+		/**
+		 * Records the time of the current frame, once per frame from the main thread.
+		 * @param time seconds since start
+		 * @param deltaTime seconds since the previous frame
+		 */
+		void beginFrame(double time, double deltaTime);
+
+		/**
+		 * Records a presented frame, call after the frame is submitted.
+		 * Intervals longer than 1.5 times the rolling median interval count as missed vsync and are added to the spike timeline.
+		 * @param time seconds since start
+		 * @param frame frame number
+		 */
+		void markPresent(double time, int frame);
+
+		/**
+		 * @return histogram of the frame time in seconds
+		 */
+		const MetricHistogram& getFrameTime() const						{ return *mFrameTime; }
+
+		/**
+		 * @return histogram of the present interval in seconds
+		 */
+		const MetricHistogram& getPresentInterval() const				{ return *mPresentInterval; }
+
+		/**
+		 * @return number of frames that missed vsync
+		 */
+		uint64 getMissedVsyncs() const									{ return mMissedVsyncs->get(); }
+
+		/**
+		 * @return the latest spikes, oldest first
+		 */
+		const std::deque<Spike>& getSpikes() const						{ return mSpikes; }
+
+		/**
+		 * @return the latest present intervals in seconds, ring buffer, see getIntervalOffset()
+		 */
+		const std::vector<float>& getIntervals() const					{ return mIntervals; }
+
+		/**
+		 * @return index of the oldest entry of getIntervals()
+		 */
+		int getIntervalOffset() const									{ return mIntervalIndex; }
+
+		/**
+		 * Formats all metrics in Prometheus text format, in memory.
+		 * @return the metrics as Prometheus text
+		 */
+		std::string toPrometheus() const;
+
+		/**
+		 * Writes metrics formatted with toPrometheus(), from any thread.
+		 * The file is written next to the path and swapped, the collector never reads a partial file.
+		 * @param path output file, should end with .prom for the textfile collector
+		 * @param text the formatted metrics
+		 * @param errorState contains the error if the file can't be written
+		 * @return if the file was written
+		 */
+		static bool writePrometheus(const std::string& path, const std::string& text, utility::ErrorState& errorState);
+
+	private:
+		enum class EType : int
+		{
+			Counter, Gauge, Histogram
+		};
+
+		struct Entry
+		{
+			std::string							mName;
+			std::string							mHelp;
+			EType								mType;
+			std::unique_ptr<MetricCounter>		mCounter;
+			std::unique_ptr<MetricGauge>		mGauge;
+			std::unique_ptr<MetricHistogram>	mHistogram;
+		};
+
+		Entry* findEntry(const std::string& name, EType type);
+
+		mutable std::mutex				mMutex;						///< Guards creation of entries, not their values
+		std::deque<Entry>				mEntries;
+		MetricHistogram*				mFrameTime = nullptr;
+		MetricHistogram*				mPresentInterval = nullptr;
+		MetricCounter*					mFrames = nullptr;
+		MetricCounter*					mMissedVsyncs = nullptr;
+
+		// Main thread only
+		double							mLastPresent = -1.0;
+		double							mLastSnapshot = 0.0;
+		std::deque<Spike>				mSpikes;
+		std::vector<float>				mIntervals = std::vector<float>(intervalCapacity, 0.0f);
+		int								mIntervalIndex = 0;
+	};
+}
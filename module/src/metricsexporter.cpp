@@ -0,0 +1,83 @@
+// Local Includes
+#include "metricsexporter.h"
+#include "foglioservice.h"
+#include "tracer.h"
+
+// External Includes
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <utility/fileutils.h>
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::MetricsExporter)
+	RTTI_CONSTRUCTOR(nap::Core&)
+	RTTI_PROPERTY("Path",		&nap::MetricsExporter::mPath,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Interval",	&nap::MetricsExporter::mInterval,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+	MetricsExporter::MetricsExporter(Core& core) :
+		mMetrics(core.getService<FoglioService>()->getMetrics())
+	{ }
+
+
+	bool MetricsExporter::init(utility::ErrorState& errorState)
+	{
+		if (!errorState.check(mInterval > 0.0f, "%s: interval must be positive", mID.c_str()))
+			return false;
+		if (!errorState.check(utility::getFileExtension(mPath) == "prom", "%s: the textfile collector only reads .prom files: %s", mID.c_str(), mPath.c_str()))
+			return false;
+		mWriterThread = std::thread(&MetricsExporter::writerThread, this);
+		return true;
+	}
+
+
+	void MetricsExporter::onDestroy()
+	{
+		if (!mWriterThread.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mWriterMutex);
+			mStopWriter = true;
+		}
+		mWriterCondition.notify_one();
+		mWriterThread.join();
+	}
+
+
+	void MetricsExporter::update(double time)
+	{
+		if (time - mLastWrite < mInterval)
+			return;
+		mLastWrite = time;
+
+		// A write that is still pending is replaced, only the latest metrics matter
+		std::string text = mMetrics.toPrometheus();
+		{
+			std::lock_guard<std::mutex> lock(mWriterMutex);
+			mPending = std::move(text);
+		}
+		mWriterCondition.notify_one();
+	}
+
+
+	void MetricsExporter::writerThread()
+	{
+		FOGLIO_TRACE_THREAD("metrics writer");
+		std::unique_lock<std::mutex> lock(mWriterMutex);
+		while (true)
+		{
+			mWriterCondition.wait(lock, [this] { return mStopWriter || !mPending.empty(); });
+			if (mPending.empty())
+				return;
+
+			std::string text = std::move(mPending);
+			mPending.clear();
+			lock.unlock();
+			utility::ErrorState error;
+			if (!Metrics::writePrometheus(mPath, text, error))
+				nap::Logger::warn("%s: %s", mID.c_str(), error.toString().c_str());
+			lock.lock();
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// Local Includes
+#include "metrics.h"
+
+// External Includes
+#include <nap/resource.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace nap
+{
+	// Forward declares
+	class Core;
+
+	/**
+	 * Periodically writes the metrics of the FoglioService to a Prometheus text format file.
+	 * Point the node_exporter textfile collector at the directory of the file to scrape it.
+	 * The app calls update() once per frame, the metrics are formatted in memory and written on a writer thread.
+	 */
+	class NAPAPI MetricsExporter : public Resource
+	{
+		RTTI_ENABLE(Resource)
+	public:
+		MetricsExporter(Core& core);
+
+		/**
+		 * Validates the exporter properties and starts the writer thread.
+		 * @param errorState contains the error if the properties are invalid
+		 * @return if initialization succeeded
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+		/**
+		 * Writes the last formatted metrics and stops the writer thread.
+		 */
+		virtual void onDestroy() override;
+
+		/**
+		 * Hands the metrics to the writer thread when the interval elapsed since the previous write.
+		 * @param time seconds since start
+		 */
+		void update(double time);
+
+		std::string			mPath = "foglio.prom";			///< Property: 'Path' file the metrics are written to, must end with .prom
+		float				mInterval = 10.0f;				///< Property: 'Interval' seconds between writes
+
+	private:
+		Metrics&					mMetrics;
+		double						mLastWrite = 0.0;
+
+		std::thread					mWriterThread;
+		std::mutex					mWriterMutex;
+		std::condition_variable		mWriterCondition;
+		std::string					mPending;					///< Formatted metrics the writer hasn't written yet, empty when there are none
+		bool						mStopWriter = false;
+
+		void writerThread();
+	};
+}
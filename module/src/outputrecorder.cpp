@@ -0,0 +1,243 @@
+// Local Includes
+#include "outputrecorder.h"
+
+// External Includes
+#include <nap/core.h>
+#include <nap/logger.h>
+#include <renderservice.h>
+#include <foglioservice.h>
+#include <utility/fileutils.h>
+#include <utility/stringutils.h>
+#include <cstring>
+#include <ctime>
+
+RTTI_BEGIN_ENUM(nap::ERecordingFormat)
+	RTTI_ENUM_VALUE(nap::ERecordingFormat::Raw,	"Raw"),
+	RTTI_ENUM_VALUE(nap::ERecordingFormat::Y4M,	"Y4M"),
+	RTTI_ENUM_VALUE(nap::ERecordingFormat::TGA,	"TGA")
+RTTI_END_ENUM
+
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::OutputRecorder)
+	RTTI_CONSTRUCTOR(nap::Core&)
+	RTTI_PROPERTY("Directory",	&nap::OutputRecorder::mDirectory,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Format",		&nap::OutputRecorder::mFormat,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("QueueSize",	&nap::OutputRecorder::mQueueSize,	nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("FrameRate",	&nap::OutputRecorder::mFrameRate,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+	OutputRecorder::OutputRecorder(Core& core) :
+		mCore(core),
+		mRenderService(core.getService<RenderService>()),
+		mDroppedFrameCounter(core.getService<FoglioService>()->getMetrics().getCounter("foglio_recorder_frames_dropped_total", "Recorded frames dropped because the writer couldn't keep up"))
+	{ }
+
+
+	OutputRecorder::~OutputRecorder()
+	{
+		stop();
+	}
+
+
+	bool OutputRecorder::init(utility::ErrorState& errorState)
+	{
+		if (!errorState.check(mQueueSize > 0, "%s: queue size must be at least 1", mID.c_str()))
+			return false;
+		if (!errorState.check(mFrameRate > 0, "%s: frame rate must be at least 1", mID.c_str()))
+			return false;
+		return true;
+	}
+
+
+	void OutputRecorder::onDestroy()
+	{
+		stop();
+	}
+
+
+	bool OutputRecorder::start(const glm::ivec2& size, utility::ErrorState& errorState)
+	{
+		if (isRecording())
+			return true;
+
+		if (!errorState.check(utility::ensureDirExists(mDirectory), "%s: unable to create directory: %s", mID.c_str(), mDirectory.c_str()))
+			return false;
+
+		// Capture target, read back every frame
+		auto texture = std::make_unique<RenderTexture2D>(mCore);
+		texture->mID = mID + "_texture";
+		texture->mWidth = size.x;
+		texture->mHeight = size.y;
+		texture->mFormat = RenderTexture2D::EFormat::RGBA8;
+		texture->mUsage = ETextureUsage::DynamicRead;
+		if (!texture->init(errorState))
+			return false;
+
+		auto target = std::make_unique<RenderTarget>(mCore);
+		target->mID = mID + "_target";
+		target->mColorTexture = texture.get();
+		target->mClearColor = RGBAColor8(0, 0, 0, 255).convert<RGBAColorFloat>();
+		if (!target->init(errorState))
+			return false;
+
+		// Frame slots are allocated up front, the render loop never allocates while recording
+		mSlots.assign(mQueueSize, std::vector<uint8>(size.x * size.y * 4));
+		mFreeSlots = std::make_unique<SPSCQueue<int>>(mQueueSize);
+		mFilledSlots = std::make_unique<SPSCQueue<int>>(mQueueSize);
+		for (int i = 0; i < mQueueSize; i++)
+			mFreeSlots->push(i);
+
+		const char* extension = mFormat == ERecordingFormat::Y4M ? "y4m" : mFormat == ERecordingFormat::Raw ? "rgba" : "";
+		mPath = utility::joinPath({ mDirectory, utility::stringFormat("%s_%lld", mID.c_str(), static_cast<long long>(std::time(nullptr))) });
+		if (mFormat != ERecordingFormat::TGA)
+			mPath += utility::stringFormat("_%dx%d.%s", size.x, size.y, extension);
+		else if (!errorState.check(utility::ensureDirExists(mPath), "%s: unable to create directory: %s", mID.c_str(), mPath.c_str()))
+			return false;
+
+		mSize = size;
+		mTexture = std::move(texture);
+		mTarget = std::move(target);
+		mCapturedFrames = 0;
+		mDroppedFrames = 0;
+		mWrittenFrames = 0;
+		mStopWriter = false;
+		mWriterThread = std::thread(&OutputRecorder::writerThread, this);
+		nap::Logger::info("%s: recording to %s", mID.c_str(), mPath.c_str());
+		return true;
+	}
+
+
+	void OutputRecorder::stop()
+	{
+		if (!isRecording())
+			return;
+
+		// Destroying the texture cancels the readbacks that are still in flight
+		mTarget.reset();
+		mTexture.reset();
+		mStopWriter = true;
+		mWriterCondition.notify_one();
+		mWriterThread.join();
+		nap::Logger::info("%s: recorded %d frames, %d dropped", mID.c_str(), mWrittenFrames.load(), mDroppedFrames);
+	}
+
+
+	void OutputRecorder::capture()
+	{
+		if (!isRecording())
+			return;
+		mCapturedFrames++;
+		mTexture->asyncGetData([this](const void* data, size_t size) { onReadback(data, size); });
+	}
+
+
+	void OutputRecorder::onReadback(const void* data, size_t size)
+	{
+		// Called on the main thread once the copy completed, the only cost is a single copy into a free slot
+		int* slot = mFreeSlots->front();
+		if (slot == nullptr)
+		{
+			mDroppedFrames++;
+			mDroppedFrameCounter.add();
+			return;
+		}
+		int index = *slot;
+		mFreeSlots->pop();
+		std::memcpy(mSlots[index].data(), data, std::min(size, mSlots[index].size()));
+		mFilledSlots->push(index);
+		mWriterCondition.notify_one();
+	}
+
+
+	void OutputRecorder::writerThread()
+	{
+		std::ofstream stream;
+		if (mFormat != ERecordingFormat::TGA)
+		{
+			stream.open(mPath, std::ios::binary);
+			if (!stream.is_open())
+				nap::Logger::error("%s: unable to open %s", mID.c_str(), mPath.c_str());
+			else if (mFormat == ERecordingFormat::Y4M)
+				stream << utility::stringFormat("YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", mSize.x, mSize.y, mFrameRate);
+		}
+
+		std::vector<uint8> scratch;
+		while (true)
+		{
+			int* slot = mFilledSlots->front();
+			if (slot == nullptr)
+			{
+				if (mStopWriter)
+					break;
+				std::unique_lock<std::mutex> lock(mWriterMutex);
+				mWriterCondition.wait_for(lock, std::chrono::milliseconds(10));
+				continue;
+			}
+
+			int index = *slot;
+			mFilledSlots->pop();
+			if (writeFrame(stream, mSlots[index], scratch))
+				mWrittenFrames++;
+			mFreeSlots->push(index);
+		}
+	}
+
+
+	bool OutputRecorder::writeFrame(std::ofstream& stream, const std::vector<uint8>& frame, std::vector<uint8>& scratch)
+	{
+		const int pixel_count = mSize.x * mSize.y;
+		switch (mFormat)
+		{
+		case ERecordingFormat::Raw:
+		{
+			stream.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+			return stream.good();
+		}
+		case ERecordingFormat::Y4M:
+		{
+			// Planar 4:4:4, BT.601 limited range
+			scratch.resize(pixel_count * 3);
+			uint8* y = scratch.data();
+			uint8* u = y + pixel_count;
+			uint8* v = u + pixel_count;
+			for (int i = 0; i < pixel_count; i++)
+			{
+				const int r = frame[i * 4 + 0], g = frame[i * 4 + 1], b = frame[i * 4 + 2];
+				y[i] = static_cast<uint8>((( 66 * r + 129 * g +  25 * b + 128) >> 8) + 16);
+				u[i] = static_cast<uint8>(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+				v[i] = static_cast<uint8>(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+			}
+			stream << "FRAME\n";
+			stream.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+			return stream.good();
+		}
+		case ERecordingFormat::TGA:
+		{
+			// Uncompressed 32 bit BGRA, top-left origin
+			uint8 header[18] = { 0 };
+			header[2] = 2;
+			header[12] = mSize.x & 0xff;
+			header[13] = (mSize.x >> 8) & 0xff;
+			header[14] = mSize.y & 0xff;
+			header[15] = (mSize.y >> 8) & 0xff;
+			header[16] = 32;
+			header[17] = 0x28;
+			scratch.resize(frame.size());
+			for (int i = 0; i < pixel_count; i++)
+			{
+				scratch[i * 4 + 0] = frame[i * 4 + 2];
+				scratch[i * 4 + 1] = frame[i * 4 + 1];
+				scratch[i * 4 + 2] = frame[i * 4 + 0];
+				scratch[i * 4 + 3] = frame[i * 4 + 3];
+			}
+			std::string path = utility::joinPath({ mPath, utility::stringFormat("frame_%06d.tga", mWrittenFrames.load()) });
+			std::ofstream image(path, std::ios::binary);
+			image.write(reinterpret_cast<const char*>(header), sizeof(header));
+			image.write(reinterpret_cast<const char*>(scratch.data()), scratch.size());
+			return image.good();
+		}
+		}
+		return false;
+	}
+}
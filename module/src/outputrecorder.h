@@ -0,0 +1,135 @@
+#pragma once
+
+// Local Includes
+#include "spscqueue.h"
+#include "metrics.h"
+
+// External Includes
+#include <nap/resource.h>
+#include <rendertarget.h>
+#include <rendertexture2d.h>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace nap
+{
+	// Forward declares
+	class Core;
+	class RenderService;
+
+	/**
+	 * File format of a recording
+	 */
+	enum class ERecordingFormat : int
+	{
+		Raw		= 0,	///< Single file with tightly packed RGBA8 frames
+		Y4M		= 1,	///< Single YUV4MPEG2 file, 4:4:4 BT.601
+		TGA		= 2		///< Image sequence, one uncompressed RGBA TGA per frame
+	};
+
+
+	/**
+	 * Records the final composition of the main output to disk.
+	 * The app renders the composition into getTarget() and calls capture() once per frame.
+	 * Captured frames are read back asynchronously by the render service, which hands them over once the GPU finished the copy,
+	 * frames in flight later. The render loop only copies the readback into a preallocated frame slot and never waits:
+	 * when all slots are still queued for writing, the frame is dropped and counted.
+	 * A background thread converts and writes the frames.
+	 */
+	class NAPAPI OutputRecorder : public Resource
+	{
+		RTTI_ENABLE(Resource)
+	public:
+		OutputRecorder(Core& core);
+		virtual ~OutputRecorder() override;
+
+		/**
+		 * Validates the recorder properties.
+		 * @param errorState contains the error if the properties are invalid
+		 * @return if initialization succeeded
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+		/**
+		 * Stops recording.
+		 */
+		virtual void onDestroy() override;
+
+		/**
+		 * Creates the capture target and starts the writer thread.
+		 * @param size size of the recording in pixels
+		 * @param errorState contains the error if recording can't be started
+		 * @return if recording started
+		 */
+		bool start(const glm::ivec2& size, utility::ErrorState& errorState);
+
+		/**
+		 * Stops recording, waits until all queued frames are written.
+		 */
+		void stop();
+
+		/**
+		 * @return if the recorder is recording
+		 */
+		bool isRecording() const									{ return mTarget != nullptr; }
+
+		/**
+		 * @return target to render the composition into, only valid while recording
+		 */
+		RenderTarget& getTarget()									{ return *mTarget; }
+
+		/**
+		 * Requests a readback of the target, call after the composition is rendered into the target.
+		 */
+		void capture();
+
+		/**
+		 * @return number of frames captured since start
+		 */
+		int getCapturedFrames() const								{ return mCapturedFrames; }
+
+		/**
+		 * @return number of frames written since start
+		 */
+		int getWrittenFrames() const								{ return mWrittenFrames.load(); }
+
+		/**
+		 * @return number of frames dropped since start, because the writer couldn't keep up
+		 */
+		int getDroppedFrames() const								{ return mDroppedFrames; }
+
+		std::string			mDirectory = "recordings";				///< Property: 'Directory' directory the recordings are written to
+		ERecordingFormat	mFormat = ERecordingFormat::Y4M;		///< Property: 'Format' file format
+		int					mQueueSize = 8;							///< Property: 'QueueSize' number of frames that can wait for the writer
+		int					mFrameRate = 60;						///< Property: 'FrameRate' frame rate stored in the Y4M header
+
+	private:
+		Core&								mCore;
+		RenderService*						mRenderService = nullptr;
+		MetricCounter&						mDroppedFrameCounter;
+		std::unique_ptr<RenderTexture2D>	mTexture;
+		std::unique_ptr<RenderTarget>		mTarget;
+		glm::ivec2							mSize;
+		std::string							mPath;
+
+		// Frame slots, handed between the render loop and the writer
+		std::vector<std::vector<uint8>>		mSlots;
+		std::unique_ptr<SPSCQueue<int>>		mFreeSlots;				///< Writer -> render loop
+		std::unique_ptr<SPSCQueue<int>>		mFilledSlots;			///< Render loop -> writer
+		std::thread							mWriterThread;
+		std::mutex							mWriterMutex;
+		std::condition_variable				mWriterCondition;
+		std::atomic<bool>					mStopWriter = { false };
+
+		int									mCapturedFrames = 0;
+		int									mDroppedFrames = 0;
+		std::atomic<int>					mWrittenFrames = { 0 };
+
+		void onReadback(const void* data, size_t size);
+		void writerThread();
+		bool writeFrame(std::ofstream& stream, const std::vector<uint8>& frame, std::vector<uint8>& scratch);
+	};
+}
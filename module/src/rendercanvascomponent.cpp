@@ -2,6 +2,9 @@
 #include "canvaswarpshader.h"
 #include "canvasinterfaceshader.h"
 #include "maskshader.h"
+#include "frameshader.h"
+#include "blockshader.h"
+#include "tracer.h"
 
 #include <videoshader.h>
 #include <entity.h>
@@ -14,6 +17,9 @@
 #include <material.h>
 #include <nap/resourceptr.h>
 #include <rtti/objectptr.h>
+#include <limits>
+#include <algorithm>
+#include <utility/stringutils.h>
 
 
 // nap::rendercanvascomponent run time class definition
@@ -24,6 +30,16 @@ RTTI_PROPERTY("Resolution", &nap::RenderCanvasComponent::mResolution, nap::rtti:
 RTTI_PROPERTY("CornerOffsets", &nap::RenderCanvasComponent::mCornerOffsets, nap::rtti::EPropertyMetaData::Default)
 RTTI_PROPERTY("PostShader", &nap::RenderCanvasComponent::mPostShader, nap::rtti::EPropertyMetaData::Default)
 RTTI_PROPERTY("Mask", &nap::RenderCanvasComponent::mMask, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("Passes", &nap::RenderCanvasComponent::mPasses, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("OutputPass", &nap::RenderCanvasComponent::mOutputPass, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("Publisher", &nap::RenderCanvasComponent::mPublisher, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("Format", &nap::RenderCanvasComponent::mFormat, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("MaskFiles", &nap::RenderCanvasComponent::mMaskFiles, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("MaxResidentMasks", &nap::RenderCanvasComponent::mMaxResidentMasks, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("ImageSequence", &nap::RenderCanvasComponent::mImageSequence, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("UpdateRate", &nap::RenderCanvasComponent::mUpdateRate, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("UpdateHz", &nap::RenderCanvasComponent::mUpdateHz, nap::rtti::EPropertyMetaData::Default)
+RTTI_PROPERTY("UpdateFrames", &nap::RenderCanvasComponent::mUpdateFrames, nap::rtti::EPropertyMetaData::Default)
 
 
 RTTI_END_CLASS
@@ -34,16 +50,73 @@ RTTI_END_CLASS
 
 namespace nap
 {
+	static RenderTexture2D::EFormat toRenderTextureFormat(ECanvasTextureFormat format)
+	{
+		switch (format)
+		{
+		case ECanvasTextureFormat::R8:
+			return RenderTexture2D::EFormat::R8;
+		case ECanvasTextureFormat::RGBA16:
+			return RenderTexture2D::EFormat::RGBA16;
+		case ECanvasTextureFormat::RGBA32:
+			return RenderTexture2D::EFormat::RGBA32;
+		default:
+			return RenderTexture2D::EFormat::RGBA8;
+		}
+	}
+
+
+	static int getMaskIndex(const std::vector<std::string>& maskFiles, const std::string& path)
+	{
+		auto it = std::find(maskFiles.begin(), maskFiles.end(), path);
+		return it == maskFiles.end() ? -1 : static_cast<int>(it - maskFiles.begin());
+	}
+
+
+	static bool isSamePass(const CanvasPassNode& a, const CanvasPassNode& b)
+	{
+		return a.mName == b.mName && a.mType == b.mType && a.mMaterial.get() == b.mMaterial.get() &&
+			a.mInputs == b.mInputs && a.mSamplers == b.mSamplers && a.mFormat == b.mFormat;
+	}
+
+
+	bool RenderCanvasComponentInstance::Structure::operator==(const Structure& other) const
+	{
+		// Changed resources are recreated on reload, so comparing pointers detects content changes as well
+		return mVideoPlayer == other.mVideoPlayer && mImageSequence == other.mImageSequence && mPostShader == other.mPostShader && mMask == other.mMask &&
+			mPublisher == other.mPublisher && mAspectRatio == other.mAspectRatio && mResolution == other.mResolution &&
+			mFormat == other.mFormat && mOutputPass == other.mOutputPass && mPasses.size() == other.mPasses.size() &&
+			std::equal(mPasses.begin(), mPasses.end(), other.mPasses.begin(), isSamePass);
+	}
+
 
 	RenderCanvasComponentInstance::RenderCanvasComponentInstance(EntityInstance& entity, Component& resource) :
 		RenderableComponentInstance(entity, resource),
 		mHeadlessPlaneMesh(new PlaneMesh(*entity.getCore())),
 		mFinalPlaneMesh(new PlaneMesh(*entity.getCore())),
-		mFinalRenderTarget(new RenderTarget(*entity.getCore())),
 		mFinalTexture(new RenderTexture2D(*entity.getCore()))
 	{ }
 
 
+	RenderCanvasComponentInstance::~RenderCanvasComponentInstance()
+	{
+		// A failed reload destroys the new instance while the old one lives on, it gets its structure back
+		if (mDonor != nullptr)
+		{
+			swapStructure(*mDonor);
+			mDonor->mAdopter = nullptr;
+			mFoglioService->getCanvasRegistry().add(mDonor->getEntityInstance()->mID, *mDonor);
+		}
+
+		// A successful reload destroys the old instance, its structure now belongs to the new one
+		if (mAdopter != nullptr)
+			mAdopter->mDonor = nullptr;
+
+		if (mFoglioService != nullptr)
+			mFoglioService->getCanvasRegistry().remove(getEntityInstance()->mID, *this);
+	}
+
+
 
 	ResourcePtr<RenderTexture2D> RenderCanvasComponentInstance::getOutputTexture()
 	{
@@ -59,14 +132,36 @@ namespace nap
 	{
 		if (!RenderableComponentInstance::init(errorState))
 			return false;
+		FOGLIO_TRACE_ZONE_DETAIL("Canvas::init", getEntityInstance()->mID);
+		mFoglioService = getEntityInstance()->getCore()->getService<FoglioService>();
+		ScopedStartupTimer startup_timer(mFoglioService->getStartupTimeline(), "canvas", getEntityInstance()->mID);
 		// Get resource
 		RenderCanvasComponent* resource = getComponent<RenderCanvasComponent>();
 		mTransformComponent = getEntityInstance()->findComponent<TransformComponentInstance>();
-		// get main window render target // maybe this should be a parameter inside the canvasgroupcomponent that defines the window to render to
-		mMainWindowPtr = getEntityInstance()->getCore()->getResourceManager()->findObject<RenderWindow>("MainWindow");
-		assert(mMainWindowPtr != nullptr);
 		// create planes and initialize them
 		// The plane is positioned on update based on current texture output size and transform component, if its headless it's always fullscreen
+		// Extract render service
+		mRenderService = getEntityInstance()->getCore()->getService<RenderService>();
+		assert(mRenderService != nullptr);
+		if (!errorState.check(resource->mUpdateHz > 0.0f && resource->mUpdateFrames >= 1, "%s: update rate requires a positive Hz and at least 1 frame", resource->mID.c_str()))
+			return false;
+		setUpdateRate(resource->mUpdateRate, resource->mUpdateHz, resource->mUpdateFrames);
+
+		// On reload, take over the textures, targets and passes of the previous instance when its structure is unchanged.
+		// Only the cheap properties are applied, the canvas keeps rendering without a rebuild.
+		mStructure = { resource->mVideoPlayer.get(), resource->mImageSequence.get(), resource->mPostShader.get(), resource->mMask.get(), resource->mPublisher.get(),
+			resource->mAspectRatio, resource->mResolution, resource->mFormat, resource->mOutputPass, resource->mPasses };
+		RenderCanvasComponentInstance* previous = mFoglioService->getCanvasRegistry().find(getEntityInstance()->mID);
+		if (previous != nullptr && previous != this && previous->mAdopter == nullptr && previous->mStructure == mStructure)
+		{
+			swapStructure(*previous);
+			mDonor = previous;
+			previous->mAdopter = this;
+			mFoglioService->getCanvasRegistry().add(getEntityInstance()->mID, *this);
+			setCornerOffsets(resource->mCornerOffsets);
+			return true;
+		}
+
 		if (!setupPlaneMesh(mHeadlessPlaneMesh, 1, 1, errorState)) {
 			return false;
 		}
@@ -76,41 +171,25 @@ namespace nap
 		mResolution = new int(resource->mResolution);
 		mAspectRatio = new float(resource->mAspectRatio);
 		mVideoPlayer = resource->mVideoPlayer.get();
-		constructTextureAndRenderTarget(mFinalRenderTarget, mFinalTexture, true, errorState);
-		// Setup double buffer target for internal render
-		for (int target_idx = 0; target_idx < 2; target_idx++)
-		{
-
-			auto tex = getEntityInstance()->getCore()->getResourceManager()->createObject<RenderTexture2D>();
-			auto target = getEntityInstance()->getCore()->getResourceManager()->createObject<RenderTarget>();
-			if (!errorState.check(constructTextureAndRenderTarget(target, tex, true, errorState), "%s: unable to construct internal render target", resource->mID.c_str()))
-				return false;
-
-			mDoubleBufferTarget[target_idx] = target;
-		}
+		mImageSequence = resource->mImageSequence.get();
+		if (!errorState.check(mVideoPlayer == nullptr || mImageSequence == nullptr, "%s: canvas can play either a video player or an image sequence, not both", resource->mID.c_str()))
+			return false;
 
-		// Extract render service
-		mRenderService = getEntityInstance()->getCore()->getService<RenderService>();
-		assert(mRenderService != nullptr);
+		// Published canvases read back their output every frame
+		mPublisher = resource->mPublisher.get();
+		if (hasPublisher())
+			mFinalTexture->mUsage = ETextureUsage::DynamicRead;
+		if (!errorState.check(resource->mFormat != ECanvasTextureFormat::R8, "%s: canvas output requires color, R8 is only supported by intermediate passes", resource->mID.c_str()))
+			return false;
 
-		// Get video player
-		
-		if (mVideoPlayer != nullptr) {
-			mVideoPlayer->play();
-			if (!constructCanvasPassItem(CanvasMaterialType::VIDEO, errorState))
-				return false;
-			mVideoPlayer->VideoChanged.connect(mVideoChangedSlot);
-			videoChanged(*mVideoPlayer);
-		}
-		
+		// Compile the pass graph, canvases without declared passes use the fixed VIDEO -> PostShader -> MASK chain
+		std::vector<CanvasPassNode> default_passes;
+		if (resource->mPasses.empty())
+			createDefaultPasses(*resource, default_passes);
+		const std::vector<CanvasPassNode>& passes = resource->mPasses.empty() ? default_passes : resource->mPasses;
+		if (!buildRenderGraph(passes, resource->mOutputPass, errorState))
+			return false;
 
-		
-		mMask = resource->mMask.get();
-		if (mMask !=  nullptr) {
-			if(!constructCanvasPassItem(CanvasMaterialType::MASK, errorState))
-				return false;
-			mStockCanvasPasses[CanvasMaterialType::MASK].mSamplers["maskSampler"]->setTexture(*mMask.get());
-		}
 		if (!constructCanvasPassItem(CanvasMaterialType::INTERFACE, errorState))
 			return false;
 		if (!constructCanvasPassItem(CanvasMaterialType::WARP, errorState))
@@ -122,143 +201,358 @@ namespace nap
 		mStockCanvasPasses[CanvasMaterialType::INTERFACE].mUBO->getOrCreateUniform<UniformFloatInstance>(uniform::canvasinterface::frameThickness)->setValue(0.01);
 		mStockCanvasPasses[CanvasMaterialType::INTERFACE].mSamplers["inTextureSampler"]->setTexture(*mFinalTexture);
 		mStockCanvasPasses[CanvasMaterialType::WARP].mSamplers["inTextureSampler"]->setTexture(*mFinalTexture);
+		mFoglioService->getCanvasRegistry().add(getEntityInstance()->mID, *this);
 		
-		
-		if (resource->mPostShader.get() != nullptr) {
-			if (!errorState.check(resource->mPostShader.get()->init(errorState), "%s: unable to init post shader resource", resource->mID.c_str()))
-				return false;
-			mCustomPostPass = std::make_unique<CanvasPass>(CanvasPass());
-			mCustomPostPass->mMaterialInstResource = std::make_unique<MaterialInstanceResource>(MaterialInstanceResource());
-			mCustomPostPass->mMaterialInstResource->mBlendMode = resource->mPostShader->mBlendMode;
-			mCustomPostPass->mMaterialInstResource->mDepthMode = resource->mPostShader->mDepthMode;
-			mCustomPostPass->mMaterialInstResource->mMaterial = resource->mPostShader;
-			mCustomPostPass->mMaterialInstance = new MaterialInstance();
-			if (!errorState.check(mCustomPostPass->mMaterialInstance->init(*mRenderService, *mCustomPostPass->mMaterialInstResource, errorState), "%s: unable to instance material", this->mID.c_str()))
-				return false;
-			
-			//create mvp struct on material instance, regardless of type
-			mCustomPostPass->mMVPStruct = mCustomPostPass->mMaterialInstance->getOrCreateUniform(uniform::mvpStruct);
-			if (!errorState.check(mCustomPostPass->mMVPStruct != nullptr, "%s: Unable to find uniform MVP struct: %s in material: %s",
-				this->mID.c_str(), uniform::mvpStruct, mCustomPostPass->mMaterialInstResource->mMaterial->mID.c_str()))
-				return false;
-			// Get all matrices
-			
-			mCustomPostPass->mModelMatrixUniform = mCustomPostPass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::modelMatrix);//ensureUniformMat4(uniform::modelMatrix, mCustomPostPass->mMVPStruct, errorState);
-			mCustomPostPass->mProjectMatrixUniform = mCustomPostPass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::projectionMatrix);//ensureUniformMat4(uniform::projectionMatrix, mCustomPostPass->mMVPStruct, errorState);
-			mCustomPostPass->mViewMatrixUniform = mCustomPostPass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::viewMatrix);//ensureUniformMat4(uniform::viewMatrix, mCustomPostPass->mMVPStruct, errorState);
-			bool mvpFulfilled = !(mCustomPostPass->mModelMatrixUniform == nullptr || mCustomPostPass->mProjectMatrixUniform == nullptr || mCustomPostPass->mViewMatrixUniform == nullptr);
-			if (!errorState.check(mvpFulfilled, "%s: unable to construct mvp uniforms for custom pass", getEntityInstance()->mID.c_str()))
-				return false;
+		return true;
 
-			mCustomPostPass->mUBO = mCustomPostPass->mUBO = mCustomPostPass->mMaterialInstance->getOrCreateUniform("UBO");
-			if (!errorState.check(mCustomPostPass->mUBO != nullptr, "%s: Unable to find UBO struct: %s in material: %s",
-				this->mID.c_str(), uniform::canvaswarp::uboStructWarp, mCustomPostPass->mMaterialInstResource->mMaterial->mID.c_str()))
-				return false;
-			ensureUniformFloat("iTime", mCustomPostPass->mUBO, errorState);
-			ensureUniformFloat("power_to", mCustomPostPass->mUBO, errorState);
-			mCustomPostPass->mUBO->getOrCreateUniform<UniformFloatInstance>("iTime")->setValue(float(getCurrentDateTime().getMilliSecond()));
-			mCustomPostPass->mUBO->getOrCreateUniform<UniformFloatInstance>("power_to")->setValue(1.0);
-			
-			mCustomPostPass->mSamplers["inTextureSampler"] = ensureSampler("inTexture", mCustomPostPass->mMaterialInstance, errorState);
-			mCustomPostPass->mRenderableMesh = mRenderService->createRenderableMesh(*mHeadlessPlaneMesh, *mCustomPostPass->mMaterialInstance, errorState);
-			if (!errorState.check(mCustomPostPass->mRenderableMesh.isValid(), "%s: unable to construct renderable mesh for custom pass", getEntityInstance()->mID.c_str()))
+	}
+
+
+	void RenderCanvasComponentInstance::swapStructure(RenderCanvasComponentInstance& other)
+	{
+		// The video slot is bound to its instance, reconnect it to the player that instance ends up with
+		if (mVideoPlayer != nullptr)
+			mVideoPlayer->VideoChanged.disconnect(mVideoChangedSlot);
+		if (other.mVideoPlayer != nullptr)
+			other.mVideoPlayer->VideoChanged.disconnect(other.mVideoChangedSlot);
+
+		std::swap(mStockCanvasPasses, other.mStockCanvasPasses);
+		std::swap(mRenderGraph, other.mRenderGraph);
+		std::swap(mPlan, other.mPlan);
+		std::swap(mShaderPasses, other.mShaderPasses);
+		std::swap(mIntermediateTargets, other.mIntermediateTargets);
+		std::swap(mIntermediateTextures, other.mIntermediateTextures);
+		std::swap(mMask, other.mMask);
+		std::swap(mVideoPlayer, other.mVideoPlayer);
+		std::swap(mImageSequence, other.mImageSequence);
+		std::swap(mFinalRenderTarget, other.mFinalRenderTarget);
+		std::swap(mFinalTexture, other.mFinalTexture);
+		std::swap(mInterfaceTexture, other.mInterfaceTexture);
+		std::swap(mAspectRatio, other.mAspectRatio);
+		std::swap(mResolution, other.mResolution);
+		std::swap(mHeadlessPlaneMesh, other.mHeadlessPlaneMesh);
+		std::swap(mFinalPlaneMesh, other.mFinalPlaneMesh);
+		std::swap(mPublisher, other.mPublisher);
+		std::swap(mOffsetVec3Uniform, other.mOffsetVec3Uniform);
+		std::swap(mBlendLutSampler, other.mBlendLutSampler);
+		std::swap(mBlendViewportUniform, other.mBlendViewportUniform);
+		std::swap(mBlendEdgesUniform, other.mBlendEdgesUniform);
+		std::swap(mOpaque, other.mOpaque);
+		std::swap(mStale, other.mStale);
+		std::swap(mCornerOffsets, other.mCornerOffsets);
+		std::swap(mMaskRequests, other.mMaskRequests);
+		std::swap(mMaskTextures, other.mMaskTextures);
+		std::swap(mMaskPath, other.mMaskPath);
+		std::swap(mBoundMask, other.mBoundMask);
+		std::swap(mMaskIndex, other.mMaskIndex);
+
+		if (mVideoPlayer != nullptr && mStockCanvasPasses.find(CanvasMaterialType::VIDEO) != mStockCanvasPasses.end())
+			mVideoPlayer->VideoChanged.connect(mVideoChangedSlot);
+		if (other.mVideoPlayer != nullptr && other.mStockCanvasPasses.find(CanvasMaterialType::VIDEO) != other.mStockCanvasPasses.end())
+			other.mVideoPlayer->VideoChanged.connect(other.mVideoChangedSlot);
+	}
+
+	void RenderCanvasComponentInstance::createDefaultPasses(const RenderCanvasComponent& resource, std::vector<CanvasPassNode>& outNodes)
+	{
+		auto add_node = [&outNodes](const std::string& name, ECanvasPassType type)
+		{
+			CanvasPassNode node;
+			node.mName = name;
+			node.mType = type;
+			if (!outNodes.empty())
+				node.mInputs.emplace_back(outNodes.back().mName);
+			outNodes.emplace_back(std::move(node));
+			return &outNodes.back();
+		};
+
+		if (resource.mVideoPlayer != nullptr || resource.mImageSequence != nullptr)
+			add_node("video", ECanvasPassType::Video);
+		if (resource.mPostShader != nullptr)
+			add_node("post", ECanvasPassType::Shader)->mMaterial = resource.mPostShader;
+		if (resource.mMask != nullptr)
+			add_node("mask", ECanvasPassType::Mask);
+	}
+
+
+	bool RenderCanvasComponentInstance::buildRenderGraph(const std::vector<CanvasPassNode>& nodes, const std::string& output, utility::ErrorState& errorState)
+	{
+		// Passes that overwrite every pixel don't need their target cleared.
+		// RGBA frames need no conversion, their readers sample the sequence texture, the video pass only executes when it is the output.
+		bool rgba_frames = mImageSequence != nullptr && mImageSequence->isRGBA();
+		std::vector<bool> opaque;
+		std::vector<bool> external;
+		for (const auto& node : nodes)
+		{
+			opaque.emplace_back(node.mType == ECanvasPassType::Video ||
+				(node.mType == ECanvasPassType::Shader && node.mMaterial != nullptr && node.mMaterial->mBlendMode == EBlendMode::Opaque));
+			external.emplace_back(node.mType == ECanvasPassType::Video && rgba_frames);
+		}
+		if (!errorState.check(mRenderGraph.compile(nodes, output, opaque, external, getComponent<RenderCanvasComponent>()->mFormat, errorState), "%s: invalid pass graph", getEntityInstance()->mID.c_str()))
+			return false;
+		if (!errorState.check(constructTextureAndRenderTarget(mFinalRenderTarget, mFinalTexture, mRenderGraph.getOutputFormat(), true, errorState), "%s: unable to construct final render target", getEntityInstance()->mID.c_str()))
+			return false;
+
+		// Intermediate targets, shared by all passes whose outputs don't overlap in time
+		for (int i = 0; i < mRenderGraph.getIntermediateTargetCount(); i++)
+		{
+			mIntermediateTextures.emplace_back(getEntityInstance()->getCore()->getResourceManager()->createObject<RenderTexture2D>());
+			mIntermediateTargets.emplace_back();
+			if (!errorState.check(constructTextureAndRenderTarget(mIntermediateTargets.back(), mIntermediateTextures.back(), mRenderGraph.getIntermediateTargetFormat(i), true, errorState), "%s: unable to construct internal render target", getEntityInstance()->mID.c_str()))
 				return false;
 		}
 
-		return true;
+		// Instantiate the passes that survived culling, inputs are bound once, the plan doesn't change at runtime
+		bool plays_sequence = false;
+		for (const auto& step : mRenderGraph.getSteps())
+		{
+			const CanvasPassNode& node = nodes[step.mNode];
+			CanvasPass* pass = nullptr;
+			switch (node.mType)
+			{
+			case ECanvasPassType::Video:
+			{
+				if (!errorState.check(mVideoPlayer != nullptr || mImageSequence != nullptr, "%s: video pass %s requires a video player or image sequence", getEntityInstance()->mID.c_str(), node.mName.c_str()))
+					return false;
+				if (!errorState.check(mStockCanvasPasses.find(CanvasMaterialType::VIDEO) == mStockCanvasPasses.end() &&
+					mStockCanvasPasses.find(CanvasMaterialType::FRAME) == mStockCanvasPasses.end() &&
+					mStockCanvasPasses.find(CanvasMaterialType::BLOCK) == mStockCanvasPasses.end(), "%s: only one video pass is supported", getEntityInstance()->mID.c_str()))
+					return false;
+				if (mImageSequence != nullptr)
+				{
+					pass = constructSequencePass(errorState);
+					if (pass == nullptr)
+						return false;
+					plays_sequence = true;
+					break;
+				}
+				// A player that survived a reload keeps playing
+				if (!mVideoPlayer->isPlaying())
+					mVideoPlayer->play();
+				if (!constructCanvasPassItem(CanvasMaterialType::VIDEO, errorState))
+					return false;
+				mVideoPlayer->VideoChanged.connect(mVideoChangedSlot);
+				videoChanged(*mVideoPlayer);
+				pass = &mStockCanvasPasses[CanvasMaterialType::VIDEO];
+				break;
+			}
+			case ECanvasPassType::Mask:
+			{
+				mMask = getComponent<RenderCanvasComponent>()->mMask.get();
+				if (!errorState.check(mMask != nullptr, "%s: mask pass %s requires a mask image", getEntityInstance()->mID.c_str(), node.mName.c_str()))
+					return false;
+				if (!errorState.check(mStockCanvasPasses.find(CanvasMaterialType::MASK) == mStockCanvasPasses.end(), "%s: only one mask pass is supported", getEntityInstance()->mID.c_str()))
+					return false;
+				if (!constructCanvasPassItem(CanvasMaterialType::MASK, errorState))
+					return false;
+				mStockCanvasPasses[CanvasMaterialType::MASK].mSamplers["maskSampler"]->setTexture(*mMask.get());
+				mBoundMask = mMask.get();
+				mMaskPath = mMask->mImagePath;
+				mMaskIndex = getMaskIndex(getComponent<RenderCanvasComponent>()->mMaskFiles, mMaskPath);
+				pass = &mStockCanvasPasses[CanvasMaterialType::MASK];
+				break;
+			}
+			case ECanvasPassType::Shader:
+			{
+				mShaderPasses.emplace_back(constructShaderPass(node.mMaterial, errorState));
+				if (mShaderPasses.back() == nullptr)
+					return false;
+				pass = mShaderPasses.back().get();
+				break;
+			}
+			}
+
+			for (const auto& input : step.mInputs)
+			{
+				Sampler2DInstance* sampler = ensureSampler(input.mSampler, pass->mMaterialInstance.get(), errorState);
+				if (sampler == nullptr)
+					return false;
+				if (input.mTarget == CanvasRenderGraph::externalTarget)
+				{
+					sampler->setTexture(mImageSequence->getTexture());
+					plays_sequence = true;
+				}
+				else
+					sampler->setTexture(getGraphTarget(input.mTarget).getColorTexture());
+			}
+			mPlan.push_back({ pass, &getGraphTarget(step.mTarget), step.mClear });
+		}
 
+		// A sequence that survived a reload keeps playing
+		if (plays_sequence && !mImageSequence->isPlaying())
+			mImageSequence->play();
+
+		// Only the video pass is known to write an alpha of 1, canvases that end with it hide everything below them.
+		// RGBA and block compressed frames keep their own alpha.
+		const auto& steps = mRenderGraph.getSteps();
+		bool frame_alpha = mImageSequence != nullptr && !mImageSequence->isYUV();
+		mOpaque = !steps.empty() && nodes[steps.back().mNode].mType == ECanvasPassType::Video && !frame_alpha;
+		mStale = true;
+		return true;
 	}
 
-	void RenderCanvasComponentInstance::drawAllHeadlessPasses() {
-		if (mStockCanvasPasses.find(CanvasMaterialType::MASK) != mStockCanvasPasses.end() || mCustomPostPass != nullptr)
+
+	RenderCanvasComponentInstance::CanvasPass* RenderCanvasComponentInstance::constructSequencePass(utility::ErrorState& errorState)
+	{
+		// RGBA frames are copied as they are, block compressed frames are expanded by the block shader,
+		// YUV frames are converted by the stock video shader
+		if (mImageSequence->isRGBA())
 		{
-			//mask pass or custom pass present, render video into internal render target so it can be used in the mask/custom materials sampler
-			mCurrentInternalRT = mDoubleBufferTarget[0];
+			if (!constructCanvasPassItem(CanvasMaterialType::FRAME, errorState))
+				return nullptr;
+			CanvasPass& pass = mStockCanvasPasses[CanvasMaterialType::FRAME];
+			pass.mSamplers["inTextureSampler"]->setTexture(mImageSequence->getTexture());
+			return &pass;
 		}
-		else 
+
+		if (mImageSequence->isBlockCompressed())
 		{
-			//no mask pass
-			mCurrentInternalRT = mFinalRenderTarget;
+			if (!constructCanvasPassItem(CanvasMaterialType::BLOCK, errorState))
+				return nullptr;
+			CanvasPass& pass = mStockCanvasPasses[CanvasMaterialType::BLOCK];
+			pass.mSamplers["inTextureSampler"]->setTexture(mImageSequence->getBlockTexture());
+			UniformVec2Instance* size = pass.mUBO->getOrCreateUniform<UniformVec2Instance>(uniform::block::size);
+			UniformIntInstance* format = pass.mUBO->getOrCreateUniform<UniformIntInstance>(uniform::block::format);
+			if (!errorState.check(size != nullptr && format != nullptr, "%s: unable to find block uniforms in material: %s", getEntityInstance()->mID.c_str(), pass.mMaterial->mID.c_str()))
+				return nullptr;
+			size->setValue(glm::vec2(mImageSequence->getWidth(), mImageSequence->getHeight()));
+			format->setValue(mImageSequence->getFormat() == imagesequence::EFormat::BC1 ? 0 : 1);
+			return &pass;
 		}
-		if (mStockCanvasPasses.find(CanvasMaterialType::VIDEO) != mStockCanvasPasses.end()) {
-			drawHeadlessPass(mStockCanvasPasses[CanvasMaterialType::VIDEO]);
+
+		if (!constructCanvasPassItem(CanvasMaterialType::VIDEO, errorState))
+			return nullptr;
+		CanvasPass& pass = mStockCanvasPasses[CanvasMaterialType::VIDEO];
+		pass.mSamplers["YSampler"]->setTexture(mImageSequence->getYTexture());
+		pass.mSamplers["USampler"]->setTexture(mImageSequence->getUTexture());
+		pass.mSamplers["VSampler"]->setTexture(mImageSequence->getVTexture());
+		return &pass;
+	}
+
+
+	std::unique_ptr<RenderCanvasComponentInstance::CanvasPass> RenderCanvasComponentInstance::constructShaderPass(ResourcePtr<Material> material, utility::ErrorState& errorState)
+	{
+		auto pass = std::make_unique<CanvasPass>();
+		pass->mMaterial = material;
+		pass->mMaterialInstResource = std::make_unique<MaterialInstanceResource>(MaterialInstanceResource());
+		pass->mMaterialInstResource->mBlendMode = material->mBlendMode;
+		pass->mMaterialInstResource->mDepthMode = material->mDepthMode;
+		pass->mMaterialInstResource->mMaterial = material;
+		pass->mMaterialInstance = std::make_unique<MaterialInstance>();
+		if (!errorState.check(pass->mMaterialInstance->init(*mRenderService, *pass->mMaterialInstResource, errorState), "%s: unable to instance material", this->mID.c_str()))
+			return nullptr;
+
+		//create mvp struct on material instance, regardless of type
+		pass->mMVPStruct = pass->mMaterialInstance->getOrCreateUniform(uniform::mvpStruct);
+		if (!errorState.check(pass->mMVPStruct != nullptr, "%s: Unable to find uniform MVP struct: %s in material: %s",
+			this->mID.c_str(), uniform::mvpStruct, material->mID.c_str()))
+			return nullptr;
+
+		// Get all matrices
+		pass->mModelMatrixUniform = pass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::modelMatrix);
+		pass->mProjectMatrixUniform = pass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::projectionMatrix);
+		pass->mViewMatrixUniform = pass->mMVPStruct->getOrCreateUniform<UniformMat4Instance>(uniform::viewMatrix);
+		bool mvpFulfilled = !(pass->mModelMatrixUniform == nullptr || pass->mProjectMatrixUniform == nullptr || pass->mViewMatrixUniform == nullptr);
+		if (!errorState.check(mvpFulfilled, "%s: unable to construct mvp uniforms for custom pass", getEntityInstance()->mID.c_str()))
+			return nullptr;
+
+		// The UBO is optional, not every post shader has parameters
+		pass->mUBO = pass->mMaterialInstance->getOrCreateUniform("UBO");
+		pass->mParameters = std::make_unique<ShaderParameterTable>();
+		if (!pass->mParameters->init(*pass->mMaterialInstance, "UBO", errorState))
+		{
+			errorState.fail("%s: unable to reflect parameters of material: %s", getEntityInstance()->mID.c_str(), material->mID.c_str());
+			return nullptr;
 		}
-		
-		if (mCustomPostPass != nullptr) {
-			mCustomPostPass->mSamplers["inTextureSampler"]->setTexture(*mCurrentInternalRT->mColorTexture);
-			mCustomPostPass->mUBO->getOrCreateUniform<UniformFloatInstance>("iTime")->setValue(float(getEntityInstance()->getCore()->getElapsedTime()));
-			mCurrentInternalRT = (mStockCanvasPasses.find(CanvasMaterialType::MASK) != mStockCanvasPasses.end()) ? mDoubleBufferTarget[1] : mFinalRenderTarget;
-			drawHeadlessPass(*mCustomPostPass);
+
+		pass->mRenderableMesh = mRenderService->createRenderableMesh(*mHeadlessPlaneMesh, *pass->mMaterialInstance.get(), errorState);
+		if (!errorState.check(pass->mRenderableMesh.isValid(), "%s: unable to construct renderable mesh for custom pass", getEntityInstance()->mID.c_str()))
+			return nullptr;
+		return pass;
+	}
+
+
+	CanvasRenderTarget& RenderCanvasComponentInstance::getGraphTarget(int index)
+	{
+		return index == CanvasRenderGraph::finalTarget ? *mFinalRenderTarget : *mIntermediateTargets[index];
+	}
+
+
+	void RenderCanvasComponentInstance::prepareHeadlessPasses(std::vector<CanvasCommandRecorder::Packet>& outPackets)
+	{
+		FOGLIO_TRACE_ZONE_DETAIL("Canvas::prepareHeadlessPasses", getEntityInstance()->mID);
+		const FrameTime& frame_time = mFoglioService->getFrameTime();
+		mStale = false;
+		for (const auto& step : mPlan)
+		{
+			if (step.mPass->mParameters != nullptr)
+				step.mPass->mParameters->update(frame_time);
+			outPackets.emplace_back(prepareHeadlessPass(*step.mPass, *step.mTarget));
+			outPackets.back().mTarget = step.mTarget;
+			outPackets.back().mClear = step.mClear;
 		}
+	}
+
 
-		if (mStockCanvasPasses.find(CanvasMaterialType::MASK) != mStockCanvasPasses.end())
+	void RenderCanvasComponentInstance::setUpdateRate(ECanvasUpdateRate rate, float hz, int frames)
+	{
+		mUpdateRate = rate;
+		mUpdateHz = std::max(hz, 0.1f);
+		mUpdateFrames = std::max(frames, 1);
+	}
+
+
+	void RenderCanvasComponentInstance::drawAllHeadlessPasses()
+	{
+		FOGLIO_TRACE_ZONE_DETAIL("Canvas::drawAllHeadlessPasses", getEntityInstance()->mID);
+		mInlinePackets.clear();
+		prepareHeadlessPasses(mInlinePackets);
+
+		VkCommandBuffer command_buffer = mRenderService->getCurrentCommandBuffer();
+		for (const auto& packet : mInlinePackets)
 		{
-			mStockCanvasPasses[CanvasMaterialType::MASK].mSamplers["inTextureSampler"]->setTexture(*mCurrentInternalRT->mColorTexture);
-			mCurrentInternalRT = mFinalRenderTarget;
-			drawHeadlessPass(mStockCanvasPasses[CanvasMaterialType::MASK]);
+			packet.mTarget->beginRendering(VK_SUBPASS_CONTENTS_INLINE, packet.mClear);
+			CanvasCommandRecorder::recordDraw(command_buffer, packet);
+			packet.mTarget->endRendering();
 		}
 	}
 
-	void RenderCanvasComponentInstance::drawHeadlessPass(CanvasPass& pass)
+
+	CanvasCommandRecorder::Packet RenderCanvasComponentInstance::prepareHeadlessPass(CanvasPass& pass, IRenderTarget& target)
 	{
 		// Create orthographic projection matrix
-		glm::ivec2 size = mCurrentInternalRT->getBufferSize();
+		glm::ivec2 size = target.getBufferSize();
 		glm::mat4 proj_matrix = OrthoCameraComponentInstance::createRenderProjectionMatrix(0.0f, (float)size.x, 0.0f, (float)size.y);
 		// Update the model matrix so that the plane mesh is of the same size as the render target
 		// maybe do this only on update and store in member when window is resized for example to prevent unnecessary calculations
-		computeModelMatrixFullscreen(mModelMatrix);
+		computeModelMatrixFullscreen(size, mModelMatrix);
 		// Update matrices, projection and model are required
 		pass.mModelMatrixUniform->setValue(mModelMatrix);
 		pass.mProjectMatrixUniform->setValue(proj_matrix);
 		pass.mViewMatrixUniform->setValue(glm::mat4());
-		//get descriptor set
-		const DescriptorSet* descriptor_set = &pass.mMaterialInstance->update();
-		draw(pass.mRenderableMesh, descriptor_set);
-	}
 
-	void RenderCanvasComponentInstance::draw(RenderableMesh renderableMesh, const DescriptorSet* descriptor_set)
-	{
-		// Get current command buffer, should be headless.
-		VkCommandBuffer command_buffer = mRenderService->getCurrentCommandBuffer();
-
-		//begin headless rendering
-		mCurrentInternalRT->beginRendering();
-
-		// Gather draw info
-		MeshInstance& mesh_instance = renderableMesh.getMesh().getMeshInstance();
-		GPUMesh& mesh = mesh_instance.getGPUMesh();
+		CanvasCommandRecorder::Packet packet;
+		packet.mDescriptorSet = pass.mMaterialInstance->update().mSet;
+		packet.mMesh = &pass.mRenderableMesh;
 
 		// Get pipeline to to render with
 		utility::ErrorState error_state;
-		RenderService::Pipeline pipeline = mRenderService->getOrCreatePipeline(*mCurrentInternalRT, renderableMesh.getMesh(), renderableMesh.getMaterialInstance(), error_state);
-		vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.mPipeline);
-		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.mLayout, 0, 1, &descriptor_set->mSet, 0, nullptr);
-
-		// Bind buffers and draw
-		const std::vector<VkBuffer>& vertexBuffers = renderableMesh.getVertexBuffers();
-		const std::vector<VkDeviceSize>& vertexBufferOffsets = renderableMesh.getVertexBufferOffsets();
-
-		vkCmdBindVertexBuffers(command_buffer, 0, vertexBuffers.size(), vertexBuffers.data(), vertexBufferOffsets.data());
-		for (int index = 0; index < mesh_instance.getNumShapes(); ++index)
-		{
-			const IndexBuffer& index_buffer = mesh.getIndexBuffer(index);
-			vkCmdBindIndexBuffer(command_buffer, index_buffer.getBuffer(), 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(command_buffer, index_buffer.getCount(), 1, 0, 0, 0);
-		}
-
-		mCurrentInternalRT->endRendering();
+		packet.mPipeline = mRenderService->getOrCreatePipeline(target, pass.mRenderableMesh.getMesh(), *pass.mMaterialInstance, error_state);
+		return packet;
 	}
 
 	void RenderCanvasComponentInstance::drawInterface(rtti::ObjectPtr<RenderTarget> interfaceTarget)
 	{
-		mCurrentInternalRT = interfaceTarget;
-		drawHeadlessPass(mStockCanvasPasses[CanvasMaterialType::INTERFACE]);
+		mInterfaceTexture = interfaceTarget->mColorTexture;
+		CanvasCommandRecorder::Packet packet = prepareHeadlessPass(mStockCanvasPasses[CanvasMaterialType::INTERFACE], *interfaceTarget);
+		interfaceTarget->beginRendering();
+		CanvasCommandRecorder::recordDraw(mRenderService->getCurrentCommandBuffer(), packet);
+		interfaceTarget->endRendering();
 	}
 
 	void RenderCanvasComponentInstance::setFinalSampler(bool isInterface) 
 	{
 		if (isInterface) {
-			mStockCanvasPasses[CanvasMaterialType::WARP].mSamplers["inTextureSampler"]->setTexture(*mCurrentInternalRT->mColorTexture);
+			mStockCanvasPasses[CanvasMaterialType::WARP].mSamplers["inTextureSampler"]->setTexture(*mInterfaceTexture);
 		}
 		else {
 			mStockCanvasPasses[CanvasMaterialType::WARP].mSamplers["inTextureSampler"]->setTexture(*mFinalTexture);
@@ -270,12 +564,21 @@ namespace nap
 
 	void RenderCanvasComponentInstance::onDraw(IRenderTarget& renderTarget, VkCommandBuffer commandBuffer, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
 	{
+		FOGLIO_TRACE_ZONE_DETAIL("Canvas::onDraw", getEntityInstance()->mID);
 		// compute the model matrix with aspect ratio calculated with outputTexture and size and position with mTransformComponent
 		
-		computeModelMatrix(renderTarget, mModelMatrix, mFinalTexture, mTransformComponent);
-		
-			
-		mStockCanvasPasses[CanvasMaterialType::WARP].mModelMatrixUniform->setValue(mModelMatrix);
+		// Outputs use the layout computed for this frame, the controls view fits the virtual canvas space in its target
+		if (mIsControlViewDraw)
+		{
+			mBlendEdgesUniform->setValue(glm::vec4(0.0f));
+			computeModelMatrix(renderTarget, mModelMatrix, mFinalTexture, mTransformComponent);
+			mStockCanvasPasses[CanvasMaterialType::WARP].mModelMatrixUniform->setValue(mModelMatrix);
+		}
+		else
+		{
+			assert(mSnapshotDraw != nullptr || mRegistryIndex >= 0);
+			mStockCanvasPasses[CanvasMaterialType::WARP].mModelMatrixUniform->setValue(mSnapshotDraw != nullptr ? mSnapshotDraw->mModelMatrix : mFoglioService->getCanvasRegistry().getModelMatrices()[mRegistryIndex]);
+		}
 
 		// Update matrices, projection and model are required
 		mStockCanvasPasses[CanvasMaterialType::WARP].mProjectMatrixUniform->setValue(projectionMatrix);
@@ -342,6 +645,22 @@ namespace nap
 			pass->mMaterial = mRenderService->getOrCreateMaterial<MaskShader>(error);
 			break;
 		}
+		case CanvasMaterialType::FRAME: {
+			//create frame copy material, overwrites every pixel like the video material
+			pass->mMaterialInstResource = std::make_unique<MaterialInstanceResource>(MaterialInstanceResource());
+			pass->mMaterialInstResource->mBlendMode = EBlendMode::Opaque;
+			pass->mMaterialInstResource->mDepthMode = EDepthMode::NoReadWrite;
+			pass->mMaterial = mRenderService->getOrCreateMaterial<FrameShader>(error);
+			break;
+		}
+		case CanvasMaterialType::BLOCK: {
+			//create block expansion material, overwrites every pixel like the video material
+			pass->mMaterialInstResource = std::make_unique<MaterialInstanceResource>(MaterialInstanceResource());
+			pass->mMaterialInstResource->mBlendMode = EBlendMode::Opaque;
+			pass->mMaterialInstResource->mDepthMode = EDepthMode::NoReadWrite;
+			pass->mMaterial = mRenderService->getOrCreateMaterial<BlockShader>(error);
+			break;
+		}
 		default:
 		{
 			nap::Logger::info("Unspecified shader in Canvas::constructMaterialInstance");
@@ -353,7 +672,7 @@ namespace nap
 			return false;
 		if (!error.check(pass->mMaterial != nullptr, "%s: unable to get or create material", mID.c_str()))
 			return false;
-		pass->mMaterialInstance = new MaterialInstance();
+		pass->mMaterialInstance = std::make_unique<MaterialInstance>();
 		pass->mMaterialInstResource->mMaterial = pass->mMaterial;
 		if (!error.check(pass->mMaterialInstance->init(*mRenderService, *pass->mMaterialInstResource, error), "%s: unable to instance material", this->mID.c_str())) {
 			return false;
@@ -378,9 +697,9 @@ namespace nap
 
 		case CanvasMaterialType::VIDEO:
 		{
-			pass->mSamplers["YSampler"] = ensureSampler(uniform::video::sampler::YSampler, pass->mMaterialInstance, error);
-			pass->mSamplers["USampler"] = ensureSampler(uniform::video::sampler::USampler, pass->mMaterialInstance, error);
-			pass->mSamplers["VSampler"] = ensureSampler(uniform::video::sampler::VSampler, pass->mMaterialInstance, error);
+			pass->mSamplers["YSampler"] = ensureSampler(uniform::video::sampler::YSampler, pass->mMaterialInstance.get(), error);
+			pass->mSamplers["USampler"] = ensureSampler(uniform::video::sampler::USampler, pass->mMaterialInstance.get(), error);
+			pass->mSamplers["VSampler"] = ensureSampler(uniform::video::sampler::VSampler, pass->mMaterialInstance.get(), error);
 			if (pass->mSamplers["YSampler"] == nullptr || pass->mSamplers["USampler"] == nullptr || pass->mSamplers["VSampler"] == nullptr)
 				return false;
 			break;
@@ -388,7 +707,7 @@ namespace nap
 
 		case CanvasMaterialType::WARP:
 		{
-			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::canvaswarp::sampler::inTexture, pass->mMaterialInstance, error);
+			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::canvaswarp::sampler::inTexture, pass->mMaterialInstance.get(), error);
 			if (pass->mSamplers["inTextureSampler"] == nullptr)
 				return false;
 
@@ -401,12 +720,25 @@ namespace nap
 			ensureUniformVec3(uniform::canvaswarp::topRight, pass->mUBO, error);
 			ensureUniformVec3(uniform::canvaswarp::bottomLeft, pass->mUBO, error);
 			ensureUniformVec3(uniform::canvaswarp::bottomRight, pass->mUBO, error);
+
+			// Edge blending, disabled until an output assigns its ramp
+			mBlendLutSampler = ensureSampler(uniform::canvaswarp::sampler::blendLut, pass->mMaterialInstance.get(), error);
+			UniformStructInstance* blend_struct = pass->mMaterialInstance->getOrCreateUniform(uniform::canvaswarp::uboStructBlend);
+			if (!error.check(mBlendLutSampler != nullptr && blend_struct != nullptr, "%s: Unable to find edge blend uniforms in material: %s",
+				this->mID.c_str(), pass->mMaterial->mID.c_str()))
+				return false;
+			mBlendViewportUniform = blend_struct->getOrCreateUniform<UniformVec4Instance>(uniform::canvaswarp::blendViewport);
+			mBlendEdgesUniform = blend_struct->getOrCreateUniform<UniformVec4Instance>(uniform::canvaswarp::blendEdges);
+			if (!error.check(mBlendViewportUniform != nullptr && mBlendEdgesUniform != nullptr, "%s: Unable to find edge blend uniforms in material: %s",
+				this->mID.c_str(), pass->mMaterial->mID.c_str()))
+				return false;
+			mBlendViewportUniform->setValue(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
 			break;
 		}
 
 		case CanvasMaterialType::INTERFACE:
 		{
-			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::canvasinterface::sampler::inTexture, pass->mMaterialInstance, error);
+			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::canvasinterface::sampler::inTexture, pass->mMaterialInstance.get(), error);
 			if (pass->mSamplers["inTextureSampler"] == nullptr)
 				return false;
 			pass->mUBO = pass->mMaterialInstance->getOrCreateUniform(uniform::canvasinterface::uboStructInterface);
@@ -420,13 +752,33 @@ namespace nap
 
 		case CanvasMaterialType::MASK:
 		{
-			nap::Logger::info("Constructing mask pass");
-			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::mask::sampler::inTexture, pass->mMaterialInstance, error);
-			pass->mSamplers["maskSampler"] = ensureSampler(uniform::mask::sampler::maskTexture, pass->mMaterialInstance, error);
+			FOGLIO_TRACE_ZONE_DETAIL("Canvas::constructMaskPass", getEntityInstance()->mID);
+			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::mask::sampler::inTexture, pass->mMaterialInstance.get(), error);
+			pass->mSamplers["maskSampler"] = ensureSampler(uniform::mask::sampler::maskTexture, pass->mMaterialInstance.get(), error);
 			if (pass->mSamplers["inTextureSampler"] == nullptr || pass->mSamplers["maskSampler"] == nullptr)
 				return false;
 			break;
 		}
+
+		case CanvasMaterialType::FRAME:
+		{
+			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::frame::sampler::inTexture, pass->mMaterialInstance.get(), error);
+			if (pass->mSamplers["inTextureSampler"] == nullptr)
+				return false;
+			break;
+		}
+
+		case CanvasMaterialType::BLOCK:
+		{
+			pass->mSamplers["inTextureSampler"] = ensureSampler(uniform::block::sampler::inTexture, pass->mMaterialInstance.get(), error);
+			if (pass->mSamplers["inTextureSampler"] == nullptr)
+				return false;
+			pass->mUBO = pass->mMaterialInstance->getOrCreateUniform(uniform::block::uboStruct);
+			if (!error.check(pass->mUBO != nullptr, "%s: Unable to find UBO struct: %s in material: %s",
+				this->mID.c_str(), uniform::block::uboStruct, pass->mMaterial->mID.c_str()))
+				return false;
+			break;
+		}
 		default:
 		{
 			nap::Logger::info("Unspecified shader in Canvas::constructMaterialInstance");
@@ -434,9 +786,9 @@ namespace nap
 		}
 		}
 		if (type == CanvasMaterialType::WARP) {
-			pass->mRenderableMesh = mRenderService->createRenderableMesh(*mFinalPlaneMesh, *pass->mMaterialInstance, error);
+			pass->mRenderableMesh = mRenderService->createRenderableMesh(*mFinalPlaneMesh, *pass->mMaterialInstance.get(), error);
 		}
-		pass->mRenderableMesh = mRenderService->createRenderableMesh(*mHeadlessPlaneMesh, *pass->mMaterialInstance, error);
+		pass->mRenderableMesh = mRenderService->createRenderableMesh(*mHeadlessPlaneMesh, *pass->mMaterialInstance.get(), error);
 		if (pass->mRenderableMesh.isValid())
 			return true;
 	}
@@ -481,21 +833,27 @@ namespace nap
 
 	void RenderCanvasComponentInstance::videoChanged(VideoPlayer& player)
 	{
-		nap::Logger::info("Video Changed for Canvas: %s", getEntityInstance()->mID.c_str());
+		FOGLIO_TRACE_ZONE_DETAIL("Canvas::videoChanged", getEntityInstance()->mID);
 		mStockCanvasPasses[CanvasMaterialType::VIDEO].mSamplers["YSampler"]->setTexture(player.getYTexture());
 		mStockCanvasPasses[CanvasMaterialType::VIDEO].mSamplers["USampler"]->setTexture(player.getUTexture());
 		mStockCanvasPasses[CanvasMaterialType::VIDEO].mSamplers["VSampler"]->setTexture(player.getVTexture());
 	}
 
+	void RenderCanvasComponentInstance::setVideoSource(VideoPlayer& player)
+	{
+		if (mStockCanvasPasses.find(CanvasMaterialType::VIDEO) != mStockCanvasPasses.end())
+			videoChanged(player);
+	}
+
 	bool RenderCanvasComponentInstance::isSupported(nap::CameraComponentInstance& camera) const
 	{
 		return camera.get_type().is_derived_from(RTTI_OF(OrthoCameraComponentInstance));
 	}
 
-	void RenderCanvasComponentInstance::computeModelMatrixFullscreen(glm::mat4& outMatrix) {
+	void RenderCanvasComponentInstance::computeModelMatrixFullscreen(const glm::ivec2& targetSize, glm::mat4& outMatrix) {
 		//aspect ratio should be right because we set mTarget textures height and width to video players?
 		// Transform to middle of target
-		glm::ivec2 tex_size = mCurrentInternalRT->getBufferSize();
+		const glm::ivec2& tex_size = targetSize;
 		outMatrix = glm::translate(glm::mat4(), glm::vec3(
 			tex_size.x / 2.0f,
 			tex_size.y / 2.0f,
@@ -507,14 +865,13 @@ namespace nap
 
 	void RenderCanvasComponentInstance::computeModelMatrix(const nap::IRenderTarget& target, glm::mat4& outMatrix, ResourcePtr<RenderTexture2D> canvas_output_texture, TransformComponentInstance* transform_comp)
 	{
-		mMainWindowPtr = getEntityInstance()->getCore()->getResourceManager()->findObject<RenderWindow>("MainWindow");
 		//target is control window
 		if (mIsControlViewDraw)
 		{
 			glm::vec3 translate = transform_comp->getTranslate();
 			glm::vec3 scale = transform_comp->getScale();
 			glm::ivec2 canvas_tex_size = canvas_output_texture->getSize();
-			glm::ivec2 target_size_main = mMainWindowPtr->getBufferSize();
+			glm::ivec2 target_size_main = mVirtualSize;
 			glm::ivec2 target_size_controls = target.getBufferSize();
 
 			
@@ -550,39 +907,61 @@ namespace nap
 				viewport_size.y * scale.y,
 				1.0f));
 		}
-		//target is main window
-		else {
-			glm::vec3 translate = transform_comp->getTranslate();
-			glm::vec3 scale = transform_comp->getScale();
-			glm::ivec2 canvas_tex_size = canvas_output_texture->getSize();
-			glm::ivec2 tex_size = target.getBufferSize();
-			glm::ivec2 new_size;
-			outMatrix = glm::translate(glm::mat4(), glm::vec3(
-				translate.x * tex_size.x + tex_size.x / 2.0f,
-				translate.y * tex_size.y + tex_size.y / 2.0f,
-				0.0f));
-			// Scale correlating to target
-			// Calculate ratio
-			float canvas_ratio = static_cast<float>(canvas_tex_size.x) / static_cast<float>(canvas_tex_size.y);
-			float window_ratio = static_cast<float>(tex_size.x) / static_cast<float>(tex_size.y);
+	}
 
-			if (window_ratio > canvas_ratio) {
-				tex_size.x = tex_size.y * canvas_ratio;
-			}
-			else {
-				tex_size.y = tex_size.x / canvas_ratio;
-			}
+	void RenderCanvasComponentInstance::updateLayout(const glm::ivec2& virtualSize, glm::mat4& outMatrix, glm::vec4& outBounds, glm::vec4& outOccluderBounds)
+	{
+		mVirtualSize = virtualSize;
+		glm::vec3 translate = mTransformComponent->getTranslate();
+		glm::vec3 scale = mTransformComponent->getScale();
+		glm::ivec2 canvas_tex_size = mFinalTexture->getSize();
+		glm::ivec2 tex_size = virtualSize;
+		outMatrix = glm::translate(glm::mat4(), glm::vec3(
+			translate.x * tex_size.x + tex_size.x / 2.0f,
+			translate.y * tex_size.y + tex_size.y / 2.0f,
+			0.0f));
+		// Scale correlating to virtual canvas space
+		// Calculate ratio
+		float canvas_ratio = static_cast<float>(canvas_tex_size.x) / static_cast<float>(canvas_tex_size.y);
+		float window_ratio = static_cast<float>(tex_size.x) / static_cast<float>(tex_size.y);
 
-			outMatrix = glm::scale(outMatrix, glm::vec3(tex_size.x * scale.x, tex_size.y * scale.y, 1.0f));
-			//outMatrix = glm::rotate(outMatrix, transform_comp->getRotate());
+		if (window_ratio > canvas_ratio) {
+			tex_size.x = tex_size.y * canvas_ratio;
 		}
+		else {
+			tex_size.y = tex_size.x / canvas_ratio;
+		}
+		outMatrix = glm::scale(outMatrix, glm::vec3(tex_size.x * scale.x, tex_size.y * scale.y, 1.0f));
 
-		
+		// Bounds of the warped quad, the warp interpolates bilinearly between the corners so the corners bound the quad
+		const glm::vec2 corners[4] =
+		{
+			glm::vec2(-0.5f,  0.5f) + glm::vec2( mCornerOffsets[0].x, -mCornerOffsets[0].y),
+			glm::vec2( 0.5f,  0.5f) + glm::vec2(-mCornerOffsets[1].x, -mCornerOffsets[1].y),
+			glm::vec2(-0.5f, -0.5f) + glm::vec2( mCornerOffsets[2].x,  mCornerOffsets[2].y),
+			glm::vec2( 0.5f, -0.5f) + glm::vec2(-mCornerOffsets[3].x,  mCornerOffsets[3].y)
+		};
+		glm::vec2 warped[4];
+		outBounds = glm::vec4(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+		for (int i = 0; i < 4; i++)
+		{
+			warped[i] = glm::vec2(outMatrix * glm::vec4(corners[i], 0.0f, 1.0f));
+			outBounds = glm::vec4(glm::min(glm::vec2(outBounds), warped[i]), glm::max(glm::vec2(outBounds.z, outBounds.w), warped[i]));
+		}
 
+		// Largest rectangle bounded by the 4 edges, every edge lies on the outside of it.
+		// Empty when the quad is flipped or folded, such a canvas never occludes others.
+		outOccluderBounds = glm::vec4(
+			glm::max(warped[0].x, warped[2].x), glm::max(warped[2].y, warped[3].y),
+			glm::min(warped[1].x, warped[3].x), glm::min(warped[0].y, warped[1].y));
 	}
 
-	bool RenderCanvasComponentInstance::constructTextureAndRenderTarget(ResourcePtr<RenderTarget>& renderTarget, ResourcePtr<RenderTexture2D>& texture, bool transparent, utility::ErrorState& errorState) {
+	bool RenderCanvasComponentInstance::constructTextureAndRenderTarget(std::unique_ptr<CanvasRenderTarget>& renderTarget, ResourcePtr<RenderTexture2D>& texture, ECanvasTextureFormat format, bool transparent, utility::ErrorState& errorState) {
 		//init mOutputTexture TODO: resize when videoChanged event?
+		// Size of the frames the canvas plays, the output follows it when no resolution or aspect ratio is set
+		bool has_source = mVideoPlayer != nullptr || mImageSequence != nullptr;
+		int source_width = mVideoPlayer != nullptr ? mVideoPlayer->getWidth() : mImageSequence != nullptr ? mImageSequence->getWidth() : 0;
+		int source_height = mVideoPlayer != nullptr ? mVideoPlayer->getHeight() : mImageSequence != nullptr ? mImageSequence->getHeight() : 0;
 		int width;
 		int height;
 		if (*mResolution >= 20) { // to establish a minimum texture resolution
@@ -591,14 +970,14 @@ namespace nap
 				height = *mResolution;
 			}
 			else {
-				if (mVideoPlayer != nullptr) {
-					if (mVideoPlayer->getWidth() >= mVideoPlayer->getHeight()) {
-						width = *mResolution * mVideoPlayer->getWidth()/mVideoPlayer->getHeight();
+				if (has_source) {
+					if (source_width >= source_height) {
+						width = *mResolution * source_width/source_height;
 						height = *mResolution;
 					}
 					else {
 						width = *mResolution;
-						height = *mResolution * mVideoPlayer->getHeight()/mVideoPlayer->getWidth();
+						height = *mResolution * source_height/source_width;
 					}
 				}
 				else {
@@ -608,10 +987,10 @@ namespace nap
 			}
 		}
 		else {
-			if (mVideoPlayer != nullptr)
+			if (has_source)
 			{
 				if (*mAspectRatio > 0.05) {
-					int max = std::max(mVideoPlayer->getWidth(), mVideoPlayer->getHeight());
+					int max = std::max(source_width, source_height);
 					if (max < 20) {
 						max = 20;
 					}
@@ -619,8 +998,8 @@ namespace nap
 					height = max / (*mAspectRatio);
 				}
 				else {
-					width = mVideoPlayer->getWidth();
-					height = mVideoPlayer->getHeight();
+					width = source_width;
+					height = source_height;
 				}
 				
 			}
@@ -629,20 +1008,14 @@ namespace nap
 		
 		texture->mWidth = width;
 		texture->mHeight = height;
-		texture->mFormat = RenderTexture2D::EFormat::RGBA8;
+		texture->mFormat = toRenderTextureFormat(format);
 		if (!texture->init(errorState))
 			return false;
-		if (transparent) {
-			renderTarget->mClearColor = RGBAColor8(255, 255, 255, 0).convert<RGBAColorFloat>();
-		}
-		else {
-			renderTarget->mClearColor = RGBColor8(255, 0, 0).convert<RGBColorFloat>();
-		}
-		renderTarget->mColorTexture = texture;
-		renderTarget->mSampleShading = true;
-		renderTarget->mRequestedSamples = ERasterizationSamples::One;
-		if (!renderTarget->init(errorState))
-			return false;
+		RGBAColorFloat clear_color = transparent ?
+			RGBAColor8(255, 255, 255, 0).convert<RGBAColorFloat>() :
+			RGBAColor8(255, 0, 0, 255).convert<RGBAColorFloat>();
+		renderTarget = std::make_unique<CanvasRenderTarget>(*mRenderService);
+		return renderTarget->init(*texture, clear_color, errorState);
 	}
 
 	bool RenderCanvasComponentInstance::setupPlaneMesh(ResourcePtr<PlaneMesh> planeMesh, int resX, int resY, nap::utility::ErrorState errorState) {
@@ -657,7 +1030,168 @@ namespace nap
 		return errorState.check(planeMesh->getMeshInstance().init(errorState), "Unable to initialize plane mesh instance %s", mID.c_str());
 	}
 
-	void RenderCanvasComponentInstance::setCornerOffsets(std::vector<glm::vec2> offsets) {
+	void RenderCanvasComponentInstance::setEdgeBlend(const glm::vec4& viewport, const glm::vec4& edges, Texture2D& lut)
+	{
+		mBlendViewportUniform->setValue(viewport);
+		mBlendEdgesUniform->setValue(edges);
+		if (&mBlendLutSampler->getTexture() != &lut)
+			mBlendLutSampler->setTexture(lut);
+	}
+
+	void RenderCanvasComponentInstance::drawSnapshot(IRenderTarget& renderTarget, VkCommandBuffer commandBuffer, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const CanvasFrameSnapshot::Draw& draw)
+	{
+		// The warp uniforms are copied into the descriptor set of this draw, restoring them doesn't affect it
+		mSnapshotDraw = &draw;
+		setWarpCornerUniforms(draw.mCornerOffsets.data());
+		this->draw(renderTarget, commandBuffer, viewMatrix, projectionMatrix);
+		setWarpCornerUniforms();
+		mSnapshotDraw = nullptr;
+	}
+
+	void RenderCanvasComponentInstance::update(double deltaTime)
+	{
+		if (mMaskRequests.empty() && mMaskTextures.empty())
+			return;
+
+		// Create the textures of decoded masks, their pixels are copied through a staging buffer at the start of the next render frame
+		int frame = mFoglioService->getFrameTime().mFrame;
+		for (auto it = mMaskRequests.begin(); it != mMaskRequests.end();)
+		{
+			MaskLoader::Request& request = **it;
+			if (!request.mDone)
+			{
+				++it;
+				continue;
+			}
+
+			utility::ErrorState error_state;
+			auto texture = std::make_unique<Texture2D>(*getEntityInstance()->getCore());
+			texture->mID = utility::stringFormat("%s mask %s", getEntityInstance()->mID.c_str(), request.mPath.c_str());
+			if (request.mSucceeded && texture->init(request.mBitmap.mSurfaceDescriptor, false, request.mBitmap.getData(), error_state))
+				mMaskTextures[request.mPath] = { std::move(texture), frame, frame };
+			else
+				nap::Logger::warn("%s: unable to load mask %s: %s", getEntityInstance()->mID.c_str(), request.mPath.c_str(),
+					request.mSucceeded ? error_state.toString().c_str() : request.mError.c_str());
+			it = mMaskRequests.erase(it);
+		}
+
+		// Swap the binding between frames, once the upload of the selected mask has been submitted
+		auto selected = mMaskTextures.find(mMaskPath);
+		if (selected != mMaskTextures.end() && selected->second.mFrame < frame && selected->second.mTexture.get() != mBoundMask)
+		{
+			mBoundMask = selected->second.mTexture.get();
+			mStockCanvasPasses[CanvasMaterialType::MASK].mSamplers["maskSampler"]->setTexture(*mBoundMask);
+		}
+		evictMasks();
+	}
+
+
+	void RenderCanvasComponentInstance::evictMasks()
+	{
+		// The least recently selected masks go first, the bound and the selected mask stay resident.
+		// The render service destroys an evicted texture once the frames that sampled it completed.
+		int max_resident = std::max(getComponent<RenderCanvasComponent>()->mMaxResidentMasks, 0);
+		while (mMaskTextures.size() > max_resident)
+		{
+			auto oldest = mMaskTextures.end();
+			for (auto it = mMaskTextures.begin(); it != mMaskTextures.end(); ++it)
+			{
+				if (it->first == mMaskPath || it->second.mTexture.get() == mBoundMask)
+					continue;
+				if (oldest == mMaskTextures.end() || it->second.mSelected < oldest->second.mSelected)
+					oldest = it;
+			}
+			if (oldest == mMaskTextures.end())
+				return;
+			mMaskTextures.erase(oldest);
+		}
+	}
+
+
+	void RenderCanvasComponentInstance::loadMask(const std::string& path)
+	{
+		if (mBoundMask == nullptr)
+		{
+			nap::Logger::warn("%s: unable to load mask %s, the canvas has no mask pass", getEntityInstance()->mID.c_str(), path.c_str());
+			return;
+		}
+		mMaskPath = path;
+		mMaskIndex = getMaskIndex(getComponent<RenderCanvasComponent>()->mMaskFiles, path);
+
+		// The mask of the resource is always resident
+		if (path == mMask->mImagePath)
+		{
+			mBoundMask = mMask.get();
+			mStockCanvasPasses[CanvasMaterialType::MASK].mSamplers["maskSampler"]->setTexture(*mBoundMask);
+			return;
+		}
+
+		// Masks that are still decoding are kept, so masks that change faster than they decode are all loaded eventually
+		auto resident = mMaskTextures.find(path);
+		if (resident != mMaskTextures.end())
+		{
+			resident->second.mSelected = mFoglioService->getFrameTime().mFrame;
+			return;
+		}
+		auto pending = std::find_if(mMaskRequests.begin(), mMaskRequests.end(), [&path](const auto& request) { return request->mPath == path; });
+		if (pending == mMaskRequests.end())
+			mMaskRequests.emplace_back(mFoglioService->getMaskLoader().load(path));
+	}
+
+
+	void RenderCanvasComponentInstance::selectMask(int index)
+	{
+		const auto& mask_files = getComponent<RenderCanvasComponent>()->mMaskFiles;
+		if (index < 0 || index >= mask_files.size())
+		{
+			nap::Logger::warn("%s: mask index %d out of range", getEntityInstance()->mID.c_str(), index);
+			return;
+		}
+		loadMask(mask_files[index]);
+	}
+
+
+	int RenderCanvasComponentInstance::getMaskCount() const
+	{
+		return static_cast<int>(getComponent<RenderCanvasComponent>()->mMaskFiles.size());
+	}
+
+
+	void RenderCanvasComponentInstance::getGpuMemory(std::vector<GpuMemoryEntry>& outEntries)
+	{
+		outEntries.push_back({ "output", EGpuMemoryKind::Texture, mFinalTexture.get(), getTextureMemory(*mFinalTexture) });
+		for (int i = 0; i < mIntermediateTextures.size(); i++)
+			outEntries.push_back({ utility::stringFormat("intermediate %d", i), EGpuMemoryKind::Texture, mIntermediateTextures[i].get(), getTextureMemory(*mIntermediateTextures[i]) });
+
+		// Canvas targets only reference their color texture, they don't allocate attachments of their own
+		outEntries.push_back({ "output target", EGpuMemoryKind::RenderTarget, nullptr, 0 });
+		for (int i = 0; i < mIntermediateTargets.size(); i++)
+			outEntries.push_back({ utility::stringFormat("intermediate target %d", i), EGpuMemoryKind::RenderTarget, nullptr, 0 });
+
+		if (mVideoPlayer != nullptr && mVideoPlayer->getCount() > 0)
+		{
+			outEntries.push_back({ mVideoPlayer->mID + " Y", EGpuMemoryKind::Video, &mVideoPlayer->getYTexture(), getTextureMemory(mVideoPlayer->getYTexture()) });
+			outEntries.push_back({ mVideoPlayer->mID + " U", EGpuMemoryKind::Video, &mVideoPlayer->getUTexture(), getTextureMemory(mVideoPlayer->getUTexture()) });
+			outEntries.push_back({ mVideoPlayer->mID + " V", EGpuMemoryKind::Video, &mVideoPlayer->getVTexture(), getTextureMemory(mVideoPlayer->getVTexture()) });
+		}
+		if (mImageSequence != nullptr)
+		{
+			for (const auto& texture : mImageSequence->getTextures())
+				outEntries.push_back({ texture->mID, EGpuMemoryKind::Video, texture.get(), getTextureMemory(*texture) });
+		}
+		if (mMask != nullptr)
+			outEntries.push_back({ mMask->mID, EGpuMemoryKind::Mask, mMask.get(), getTextureMemory(*mMask, mMask->mGenerateLods) });
+		for (const auto& mask : mMaskTextures)
+			outEntries.push_back({ mask.first, EGpuMemoryKind::Mask, mask.second.mTexture.get(), getTextureMemory(*mask.second.mTexture) });
+	}
+
+	void RenderCanvasComponentInstance::publish()
+	{
+		if (mPublisher != nullptr)
+			mPublisher->publish(*mFinalTexture);
+	}
+
+	void RenderCanvasComponentInstance::setCornerOffsets(const std::vector<glm::vec2>& offsets) {
 		mCornerOffsets[0] = offsets[0];
 		mCornerOffsets[1] = offsets[1];
 		mCornerOffsets[2] = offsets[2];
@@ -666,10 +1200,14 @@ namespace nap
 	}
 
 	void RenderCanvasComponentInstance::setWarpCornerUniforms() {
-		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::topLeft)->setValue(glm::vec3(mCornerOffsets[0].x, mCornerOffsets[0].y * (-1), 0));
-		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::topRight)->setValue(glm::vec3(mCornerOffsets[1].x * (-1), mCornerOffsets[1].y * (-1), 0));
-		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::bottomLeft)->setValue(glm::vec3(mCornerOffsets[2].x, mCornerOffsets[2].y, 0));
-		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::bottomRight)->setValue(glm::vec3(mCornerOffsets[3].x * (-1), mCornerOffsets[3].y, 0));
+		setWarpCornerUniforms(mCornerOffsets.data());
+	}
+
+	void RenderCanvasComponentInstance::setWarpCornerUniforms(const glm::vec2* offsets) {
+		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::topLeft)->setValue(glm::vec3(offsets[0].x, offsets[0].y * (-1), 0));
+		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::topRight)->setValue(glm::vec3(offsets[1].x * (-1), offsets[1].y * (-1), 0));
+		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::bottomLeft)->setValue(glm::vec3(offsets[2].x, offsets[2].y, 0));
+		mStockCanvasPasses[CanvasMaterialType::WARP].mUBO->getOrCreateUniform<UniformVec3Instance>(uniform::canvaswarp::bottomRight)->setValue(glm::vec3(offsets[3].x * (-1), offsets[3].y, 0));
 	}
 
 }
\ No newline at end of file
@@ -15,6 +15,17 @@
 #include <transformcomponent.h>
 #include <material.h>
 
+#include "canvasrendertarget.h"
+#include "canvascommandrecorder.h"
+#include "canvasrendergraph.h"
+#include "canvasupdatescheduler.h"
+#include "shaderparametertable.h"
+#include "sharedframepublisher.h"
+#include "gpumemory.h"
+#include "maskloader.h"
+#include "imagesequence.h"
+#include "canvasframesnapshot.h"
+
 
 namespace nap
 {
@@ -33,59 +44,230 @@ namespace nap
 		std::vector<glm::vec2>			mCornerOffsets = std::vector<glm::vec2>(4);
 		ResourcePtr<Material>			mPostShader = nullptr;
 		ResourcePtr<ImageFromFile>		mMask = nullptr;
-		
+		std::vector<CanvasPassNode>		mPasses;						///< Property: 'Passes' render graph of the canvas, VideoPlayer -> PostShader -> Mask when empty
+		std::string						mOutputPass;					///< Property: 'OutputPass' pass that renders into the canvas output, the last pass when empty
+		ResourcePtr<SharedFramePublisher>	mPublisher = nullptr;		///< Property: 'Publisher' optional shared memory publisher of the canvas output
+		ECanvasTextureFormat			mFormat = ECanvasTextureFormat::Auto;	///< Property: 'Format' format of the canvas output, Auto derives it from the pass chain
+		std::vector<std::string>		mMaskFiles;						///< Property: 'MaskFiles' mask images that can be selected at runtime, loaded in the background
+		int								mMaxResidentMasks = 4;			///< Property: 'MaxResidentMasks' masks loaded at runtime that stay on the GPU, the least recently selected are released
+		ResourcePtr<ImageSequence>		mImageSequence = nullptr;		///< Property: 'ImageSequence' raw frames played from a mapped file, instead of the VideoPlayer
+		ECanvasUpdateRate				mUpdateRate = ECanvasUpdateRate::Full;	///< Property: 'UpdateRate' how often the headless passes render, the output holds the last frame in between
+		float							mUpdateHz = 30.0f;				///< Property: 'UpdateHz' updates per second when the update rate is Hz
+		int								mUpdateFrames = 2;				///< Property: 'UpdateFrames' frames between updates when the update rate is Frames
 	};
 
 	class NAPAPI RenderCanvasComponentInstance : public RenderableComponentInstance
 	{
 		RTTI_ENABLE(RenderableComponentInstance)
+		friend class CanvasRegistry;
 	public:
 		RenderCanvasComponentInstance(EntityInstance& entity, Component& resource);
+		virtual ~RenderCanvasComponentInstance() override;
 
 		virtual bool init(utility::ErrorState& errorState) override;
 
+		/**
+		 * Uploads masks that finished decoding and binds the selected mask once it is resident.
+		 * @param deltaTime time in seconds since last update
+		 */
+		virtual void update(double deltaTime) override;
+
 		virtual bool isSupported(nap::CameraComponentInstance& camera) const override;
 
 		ResourcePtr<RenderTexture2D> getOutputTexture();
 
 		VideoPlayer* getVideoPlayer();
 
-		std::vector<glm::vec2>	getCornerOffsets() { return mCornerOffsets; }
+		/**
+		 * Samples the frames of another player than getVideoPlayer(), the video ladder plays renditions on players of their own.
+		 * The canvas returns to its video player when that player selects another video.
+		 * @param player the player that decodes the frames of the video
+		 */
+		void setVideoSource(VideoPlayer& player);
+
+		/**
+		 * @return the image sequence the video pass plays, nullptr when the canvas plays a video player or has no video pass
+		 */
+		ImageSequence* getImageSequence()												{ return mImageSequence; }
+
+		const std::vector<glm::vec2>& getCornerOffsets() const { return mCornerOffsets; }
 
 		enum class CanvasMaterialType
 		{
-			VIDEO = 0, MASK = 1, WARP = 2, INTERFACE = 3
+			VIDEO = 0, MASK = 1, WARP = 2, INTERFACE = 3, FRAME = 4, BLOCK = 5
 		};
 		struct CanvasPass {
 			ResourcePtr<Material>						mMaterial = nullptr;
 			std::unique_ptr<MaterialInstanceResource>	mMaterialInstResource = nullptr;
-			//instances shouldnt need to be smart pointers here cause they're already unique_ptrs on creation
-			MaterialInstance* mMaterialInstance;
+			std::unique_ptr<MaterialInstance>			mMaterialInstance = nullptr;		///< Owned by the pass, outlives the renderable mesh and parameters below
 			UniformStructInstance* mMVPStruct = nullptr;
 			UniformMat4Instance* mModelMatrixUniform = nullptr;
 			UniformMat4Instance* mProjectMatrixUniform = nullptr;
 			UniformMat4Instance* mViewMatrixUniform = nullptr;
 			std::map<std::string, Sampler2DInstance*>	mSamplers;
-			UniformStructInstance* mUBO;
+			UniformStructInstance* mUBO = nullptr;
+			std::unique_ptr<ShaderParameterTable>	mParameters = nullptr;		///< Reflected 'UBO' members of custom shader passes
 			RenderableMesh mRenderableMesh;
 		};
-		void setCornerOffsets(std::vector<glm::vec2> offsets);
-
-		void draw(RenderableMesh mesh, const DescriptorSet* descriptor_set);
-
-		void drawHeadlessPass(CanvasPass& pass);
-
+		void setCornerOffsets(const std::vector<glm::vec2>& offsets);
+
+		/**
+		 * Updates the uniforms and descriptor sets of a headless pass and acquires its pipeline.
+		 * @param pass the pass to prepare
+		 * @param target target the pass renders into
+		 * @return everything required to record the draw call
+		 */
+		CanvasCommandRecorder::Packet prepareHeadlessPass(CanvasPass& pass, IRenderTarget& target);
+
+		/**
+		 * Prepares all headless passes of this canvas, in the order they need to be executed.
+		 * Not thread safe, the returned packets can be recorded on any thread.
+		 * @param outPackets the prepared passes are appended to this list
+		 */
+		void prepareHeadlessPasses(std::vector<CanvasCommandRecorder::Packet>& outPackets);
+
+		/**
+		 * Prepares and records all headless passes inline into the current command buffer.
+		 */
 		void drawAllHeadlessPasses();
 
+		/**
+		 * Sets the edge blend of the output the canvas is drawn into next, applied by the warp pass.
+		 * @param viewport viewport of the output in pixels
+		 * @param edges left, right, bottom and top blend width relative to the viewport, 0 disables an edge
+		 * @param lut the blend ramp
+		 */
+		void setEdgeBlend(const glm::vec4& viewport, const glm::vec4& edges, Texture2D& lut);
+
+		/**
+		 * Draws the canvas with the layout and warp of a frame snapshot instead of its live state.
+		 * The live warp is restored after the draw, the controls view keeps showing the latest edits.
+		 * @param renderTarget target being rendered to
+		 * @param commandBuffer active command buffer
+		 * @param viewMatrix view matrix of the camera
+		 * @param projectionMatrix projection matrix of the output region
+		 * @param draw the canvas draw of the snapshot
+		 */
+		void drawSnapshot(IRenderTarget& renderTarget, VkCommandBuffer commandBuffer, const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, const CanvasFrameSnapshot::Draw& draw);
+
+		/**
+		 * Changes the mask without stalling the frame: the image is decoded on the mask loader threads
+		 * and uploaded through a staging buffer. The current mask stays bound until the new one is resident.
+		 * Up to 'MaxResidentMasks' loaded masks are kept, selecting them again is instant. Requires a mask pass.
+		 * @param path path to the mask image
+		 */
+		void loadMask(const std::string& path);
+
+		/**
+		 * Loads one of the 'MaskFiles' of the canvas, see loadMask().
+		 * @param index index into the mask files
+		 */
+		void selectMask(int index);
+
+		/**
+		 * @return number of mask files that can be selected
+		 */
+		int getMaskCount() const;
+
+		/**
+		 * @return index of the selected mask file, -1 when the selected mask is not one of the mask files
+		 */
+		int getMaskIndex() const														{ return mMaskIndex; }
+
+		/**
+		 * @return number of masks that are being decoded
+		 */
+		int getLoadingMaskCount() const													{ return static_cast<int>(mMaskRequests.size()); }
+
+		/**
+		 * @return number of masks that were loaded at runtime and are resident on the GPU
+		 */
+		int getResidentMaskCount() const												{ return static_cast<int>(mMaskTextures.size()); }
+
+		/**
+		 * Lists the GPU memory used by this canvas: its textures and render targets,
+		 * the planes of its video player or image sequence and its mask. Video sources and masks can be shared by canvases.
+		 * @param outEntries the entries are appended to this list
+		 */
+		void getGpuMemory(std::vector<GpuMemoryEntry>& outEntries);
+
+		/**
+		 * Publishes the canvas output to shared memory, if a publisher is assigned.
+		 * Call after the headless passes are recorded.
+		 */
+		void publish();
+
 		void drawInterface(rtti::ObjectPtr<RenderTarget> interfaceTarget);
 
 		void setFinalSampler(bool isInterface);
 
 		void computeModelMatrix(const nap::IRenderTarget& target, glm::mat4& outMatrix, ResourcePtr<RenderTexture2D> canvas_output_texture, TransformComponentInstance* transform_comp);
 
-		void computeModelMatrixFullscreen(glm::mat4& outMatrix);
-
-		std::unique_ptr<CanvasPass>		mCustomPostPass = nullptr;
+		void computeModelMatrixFullscreen(const glm::ivec2& targetSize, glm::mat4& outMatrix);
+
+		/**
+		 * Computes the model matrix and warped bounds of the canvas in the virtual canvas space, once per frame.
+		 * The layout is stored in the canvas registry, outputs draw the canvas with it.
+		 * @param virtualSize size of the virtual canvas space in pixels
+		 * @param outMatrix model matrix in the virtual canvas space
+		 * @param outBounds bounds of the warped canvas in virtual pixels: min x, min y, max x, max y
+		 * @param outOccluderBounds conservative rectangle that is entirely covered by the warped canvas, in virtual pixels.
+		 * Empty (min > max) when the warped quad is flipped or folded.
+		 */
+		void updateLayout(const glm::ivec2& virtualSize, glm::mat4& outMatrix, glm::vec4& outBounds, glm::vec4& outOccluderBounds);
+
+		/**
+		 * @return slot of the canvas in the canvas registry, -1 when it isn't registered
+		 */
+		int getRegistryIndex() const													{ return mRegistryIndex; }
+
+		/**
+		 * @return if the canvas output is opaque, it then hides every canvas drawn below its occluder bounds
+		 */
+		bool isOpaque() const															{ return mOpaque; }
+
+		/**
+		 * @return if the canvas output is published to shared memory, it is then always rendered
+		 */
+		bool hasPublisher() const														{ return mPublisher != nullptr && mPublisher->isEnabled(); }
+
+		/**
+		 * @return number of headless passes recorded per frame
+		 */
+		int getHeadlessPassCount() const												{ return static_cast<int>(mPlan.size()); }
+
+		/**
+		 * @return how often the headless passes render
+		 */
+		ECanvasUpdateRate getUpdateRate() const											{ return mUpdateRate; }
+
+		/**
+		 * @return updates per second when the update rate is Hz
+		 */
+		float getUpdateHz() const														{ return mUpdateHz; }
+
+		/**
+		 * @return frames between updates when the update rate is Frames
+		 */
+		int getUpdateFrames() const														{ return mUpdateFrames; }
+
+		/**
+		 * Changes how often the headless passes render, the canvas group reschedules on the next frame.
+		 * @param rate the update rate
+		 * @param hz updates per second when the rate is Hz, at least 0.1
+		 * @param frames frames between updates when the rate is Frames, at least 1
+		 */
+		void setUpdateRate(ECanvasUpdateRate rate, float hz, int frames);
+
+		/**
+		 * @return if the output was never rendered since the passes were built, the canvas then renders regardless of its schedule
+		 */
+		bool isStale() const															{ return mStale; }
+
+		/**
+		 * @return all custom shader passes of the render graph, in execution order
+		 */
+		const std::vector<std::unique_ptr<CanvasPass>>& getShaderPasses() const		{ return mShaderPasses; }
 
 		
 		std::unordered_map<CanvasMaterialType, CanvasPass> mStockCanvasPasses;
@@ -95,7 +277,7 @@ namespace nap
 		UniformVec3Instance* ensureUniformVec3(const std::string& uniformName, UniformStructInstance* structInstance, utility::ErrorState& error);
 		UniformFloatInstance* ensureUniformFloat(const std::string& uniformName, UniformStructInstance* structInstance, utility::ErrorState& error);
 		Sampler2DInstance* ensureSampler(const std::string& samplerName, MaterialInstance* materialInstance, utility::ErrorState& error);
-		bool constructTextureAndRenderTarget(ResourcePtr<RenderTarget>& renderTarget, ResourcePtr<RenderTexture2D>& texture, bool transparent, utility::ErrorState& error);
+		bool constructTextureAndRenderTarget(std::unique_ptr<CanvasRenderTarget>& renderTarget, ResourcePtr<RenderTexture2D>& texture, ECanvasTextureFormat format, bool transparent, utility::ErrorState& error);
 		
 		bool mIsControlViewDraw = false;
 
@@ -104,16 +286,43 @@ namespace nap
 		virtual void onDraw(IRenderTarget& renderTarget, VkCommandBuffer commandBuffer, const glm::mat4& viewmatrix, const glm::mat4& projectionMatrix) override;
 
 	private:
-		using DoubleBufferedRenderTarget = std::array<rtti::ObjectPtr<RenderTarget>, 2>;
+		// Properties that require the textures, targets and passes to be rebuilt when they change
+		struct Structure
+		{
+			VideoPlayer*				mVideoPlayer = nullptr;
+			ImageSequence*				mImageSequence = nullptr;
+			Material*					mPostShader = nullptr;
+			ImageFromFile*				mMask = nullptr;
+			SharedFramePublisher*		mPublisher = nullptr;
+			float						mAspectRatio = 0.0f;
+			int							mResolution = 0;
+			ECanvasTextureFormat		mFormat = ECanvasTextureFormat::Auto;
+			std::string					mOutputPass;
+			std::vector<CanvasPassNode>	mPasses;
+			bool operator==(const Structure& other) const;
+		};
+
+		// A single step of the compiled render graph
+		struct PlanStep
+		{
+			CanvasPass*					mPass;
+			CanvasRenderTarget*			mTarget;
+			bool						mClear;
+		};
 		//TODO: make this a ResourcePtr<Canvas>?
 		
-		ResourcePtr<RenderWindow>		mMainWindowPtr;
-		DoubleBufferedRenderTarget		mDoubleBufferTarget;
-		ResourcePtr<RenderTarget>		mCurrentInternalRT;
+		CanvasRenderGraph				mRenderGraph;
+		std::vector<PlanStep>			mPlan;
+		std::vector<std::unique_ptr<CanvasPass>>			mShaderPasses;
+		std::vector<std::unique_ptr<CanvasRenderTarget>>	mIntermediateTargets;
+		std::vector<ResourcePtr<RenderTexture2D>>			mIntermediateTextures;
 		ResourcePtr<ImageFromFile>		mMask;
 		VideoPlayer*					mVideoPlayer = nullptr;
-		ResourcePtr<RenderTarget>		mFinalRenderTarget;
+		ImageSequence*					mImageSequence = nullptr;
+		std::unique_ptr<CanvasRenderTarget>	mFinalRenderTarget;
 		ResourcePtr<RenderTexture2D>	mFinalTexture;
+		ResourcePtr<RenderTexture2D>	mInterfaceTexture;
+		std::vector<CanvasCommandRecorder::Packet> mInlinePackets;
 		std::vector<glm::vec2>			mCornerOffsets;
 
 		float*							mAspectRatio = nullptr;
@@ -125,14 +334,55 @@ namespace nap
 		TransformComponentInstance*	mTransformComponent = nullptr;
 
 		RenderService*				mRenderService = nullptr;
+		FoglioService*				mFoglioService = nullptr;
+		SharedFramePublisher*		mPublisher = nullptr;
 
 		Vec3VertexAttribute*		mOffsetVec3Uniform = nullptr;
 
+		Sampler2DInstance*			mBlendLutSampler = nullptr;
+		UniformVec4Instance*		mBlendViewportUniform = nullptr;
+		UniformVec4Instance*		mBlendEdgesUniform = nullptr;
+
 		glm::mat4x4					mModelMatrix;
+		int							mRegistryIndex = -1;						///< Slot in the canvas registry, which holds the layout
+		bool						mOpaque = false;							///< If the output pass writes opaque pixels
+		bool						mStale = false;								///< If the output wasn't rendered since the passes were built
+		ECanvasUpdateRate			mUpdateRate = ECanvasUpdateRate::Full;
+		float						mUpdateHz = 30.0f;
+		int							mUpdateFrames = 2;
+		glm::ivec2					mVirtualSize = { 1920, 1080 };				///< Size of the virtual canvas space
+
+		Structure						mStructure;
+		// A mask loaded at runtime, the frame its upload was requested on and the frame it was last selected on
+		struct MaskTexture
+		{
+			std::unique_ptr<Texture2D>	mTexture;
+			int							mFrame = 0;
+			int							mSelected = 0;
+		};
+
+		std::vector<std::shared_ptr<MaskLoader::Request>>	mMaskRequests;			///< Masks being decoded, one per path
+		std::unordered_map<std::string, MaskTexture>		mMaskTextures;			///< Masks loaded at runtime by path
+		std::string						mMaskPath;									///< Mask that should be bound
+		Texture2D*						mBoundMask = nullptr;						///< Mask that is bound to the mask pass
+		const CanvasFrameSnapshot::Draw*	mSnapshotDraw = nullptr;				///< Snapshot draw the canvas is drawn with, null draws the layout of the registry
+		int								mMaskIndex = -1;
+
+		RenderCanvasComponentInstance*	mDonor = nullptr;			///< Previous instance this instance took the structure from, until the reload completes
+		RenderCanvasComponentInstance*	mAdopter = nullptr;			///< Instance that took over the structure of this instance, until the reload completes
+
+		void swapStructure(RenderCanvasComponentInstance& other);
+		static void createDefaultPasses(const RenderCanvasComponent& resource, std::vector<CanvasPassNode>& outNodes);
+		bool buildRenderGraph(const std::vector<CanvasPassNode>& nodes, const std::string& output, utility::ErrorState& errorState);
+		std::unique_ptr<CanvasPass> constructShaderPass(ResourcePtr<Material> material, utility::ErrorState& errorState);
+		CanvasPass* constructSequencePass(utility::ErrorState& errorState);
+		CanvasRenderTarget& getGraphTarget(int index);
 
 		bool setupPlaneMesh(ResourcePtr<PlaneMesh> planeMesh, int resX, int resY, nap::utility::ErrorState errorState);
 
 		void setWarpCornerUniforms();
+		void setWarpCornerUniforms(const glm::vec2* offsets);
+		void evictMasks();
 
 		void videoChanged(VideoPlayer& player);
 		nap::Slot<VideoPlayer&> mVideoChangedSlot = { this, &RenderCanvasComponentInstance::videoChanged };
@@ -1,5 +1,6 @@
 #include "sequencecanvascomponent.h"
 #include "rendercanvascomponent.h"
+#include "tracer.h"
 
 #include <entity.h>
 #include <nap/core.h>
@@ -8,11 +9,16 @@
 #include <nap/resourceptr.h>
 #include <rtti/objectptr.h>
 #include <nap/resourceptr.h>
+#include <sequencetrackevent.h>
+#include <sequencetracksegmentevent.h>
+#include <cmath>
 
 
 // nap::rendercanvascomponent run time class definition
 RTTI_BEGIN_CLASS(nap::SequenceCanvasComponent)
 	RTTI_PROPERTY("Sequence", &nap::SequenceCanvasComponent::mSequencePlayer, nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("CurveBindings", &nap::SequenceCanvasComponent::mCurveBindings, nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("CueLookahead", &nap::SequenceCanvasComponent::mCueLookahead, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::SequenceCanvasComponentInstance)
@@ -21,12 +27,26 @@ RTTI_END_CLASS
 
 namespace nap
 {
+	// Cue latency buckets in seconds, a cue is applied at most a frame late
+	static const std::vector<double> cueLatencyBuckets =
+	{
+		0.001, 0.002, 0.004, 0.006, 0.008, 0.010, 0.0125, 0.015, 0.0175, 0.020, 0.025, 0.0333, 0.050, 0.100, 0.250
+	};
+
 
 	SequenceCanvasComponentInstance::SequenceCanvasComponentInstance(EntityInstance& entity, Component& resource) :
 		ComponentInstance(entity, resource)
 	{ }
 
 
+	SequenceCanvasComponentInstance::~SequenceCanvasComponentInstance()
+	{
+		// The tick is triggered on the player thread with the player lock held, signals aren't thread safe
+		if (mSequencePlayer != nullptr)
+			mSequencePlayer->performEditAction([this]() { mSequencePlayer->postTick.disconnect(mPlayerTickSlot); });
+	}
+
+
 
 
 
@@ -40,20 +60,115 @@ namespace nap
 		if (!errorState.check(canvasEventOutput != nullptr, "unable to find CanvasSequenceEventReceiver with index: %s", 0))
 			return false;
 		mSequencePlayer = resource->mSequencePlayer;
-		canvasEventOutput->mSignal.connect(mSelectVideoSlot);
+		mRenderCanvasComponent = &getEntityInstance()->getComponent<RenderCanvasComponentInstance>();
+		mCueOutputID = canvasEventOutput->mID;
+		mCueLookahead = resource->mCueLookahead;
+		Metrics& metrics = getEntityInstance()->getCore()->getService<FoglioService>()->getMetrics();
+		mAppliedCueCounter = &metrics.getCounter("foglio_cues_applied_total", "Sequence cues applied");
+		mDroppedCueCounter = &metrics.getCounter("foglio_cues_dropped_total", "Sequence cues dropped because the cue queue was full");
+		mCueLatency = &metrics.getHistogram("foglio_cue_latency_seconds", "Sequence time between a cue and the predicted display time of the frame it was applied on", cueLatencyBuckets);
+
+		// Cues are read from the event track on the player thread instead of dispatched through the output.
+		// The player keeps ticking across reloads, connect while holding its lock
+		mSequencePlayer->performEditAction([this]() { mSequencePlayer->postTick.connect(mPlayerTickSlot); });
 		mSequencePlayer->setIsLooping(true);
 		mSequencePlayer->setIsPlaying(true);
 		return true;
 
 	}
 
-	void SequenceCanvasComponentInstance::selectVideo(const SequenceEventBase& sequenceEvent) {
-		VideoPlayer* player = getEntityInstance()->getComponent<RenderCanvasComponentInstance>().getVideoPlayer();
+	void SequenceCanvasComponentInstance::onPlayerTick(SequencePlayer& player)
+	{
+		FOGLIO_TRACE_ZONE("SequenceCanvas::onPlayerTick");
+		const double time = player.getPlayerTime();
+		const double duration = player.getDuration();
+
+		// Track the absolute playhead, a jump back of more than half the sequence is a loop, anything else a seek
+		if (time < mLastTickTime && player.getIsLooping() && mLastTickTime - time > duration * 0.5)
+			mLoopOffset += duration;
+		double playhead = mLoopOffset + time;
+		if (playhead < mPlayhead.load() || playhead > mScanEnd + 1.0)
+		{
+			// Cues queued before the seek are no longer in playback order, they would block or burst, start a new generation
+			mScanEnd = playhead;
+			mSeekGeneration.fetch_add(1, std::memory_order_release);
+		}
+		const uint32 generation = mSeekGeneration.load(std::memory_order_relaxed);
+		mLastTickTime = time;
+		mPlayhead.store(playhead);
+
+		const SequenceTrack* cue_track = nullptr;
+		for (const auto& track : player.getSequenceConst().mTracks)
+		{
+			if (track->mAssignedOutputID == mCueOutputID && track->get_type().is_derived_from(RTTI_OF(SequenceTrackEvent)))
+				cue_track = track.get();
+		}
+		const double scan_end = playhead + mCueLookahead;
+		if (cue_track == nullptr || duration <= 0.0 || scan_end <= mScanEnd)
+			return;
+
+		// Queue every cue in [mScanEnd, scan_end), the window may span a loop
+		int first_loop = static_cast<int>(std::floor(mScanEnd / duration));
+		int last_loop = player.getIsLooping() ? static_cast<int>(std::floor(scan_end / duration)) : first_loop;
+		for (int loop = first_loop; loop <= last_loop; loop++)
+		{
+			for (const auto& segment : cue_track->mSegments)
+			{
+				if (!segment->get_type().is_derived_from(RTTI_OF(SequenceTrackSegmentEventInt)))
+					continue;
+				Cue cue;
+				cue.mTime = loop * duration + segment->mStartTime;
+				cue.mValue = static_cast<const SequenceTrackSegmentEventInt&>(*segment).mValue;
+				cue.mGeneration = generation;
+				if (cue.mTime < mScanEnd || cue.mTime >= scan_end)
+					continue;
+				if (!mCueQueue.push(cue))
+				{
+					mDroppedCues++;
+					mDroppedCueCounter->add();
+				}
+			}
+		}
+		mScanEnd = scan_end;
+	}
+
+	void SequenceCanvasComponentInstance::applyCues(double displayLatency)
+	{
+		FOGLIO_TRACE_ZONE("SequenceCanvas::applyCues");
+		const uint32 generation = mSeekGeneration.load(std::memory_order_acquire);
+		const double display_time = mPlayhead.load() + displayLatency;
+		Cue* cue = mCueQueue.front();
+		while (cue != nullptr && static_cast<int32>(cue->mGeneration - generation) < 0)
+		{
+			mCueStats.mStale++;
+			mCueQueue.pop();
+			cue = mCueQueue.front();
+		}
+		while (cue != nullptr && cue->mGeneration == generation && cue->mTime <= display_time)
+		{
+			selectVideo(cue->mValue);
+			mAppliedCueCounter->add();
+			double latency = display_time - cue->mTime;
+			mCueLatency->observe(latency);
+			mCueStats.mAverageLatency += (latency - mCueStats.mAverageLatency) / static_cast<double>(++mCueStats.mApplied);
+			mCueStats.mMaxLatency = std::max(mCueStats.mMaxLatency, latency);
+			mCueQueue.pop();
+			cue = mCueQueue.front();
+		}
+		mCueStats.mDropped = mDroppedCues.load();
+	}
+
+	void SequenceCanvasComponentInstance::selectVideo(int index) {
+		FOGLIO_TRACE_ZONE("SequenceCanvas::selectVideo");
+		VideoPlayer* player = mRenderCanvasComponent->getVideoPlayer();
+		if (player == nullptr)
+			return;
 		utility::ErrorState error;
-		error.check(player != nullptr, "unable to find player in rendercanvascomponent:");
-		const SequenceEventInt& eventInt = static_cast<const SequenceEventInt&>(sequenceEvent);
-		nap::Logger::info("Select Video Event from Sequence. SelectIndex = %i", (eventInt.getValue()) % player->getCount());
-		player->selectVideo((eventInt.getValue()) % player->getCount(), error);
+		if (!player->selectVideo(index % player->getCount(), error))
+		{
+			nap::Logger::warn("%s: unable to select video %d: %s", mID.c_str(), index, error.toString().c_str());
+			return;
+		}
 		player->play();
 	}
 
@@ -1,5 +1,6 @@
 #pragma once
 #include "rendercanvascomponent.h"
+#include "sequencecurvebindings.h"
 
 #include <component.h>
 #include <rendercomponent.h>
@@ -19,6 +20,9 @@
 #include <sequenceplayer.h>
 #include <sequenceevent.h>
 #include <sequenceplayereventoutput.h>
+#include <atomic>
+
+#include "spscqueue.h"
 
 namespace nap
 {
@@ -32,25 +36,88 @@ namespace nap
 
 	public:
 		ResourcePtr<SequencePlayer>		mSequencePlayer = nullptr;
+		std::vector<SequenceCurveBinding>	mCurveBindings;				///< Property: 'CurveBindings' sequence curves that drive properties of the canvas
+		float							mCueLookahead = 0.1f;			///< Property: 'CueLookahead' seconds of sequence time that cue events are queued ahead of the playhead
 	};
 
+	/**
+	 * Queues the video cues of a sequence on the sequence player thread, with their sequence time,
+	 * and applies them on the frame that is displayed at that time.
+	 * Cues are read from the event track assigned to the first output of the player.
+	 */
 	class NAPAPI SequenceCanvasComponentInstance : public ComponentInstance
 	{
 		RTTI_ENABLE(ComponentInstance)
 	public:
 		SequenceCanvasComponentInstance(EntityInstance& entity, Component& resource);
 
+		/**
+		 * Disconnects from the player tick while holding the player lock, the player outlives the component on reload.
+		 */
+		virtual ~SequenceCanvasComponentInstance() override;
+
 		virtual bool init(utility::ErrorState& errorState) override;
 
 		ResourcePtr<SequencePlayer> getSequencePlayer() { return mSequencePlayer; };
 		ResourcePtr<SequencePlayer> mSequencePlayer = nullptr;
 
+		/**
+		 * Applies all queued cues that are due on the frame that is being prepared.
+		 * Called once per frame, from the main thread, before the canvases are drawn.
+		 * @param displayLatency predicted seconds until the frame that is being prepared is displayed
+		 */
+		void applyCues(double displayLatency);
+
+		/**
+		 * Latency of the applied cues: sequence time between the cue and the predicted display time of the frame it was applied on.
+		 */
+		struct CueStats
+		{
+			int		mApplied = 0;				///< Number of applied cues
+			int		mDropped = 0;				///< Number of cues dropped because the queue was full
+			int		mStale = 0;					///< Number of cues discarded because the playhead was seeked past or before them
+			double	mAverageLatency = 0.0;		///< Average latency in seconds
+			double	mMaxLatency = 0.0;			///< Highest latency in seconds
+		};
+
+		/**
+		 * @return histogram of the latency of every applied cue, shared by all sequence canvases, exported as foglio_cue_latency_seconds
+		 */
+		const MetricHistogram& getCueLatency() const { return *mCueLatency; }
+
+		/**
+		 * @return latency statistics of all applied cues
+		 */
+		const CueStats& getCueStats() const { return mCueStats; }
+
 	private:
+		struct Cue
+		{
+			double	mTime = 0.0;				///< Absolute sequence time, loops included
+			int		mValue = 0;					///< Video index
+			uint32	mGeneration = 0;			///< Seek generation the cue was queued in
+		};
 
 		RenderCanvasComponentInstance* mRenderCanvasComponent;
+		std::string						mCueOutputID;
+		float							mCueLookahead = 0.1f;
+		SPSCQueue<Cue>					mCueQueue = SPSCQueue<Cue>(256);
+		std::atomic<double>				mPlayhead = { 0.0 };		///< Absolute sequence time of the last player tick
+		std::atomic<int>				mDroppedCues = { 0 };
+		std::atomic<uint32>				mSeekGeneration = { 0 };	///< Incremented on every seek, cues of older generations are discarded
+		CueStats						mCueStats;
+		MetricCounter*					mAppliedCueCounter = nullptr;
+		MetricCounter*					mDroppedCueCounter = nullptr;
+		MetricHistogram*				mCueLatency = nullptr;		///< Seconds between a cue and the predicted display time of the frame it was applied on
+
+		// Player thread only
+		double							mLastTickTime = 0.0;
+		double							mLoopOffset = 0.0;
+		double							mScanEnd = 0.0;
 		
 		void drawSequenceControls(utility::ErrorState& errorState);
-		void selectVideo(const SequenceEventBase& sequenceEvent);
-		nap::Slot<const SequenceEventBase&>		mSelectVideoSlot = { this, &SequenceCanvasComponentInstance::selectVideo };
+		void selectVideo(int index);
+		void onPlayerTick(SequencePlayer& player);
+		nap::Slot<SequencePlayer&>		mPlayerTickSlot = { this, &SequenceCanvasComponentInstance::onPlayerTick };
 	};
 }
\ No newline at end of file
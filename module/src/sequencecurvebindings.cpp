@@ -0,0 +1,397 @@
+// Local Includes
+#include "sequencecurvebindings.h"
+#include "rendercanvascomponent.h"
+#include "shaderparametertable.h"
+
+// External Includes
+#include <sequence.h>
+#include <sequencetrackcurve.h>
+#include <sequencetracksegmentcurve.h>
+#include <transformcomponent.h>
+#include <entity.h>
+#include <algorithm>
+
+RTTI_BEGIN_ENUM(nap::ECanvasCurveTarget)
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::TranslateX,	"TranslateX"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::TranslateY,	"TranslateY"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::TranslateZ,	"TranslateZ"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::ScaleX,		"ScaleX"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::ScaleY,		"ScaleY"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::ScaleZ,		"ScaleZ"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::CornerX,		"CornerX"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::CornerY,		"CornerY"),
+	RTTI_ENUM_VALUE(nap::ECanvasCurveTarget::Parameter,		"Parameter")
+RTTI_END_ENUM
+
+RTTI_BEGIN_STRUCT(nap::SequenceCurveBinding)
+	RTTI_PROPERTY("Track",		&nap::SequenceCurveBinding::mTrack,		nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Curve",		&nap::SequenceCurveBinding::mCurve,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Target",		&nap::SequenceCurveBinding::mTarget,	nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Index",		&nap::SequenceCurveBinding::mIndex,		nap::rtti::EPropertyMetaData::Default)
+	RTTI_PROPERTY("Parameter",	&nap::SequenceCurveBinding::mParameter,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_STRUCT
+
+namespace nap
+{
+	static float getComponent(float value, int component)							{ return component == 0 ? value : 0.0f; }
+
+	template<glm::length_t L>
+	static float getComponent(const glm::vec<L, float, glm::defaultp>& value, int component)	{ return component < L ? value[component] : 0.0f; }
+
+
+	/**
+	 * Samples a single curve of every segment of a curve track, scaled to the range of the track.
+	 * @return if the track is a curve track of type T
+	 */
+	template<typename T>
+	static bool sampleTrack(const SequenceTrack& track, int curve, std::vector<std::pair<float, std::vector<float>>>& outSegments, std::vector<float>& outDurations)
+	{
+		if (!track.get_type().is_derived_from(RTTI_OF(SequenceTrackCurve<T>)))
+			return false;
+
+		const auto& curve_track = static_cast<const SequenceTrackCurve<T>&>(track);
+		float minimum = getComponent(curve_track.mMinimum, curve);
+		float range = getComponent(curve_track.mMaximum, curve) - minimum;
+		for (const auto& segment : curve_track.mSegments)
+		{
+			const auto& curve_segment = static_cast<const SequenceTrackSegmentCurve<T>&>(*segment);
+			if (curve >= curve_segment.mCurves.size())
+				continue;
+
+			std::vector<float> samples(SequenceCurveBindings::samplesPerSegment);
+			for (int i = 0; i < samples.size(); i++)
+			{
+				float x = static_cast<float>(i) / static_cast<float>(samples.size() - 1);
+				samples[i] = curve_segment.mCurves[curve]->evaluate(x) * range + minimum;
+			}
+			outSegments.emplace_back(static_cast<float>(segment->mStartTime), std::move(samples));
+			outDurations.emplace_back(static_cast<float>(segment->mDuration));
+		}
+		return true;
+	}
+
+
+	template<typename T>
+	static void hashValue(uint64& hash, const T& value)
+	{
+		// FNV-1a over the bytes of the value
+		const uint8* bytes = reinterpret_cast<const uint8*>(&value);
+		for (size_t i = 0; i < sizeof(T); i++)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+
+	/**
+	 * Hashes everything sampleTrack() reads from a curve track: the range, the segment times and the points of a single curve.
+	 * @return if the track is a curve track of type T
+	 */
+	template<typename T>
+	static bool hashTrack(const SequenceTrack& track, int curve, uint64& hash)
+	{
+		if (!track.get_type().is_derived_from(RTTI_OF(SequenceTrackCurve<T>)))
+			return false;
+
+		const auto& curve_track = static_cast<const SequenceTrackCurve<T>&>(track);
+		hashValue(hash, curve_track.mMinimum);
+		hashValue(hash, curve_track.mMaximum);
+		hashValue(hash, curve_track.mSegments.size());
+		for (const auto& segment : curve_track.mSegments)
+		{
+			hashValue(hash, segment->mStartTime);
+			hashValue(hash, segment->mDuration);
+			const auto& curve_segment = static_cast<const SequenceTrackSegmentCurve<T>&>(*segment);
+			if (curve >= curve_segment.mCurves.size())
+				continue;
+			for (const auto& point : curve_segment.mCurves[curve]->mPoints)
+			{
+				hashValue(hash, point.mPos.mTime);
+				hashValue(hash, point.mPos.mValue);
+				hashValue(hash, point.mInTan.mTime);
+				hashValue(hash, point.mInTan.mValue);
+				hashValue(hash, point.mOutTan.mTime);
+				hashValue(hash, point.mOutTan.mValue);
+				hashValue(hash, point.mInterp);
+			}
+		}
+		return true;
+	}
+
+
+	static const SequenceTrack* findTrack(const SequencePlayer& player, const std::string& outputID)
+	{
+		for (const auto& track : player.getSequenceConst().mTracks)
+		{
+			if (track->mAssignedOutputID == outputID)
+				return track.get();
+		}
+		return nullptr;
+	}
+
+
+	bool SequenceCurveBindings::addCanvas(SequencePlayer& player, const std::vector<SequenceCurveBinding>& bindings, RenderCanvasComponentInstance& canvas, utility::ErrorState& errorState)
+	{
+		if (bindings.empty())
+			return true;
+
+		auto player_it = std::find(mPlayers.begin(), mPlayers.end(), &player);
+		int player_index = static_cast<int>(player_it - mPlayers.begin());
+		if (player_it == mPlayers.end())
+		{
+			mPlayers.emplace_back(&player);
+			mPlayerTimes.emplace_back(0.0f);
+		}
+
+		CanvasState state;
+		state.mCanvas = &canvas;
+		state.mTransform = canvas.getEntityInstance()->findComponent<TransformComponentInstance>();
+		int canvas_index = static_cast<int>(mCanvases.size());
+		mCanvases.emplace_back(std::move(state));
+
+		for (const auto& binding : bindings)
+		{
+			const SequenceTrack* track = findTrack(player, binding.mTrack);
+			if (!errorState.check(track != nullptr, "%s: no track assigned to output: %s", canvas.mID.c_str(), binding.mTrack.c_str()))
+				return false;
+			if (!errorState.check(binding.mCurve >= 0 && binding.mCurve < 4, "%s: invalid curve index %d for track: %s", canvas.mID.c_str(), binding.mCurve, binding.mTrack.c_str()))
+				return false;
+
+			ShaderParameterTable* table = nullptr;
+			int index = binding.mIndex;
+			switch (binding.mTarget)
+			{
+			case ECanvasCurveTarget::TranslateX:
+			case ECanvasCurveTarget::TranslateY:
+			case ECanvasCurveTarget::TranslateZ:
+			case ECanvasCurveTarget::ScaleX:
+			case ECanvasCurveTarget::ScaleY:
+			case ECanvasCurveTarget::ScaleZ:
+				if (!errorState.check(mCanvases[canvas_index].mTransform != nullptr, "%s: unable to bind track: %s, canvas has no transform", canvas.mID.c_str(), binding.mTrack.c_str()))
+					return false;
+				break;
+			case ECanvasCurveTarget::CornerX:
+			case ECanvasCurveTarget::CornerY:
+				if (!errorState.check(index >= 0 && index < 4, "%s: invalid corner index: %d", canvas.mID.c_str(), index))
+					return false;
+				break;
+			case ECanvasCurveTarget::Parameter:
+			{
+				// Resolve the parameter slot once, the component index is folded into the slot index below
+				int parameter = -1;
+				for (const auto& pass : canvas.getShaderPasses())
+				{
+					if (pass->mParameters == nullptr || (parameter = pass->mParameters->find(binding.mParameter)) < 0)
+						continue;
+					table = pass->mParameters.get();
+					break;
+				}
+				if (!errorState.check(table != nullptr, "%s: unable to find post shader parameter: %s", canvas.mID.c_str(), binding.mParameter.c_str()))
+					return false;
+				if (!errorState.check(index >= 0 && index < table->getParameters()[parameter].mComponents, "%s: invalid component %d of parameter: %s", canvas.mID.c_str(), index, binding.mParameter.c_str()))
+					return false;
+				index = parameter * 4 + index;
+				break;
+			}
+			}
+
+			mChannelTrack.emplace_back(binding.mTrack);
+			mChannelCurve.emplace_back(binding.mCurve);
+			mChannelPlayer.emplace_back(player_index);
+			mChannelCanvas.emplace_back(canvas_index);
+			mChannelTarget.emplace_back(binding.mTarget);
+			mChannelIndex.emplace_back(index);
+			mChannelTable.emplace_back(table);
+			mChannelSegmentBegin.emplace_back(0);
+			mChannelSegmentEnd.emplace_back(0);
+			mChannelCursor.emplace_back(0);
+			mChannelValue.emplace_back(0.0f);
+			mChannelFingerprint.emplace_back(0);
+		}
+		bake();
+		return true;
+	}
+
+
+	void SequenceCurveBindings::bake()
+	{
+		mSegmentStart.clear();
+		mSegmentInvDuration.clear();
+		mSamples.clear();
+		for (int channel = 0; channel < mChannelValue.size(); channel++)
+		{
+			bakeChannel(channel);
+			mChannelFingerprint[channel] = getFingerprint(channel);
+		}
+	}
+
+
+	bool SequenceCurveBindings::bakeChanged()
+	{
+		for (int channel = 0; channel < mChannelValue.size(); channel++)
+		{
+			if (getFingerprint(channel) != mChannelFingerprint[channel])
+			{
+				bake();
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	uint64 SequenceCurveBindings::getFingerprint(int channel) const
+	{
+		// Tracks that are removed or replaced hash differently from the ones that were baked
+		uint64 hash = 14695981039346656037ull;
+		const SequenceTrack* track = findTrack(*mPlayers[mChannelPlayer[channel]], mChannelTrack[channel]);
+		hashValue(hash, track);
+		if (track != nullptr)
+		{
+			int curve = mChannelCurve[channel];
+			if (!hashTrack<float>(*track, curve, hash) &&
+				!hashTrack<glm::vec2>(*track, curve, hash) &&
+				!hashTrack<glm::vec3>(*track, curve, hash))
+				hashTrack<glm::vec4>(*track, curve, hash);
+		}
+		return hash;
+	}
+
+
+	void SequenceCurveBindings::bakeChannel(int channel)
+	{
+		std::vector<std::pair<float, std::vector<float>>> segments;
+		std::vector<float> durations;
+		const SequenceTrack* track = findTrack(*mPlayers[mChannelPlayer[channel]], mChannelTrack[channel]);
+		if (track != nullptr)
+		{
+			// Curves the track doesn't have result in an empty channel
+			int curve = mChannelCurve[channel];
+			if (!sampleTrack<float>(*track, curve, segments, durations) &&
+				!sampleTrack<glm::vec2>(*track, curve, segments, durations) &&
+				!sampleTrack<glm::vec3>(*track, curve, segments, durations))
+				sampleTrack<glm::vec4>(*track, curve, segments, durations);
+		}
+
+		// Segments are stored in playback order, the cursor relies on it
+		std::vector<int> order(segments.size());
+		for (int i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&segments](int a, int b) { return segments[a].first < segments[b].first; });
+
+		mChannelSegmentBegin[channel] = static_cast<int>(mSegmentStart.size());
+		for (int i : order)
+		{
+			mSegmentStart.emplace_back(segments[i].first);
+			mSegmentInvDuration.emplace_back(durations[i] > 0.0f ? 1.0f / durations[i] : 0.0f);
+			mSamples.insert(mSamples.end(), segments[i].second.begin(), segments[i].second.end());
+		}
+		mChannelSegmentEnd[channel] = static_cast<int>(mSegmentStart.size());
+		mChannelCursor[channel] = mChannelSegmentBegin[channel];
+	}
+
+
+	void SequenceCurveBindings::evaluate()
+	{
+		for (int i = 0; i < mPlayers.size(); i++)
+			mPlayerTimes[i] = static_cast<float>(mPlayers[i]->getPlayerTime());
+
+		// Evaluate all channels
+		const int channel_count = getChannelCount();
+		for (int channel = 0; channel < channel_count; channel++)
+		{
+			const int begin = mChannelSegmentBegin[channel];
+			const int end = mChannelSegmentEnd[channel];
+			if (begin == end)
+				continue;
+
+			// Move the cursor to the last segment that starts before the current time
+			const float time = mPlayerTimes[mChannelPlayer[channel]];
+			int segment = mChannelCursor[channel];
+			while (segment > begin && time < mSegmentStart[segment])
+				segment--;
+			while (segment + 1 < end && time >= mSegmentStart[segment + 1])
+				segment++;
+			mChannelCursor[channel] = segment;
+
+			// Sample, time outside of the segment holds the nearest sample
+			float x = glm::clamp((time - mSegmentStart[segment]) * mSegmentInvDuration[segment], 0.0f, 1.0f) * (samplesPerSegment - 1);
+			int sample = std::min(static_cast<int>(x), samplesPerSegment - 2);
+			const float* samples = &mSamples[segment * samplesPerSegment + sample];
+			mChannelValue[channel] = glm::mix(samples[0], samples[1], x - static_cast<float>(sample));
+		}
+
+		// Stage results
+		for (int channel = 0; channel < channel_count; channel++)
+		{
+			if (mChannelSegmentBegin[channel] == mChannelSegmentEnd[channel])
+				continue;
+
+			CanvasState& state = mCanvases[mChannelCanvas[channel]];
+			const float value = mChannelValue[channel];
+			const int index = mChannelIndex[channel];
+			switch (mChannelTarget[channel])
+			{
+			case ECanvasCurveTarget::TranslateX:
+			case ECanvasCurveTarget::TranslateY:
+			case ECanvasCurveTarget::TranslateZ:
+			{
+				int component = static_cast<int>(mChannelTarget[channel]) - static_cast<int>(ECanvasCurveTarget::TranslateX);
+				state.mTranslate[component] = value;
+				state.mTranslateMask |= 1 << component;
+				break;
+			}
+			case ECanvasCurveTarget::ScaleX:
+			case ECanvasCurveTarget::ScaleY:
+			case ECanvasCurveTarget::ScaleZ:
+			{
+				int component = static_cast<int>(mChannelTarget[channel]) - static_cast<int>(ECanvasCurveTarget::ScaleX);
+				state.mScale[component] = value;
+				state.mScaleMask |= 1 << component;
+				break;
+			}
+			case ECanvasCurveTarget::CornerX:
+				state.mCorners[index].x = value;
+				state.mCornerMask |= 1 << (index * 2);
+				break;
+			case ECanvasCurveTarget::CornerY:
+				state.mCorners[index].y = value;
+				state.mCornerMask |= 1 << (index * 2 + 1);
+				break;
+			case ECanvasCurveTarget::Parameter:
+				mChannelTable[channel]->setComponent(index / 4, index % 4, value);
+				break;
+			}
+		}
+
+		// Apply staged canvas state, components that aren't bound keep their current value
+		for (auto& state : mCanvases)
+		{
+			if (state.mTranslateMask != 0)
+			{
+				glm::vec3 translate = state.mTransform->getTranslate();
+				for (int i = 0; i < 3; i++)
+					translate[i] = (state.mTranslateMask & (1 << i)) != 0 ? state.mTranslate[i] : translate[i];
+				state.mTransform->setTranslate(translate);
+				state.mTranslateMask = 0;
+			}
+			if (state.mScaleMask != 0)
+			{
+				glm::vec3 scale = state.mTransform->getScale();
+				for (int i = 0; i < 3; i++)
+					scale[i] = (state.mScaleMask & (1 << i)) != 0 ? state.mScale[i] : scale[i];
+				state.mTransform->setScale(scale);
+				state.mScaleMask = 0;
+			}
+			if (state.mCornerMask != 0)
+			{
+				const std::vector<glm::vec2>& current = state.mCanvas->getCornerOffsets();
+				for (int i = 0; i < 8; i++)
+				{
+					if ((state.mCornerMask & (1 << i)) == 0)
+						state.mCorners[i / 2][i % 2] = current[i / 2][i % 2];
+				}
+				state.mCanvas->setCornerOffsets(state.mCorners);
+				state.mCornerMask = 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+// External Includes
+#include <sequenceplayer.h>
+#include <utility/errorstate.h>
+#include <glm/glm.hpp>
+#include <nap/numeric.h>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	// Forward declares
+	class RenderCanvasComponentInstance;
+	class TransformComponentInstance;
+	class ShaderParameterTable;
+
+	/**
+	 * Canvas property a sequence curve is bound to
+	 */
+	enum class ECanvasCurveTarget : int
+	{
+		TranslateX	= 0,
+		TranslateY	= 1,
+		TranslateZ	= 2,
+		ScaleX		= 3,
+		ScaleY		= 4,
+		ScaleZ		= 5,
+		CornerX		= 6,	///< Horizontal offset of the corner at 'Index'
+		CornerY		= 7,	///< Vertical offset of the corner at 'Index'
+		Parameter	= 8		///< Component 'Index' of the post shader parameter 'Parameter'
+	};
+
+
+	/**
+	 * Binds a single curve of a sequence track to a canvas property
+	 */
+	struct NAPAPI SequenceCurveBinding
+	{
+		std::string				mTrack;									///< Property: 'Track' output id assigned to the curve track
+		int						mCurve = 0;								///< Property: 'Curve' curve of the track, 0 for float tracks, 0-3 for vector tracks
+		ECanvasCurveTarget		mTarget = ECanvasCurveTarget::Parameter;///< Property: 'Target' canvas property to drive
+		int						mIndex = 0;								///< Property: 'Index' corner or parameter component
+		std::string				mParameter;								///< Property: 'Parameter' post shader parameter name, Parameter targets only
+	};
+
+
+	/**
+	 * Evaluates the curve bindings of all canvases in a single batched pass.
+	 * The curve segments of every bound track are baked into fixed size sample blocks, stored as structure of arrays.
+	 * Every channel keeps a cursor into its segments, which makes a frame linear in the number of channels
+	 * for sequences that play forward. Results are staged per canvas and applied once, after all channels are evaluated.
+	 */
+	class NAPAPI SequenceCurveBindings
+	{
+	public:
+		static constexpr int samplesPerSegment = 64;
+
+		/**
+		 * Adds the bindings of a canvas.
+		 * @param player player that plays the sequence with the bound tracks
+		 * @param bindings the bindings to add
+		 * @param canvas the canvas the bindings drive
+		 * @param errorState contains the error if a binding is invalid
+		 * @return if the bindings were added
+		 */
+		bool addCanvas(SequencePlayer& player, const std::vector<SequenceCurveBinding>& bindings, RenderCanvasComponentInstance& canvas, utility::ErrorState& errorState);
+
+		/**
+		 * Re-samples all bound tracks from their sequences, call after the sequences are edited.
+		 */
+		void bake();
+
+		/**
+		 * Re-samples all bound tracks when the curve points, segments or range of any of them changed since the last bake.
+		 * Only hashes the curve points when nothing changed, which is far cheaper than sampling them, call it every frame.
+		 * @return if the tracks were re-sampled
+		 */
+		bool bakeChanged();
+
+		/**
+		 * Evaluates all channels at the current time of their player and applies the results.
+		 */
+		void evaluate();
+
+		/**
+		 * @return total number of bound curves
+		 */
+		int getChannelCount() const													{ return static_cast<int>(mChannelValue.size()); }
+
+	private:
+		struct CanvasState
+		{
+			RenderCanvasComponentInstance*	mCanvas = nullptr;
+			TransformComponentInstance*		mTransform = nullptr;
+			glm::vec3						mTranslate;
+			glm::vec3						mScale;
+			std::vector<glm::vec2>			mCorners = std::vector<glm::vec2>(4);
+			int								mTranslateMask = 0;		///< Bit per evaluated translate component
+			int								mScaleMask = 0;			///< Bit per evaluated scale component
+			int								mCornerMask = 0;		///< Bit per evaluated corner component
+		};
+
+		// Players
+		std::vector<SequencePlayer*>		mPlayers;
+		std::vector<float>					mPlayerTimes;
+
+		// Canvases
+		std::vector<CanvasState>			mCanvases;
+
+		// Channels
+		std::vector<std::string>			mChannelTrack;
+		std::vector<int>					mChannelCurve;
+		std::vector<int>					mChannelPlayer;
+		std::vector<int>					mChannelCanvas;
+		std::vector<ECanvasCurveTarget>		mChannelTarget;
+		std::vector<int>					mChannelIndex;
+		std::vector<ShaderParameterTable*>	mChannelTable;
+		std::vector<int>					mChannelSegmentBegin;
+		std::vector<int>					mChannelSegmentEnd;
+		std::vector<int>					mChannelCursor;
+		std::vector<float>					mChannelValue;
+		std::vector<uint64>					mChannelFingerprint;	///< Hash of the bound curve when it was baked
+
+		// Segments, samplesPerSegment samples each
+		std::vector<float>					mSegmentStart;
+		std::vector<float>					mSegmentInvDuration;
+		std::vector<float>					mSamples;
+
+		void bakeChannel(int channel);
+		uint64 getFingerprint(int channel) const;
+	};
+}
@@ -0,0 +1,240 @@
+// Local Includes
+#include "shaderparametertable.h"
+
+// External Includes
+#include <material.h>
+#include <uniformdeclarations.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nap
+{
+	static EShaderParameterSource getSource(const std::string& name)
+	{
+		if (name == "iTime" || name == "time")
+			return EShaderParameterSource::Time;
+		if (name == "iTimeDelta" || name == "deltaTime")
+			return EShaderParameterSource::DeltaTime;
+		if (name == "iFrame" || name == "frame")
+			return EShaderParameterSource::Frame;
+		return EShaderParameterSource::User;
+	}
+
+
+	template<typename T>
+	static UniformValueInstance* createUniform(UniformStructInstance& ubo, const std::string& name, float* outValue)
+	{
+		T* uniform = ubo.getOrCreateUniform<T>(name);
+		if (uniform != nullptr)
+			std::memcpy(outValue, &uniform->getValue(), sizeof(uniform->getValue()));
+		return uniform;
+	}
+
+
+	bool ShaderParameterTable::init(MaterialInstance& materialInstance, const std::string& uboName, utility::ErrorState& errorState)
+	{
+		UniformStructInstance* ubo = materialInstance.getOrCreateUniform(uboName);
+		if (ubo == nullptr)
+			return true;
+
+		// Find the declaration of the UBO in the shader
+		const UniformBufferObjectDeclaration* declaration = nullptr;
+		for (const auto& ubo_declaration : materialInstance.getMaterial().getShader().getUBODeclarations())
+		{
+			if (ubo_declaration.mName == uboName)
+				declaration = &ubo_declaration;
+		}
+		if (!errorState.check(declaration != nullptr, "unable to find UBO declaration: %s", uboName.c_str()))
+			return false;
+
+		for (const auto& member : declaration->mMembers)
+		{
+			if (!member->get_type().is_derived_from(RTTI_OF(UniformValueDeclaration)))
+				continue;
+
+			ShaderParameter parameter;
+			parameter.mName = member->mName;
+			parameter.mSource = getSource(member->mName);
+			switch (static_cast<const UniformValueDeclaration&>(*member).mType)
+			{
+			case EUniformValueType::Float:
+				parameter.mType = EShaderParameterType::Float;
+				parameter.mComponents = 1;
+				break;
+			case EUniformValueType::Int:
+				parameter.mType = EShaderParameterType::Int;
+				parameter.mComponents = 1;
+				break;
+			case EUniformValueType::Vec2:
+				parameter.mType = EShaderParameterType::Vec2;
+				parameter.mComponents = 2;
+				break;
+			case EUniformValueType::Vec3:
+				parameter.mType = EShaderParameterType::Vec3;
+				parameter.mComponents = 3;
+				break;
+			case EUniformValueType::Vec4:
+				parameter.mType = EShaderParameterType::Vec4;
+				parameter.mComponents = 4;
+				break;
+			default:
+				// Matrices and nested structs aren't exposed as parameters
+				continue;
+			}
+
+			// Ints are uploaded as ints, a float slot would round them above 2^24
+			bool is_int = parameter.mType == EShaderParameterType::Int;
+			parameter.mOffset = static_cast<int>(is_int ? mIntValues.size() : mValues.size());
+			if (is_int)
+				mIntValues.emplace_back(0);
+			else
+				mValues.resize(mValues.size() + parameter.mComponents, 0.0f);
+			float* value = is_int ? nullptr : &mValues[parameter.mOffset];
+			switch (parameter.mType)
+			{
+			case EShaderParameterType::Float:
+				parameter.mUniform = createUniform<UniformFloatInstance>(*ubo, parameter.mName, value);
+				break;
+			case EShaderParameterType::Int:
+			{
+				UniformIntInstance* uniform = ubo->getOrCreateUniform<UniformIntInstance>(parameter.mName);
+				if (uniform != nullptr)
+					mIntValues[parameter.mOffset] = uniform->getValue();
+				parameter.mUniform = uniform;
+				break;
+			}
+			case EShaderParameterType::Vec2:
+				parameter.mUniform = createUniform<UniformVec2Instance>(*ubo, parameter.mName, value);
+				break;
+			case EShaderParameterType::Vec3:
+				parameter.mUniform = createUniform<UniformVec3Instance>(*ubo, parameter.mName, value);
+				break;
+			case EShaderParameterType::Vec4:
+				parameter.mUniform = createUniform<UniformVec4Instance>(*ubo, parameter.mName, value);
+				break;
+			}
+			if (!errorState.check(parameter.mUniform != nullptr, "unable to create uniform: %s", parameter.mName.c_str()))
+				return false;
+
+			if (parameter.mSource != EShaderParameterSource::User)
+				mTimeDriven.emplace_back(static_cast<int>(mParameters.size()));
+			mParameters.emplace_back(std::move(parameter));
+		}
+		mDirty.resize((mParameters.size() + 63) / 64, 0);
+		return true;
+	}
+
+
+	int ShaderParameterTable::find(const std::string& name) const
+	{
+		auto it = std::find_if(mParameters.begin(), mParameters.end(), [&name](const ShaderParameter& parameter) { return parameter.mName == name; });
+		return it == mParameters.end() ? -1 : static_cast<int>(it - mParameters.begin());
+	}
+
+
+	void ShaderParameterTable::set(int index, const float* values)
+	{
+		const ShaderParameter& parameter = mParameters[index];
+		if (parameter.mType == EShaderParameterType::Int)
+			mIntValues[parameter.mOffset] = static_cast<int>(std::lround(values[0]));
+		else
+			std::memcpy(&mValues[parameter.mOffset], values, parameter.mComponents * sizeof(float));
+		markDirty(index);
+	}
+
+
+	void ShaderParameterTable::setComponent(int index, int component, float value)
+	{
+		const ShaderParameter& parameter = mParameters[index];
+		if (parameter.mType == EShaderParameterType::Int)
+			mIntValues[parameter.mOffset] = static_cast<int>(std::lround(value));
+		else
+			mValues[parameter.mOffset + component] = value;
+		markDirty(index);
+	}
+
+
+	void ShaderParameterTable::setInt(int index, int value)
+	{
+		assert(mParameters[index].mType == EShaderParameterType::Int);
+		mIntValues[mParameters[index].mOffset] = value;
+		markDirty(index);
+	}
+
+
+	void ShaderParameterTable::update(const FrameTime& frameTime)
+	{
+		for (int index : mTimeDriven)
+		{
+			const ShaderParameter& parameter = mParameters[index];
+			if (parameter.mType == EShaderParameterType::Int)
+			{
+				// Integer frame counters keep counting exactly, time in whole seconds
+				mIntValues[parameter.mOffset] = parameter.mSource == EShaderParameterSource::Frame ? static_cast<int>(frameTime.mFrame) :
+					parameter.mSource == EShaderParameterSource::Time ? static_cast<int>(frameTime.mTime) : 0;
+				markDirty(index);
+				continue;
+			}
+			switch (parameter.mSource)
+			{
+			case EShaderParameterSource::Time:
+				mValues[parameter.mOffset] = frameTime.mTime;
+				break;
+			case EShaderParameterSource::DeltaTime:
+				mValues[parameter.mOffset] = frameTime.mDeltaTime;
+				break;
+			case EShaderParameterSource::Frame:
+				mValues[parameter.mOffset] = static_cast<float>(frameTime.mFrame);
+				break;
+			default:
+				break;
+			}
+			markDirty(index);
+		}
+
+		// Push dirty parameters only, walk the bitset a word at a time
+		for (size_t word = 0; word < mDirty.size(); word++)
+		{
+			uint64 bits = mDirty[word];
+			while (bits != 0)
+			{
+				int bit = 0;
+				while ((bits & (uint64(1) << bit)) == 0)
+					bit++;
+				flush(static_cast<int>(word * 64) + bit);
+				bits &= bits - 1;
+			}
+			mDirty[word] = 0;
+		}
+	}
+
+
+	void ShaderParameterTable::flush(int index)
+	{
+		const ShaderParameter& parameter = mParameters[index];
+		if (parameter.mType == EShaderParameterType::Int)
+		{
+			static_cast<UniformIntInstance*>(parameter.mUniform)->setValue(mIntValues[parameter.mOffset]);
+			return;
+		}
+		const float* value = &mValues[parameter.mOffset];
+		switch (parameter.mType)
+		{
+		case EShaderParameterType::Float:
+			static_cast<UniformFloatInstance*>(parameter.mUniform)->setValue(value[0]);
+			break;
+		case EShaderParameterType::Int:
+			break;
+		case EShaderParameterType::Vec2:
+			static_cast<UniformVec2Instance*>(parameter.mUniform)->setValue(glm::vec2(value[0], value[1]));
+			break;
+		case EShaderParameterType::Vec3:
+			static_cast<UniformVec3Instance*>(parameter.mUniform)->setValue(glm::vec3(value[0], value[1], value[2]));
+			break;
+		case EShaderParameterType::Vec4:
+			static_cast<UniformVec4Instance*>(parameter.mUniform)->setValue(glm::vec4(value[0], value[1], value[2], value[3]));
+			break;
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+// Local Includes
+#include "foglioservice.h"
+
+// External Includes
+#include <materialinstance.h>
+#include <uniforminstance.h>
+#include <utility/errorstate.h>
+#include <nap/numeric.h>
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Value type of a reflected shader parameter
+	 */
+	enum class EShaderParameterType : int
+	{
+		Float	= 0,
+		Int		= 1,
+		Vec2	= 2,
+		Vec3	= 3,
+		Vec4	= 4
+	};
+
+
+	/**
+	 * Where the value of a reflected shader parameter comes from
+	 */
+	enum class EShaderParameterSource : int
+	{
+		User		= 0,		///< Edited in the GUI or driven by a sequence
+		Time		= 1,		///< FrameTime::mTime, members named 'iTime' or 'time'
+		DeltaTime	= 2,		///< FrameTime::mDeltaTime, members named 'iTimeDelta' or 'deltaTime'
+		Frame		= 3			///< FrameTime::mFrame, members named 'iFrame' or 'frame'
+	};
+
+
+	/**
+	 * A single member of the reflected UBO
+	 */
+	struct ShaderParameter
+	{
+		std::string				mName;
+		EShaderParameterType	mType;
+		EShaderParameterSource	mSource;
+		int						mOffset;					///< Offset of the first component in the float values, or of the value in the int values
+		int						mComponents;				///< Number of components
+		UniformValueInstance*	mUniform = nullptr;
+	};
+
+
+	/**
+	 * Compact table of all parameters of a post shader UBO, built by reflecting the shader at init.
+	 * Float and vector values live in a single packed float array, int values in their own int array so they keep their precision.
+	 * Writes only mark a slot dirty.
+	 * update() feeds the time slots from the shared FrameTime and pushes only dirty slots to the material in one pass,
+	 * so there are no string lookups on the per frame path.
+	 */
+	class NAPAPI ShaderParameterTable
+	{
+	public:
+		/**
+		 * Reflects all value members of the given UBO and creates their uniform instances.
+		 * @param materialInstance material instance to bind the parameters to
+		 * @param uboName name of the uniform buffer object to reflect
+		 * @param errorState contains the error if a uniform can't be created
+		 * @return if the table initialized
+		 */
+		bool init(MaterialInstance& materialInstance, const std::string& uboName, utility::ErrorState& errorState);
+
+		/**
+		 * @param name parameter name
+		 * @return index of the parameter, -1 if not found
+		 */
+		int find(const std::string& name) const;
+
+		/**
+		 * @return all parameters, in declaration order
+		 */
+		const std::vector<ShaderParameter>& getParameters() const		{ return mParameters; }
+
+		/**
+		 * @param index index of a float or vector parameter
+		 * @return the components of the parameter, don't write through this pointer, use set()
+		 */
+		const float* getValue(int index) const							{ assert(mParameters[index].mType != EShaderParameterType::Int); return &mValues[mParameters[index].mOffset]; }
+
+		/**
+		 * @param index index of an int parameter
+		 * @return the value of the parameter
+		 */
+		int getInt(int index) const										{ assert(mParameters[index].mType == EShaderParameterType::Int); return mIntValues[mParameters[index].mOffset]; }
+
+		/**
+		 * Sets the components of a parameter and marks it dirty, int parameters are rounded.
+		 * @param index parameter index
+		 * @param values the components, at least getParameters()[index].mComponents
+		 */
+		void set(int index, const float* values);
+
+		/**
+		 * Sets a single component of a parameter and marks it dirty, int parameters are rounded.
+		 * @param index parameter index
+		 * @param component component index
+		 * @param value the new value
+		 */
+		void setComponent(int index, int component, float value);
+
+		/**
+		 * Sets an int parameter and marks it dirty.
+		 * @param index index of an int parameter
+		 * @param value the new value
+		 */
+		void setInt(int index, int value);
+
+		/**
+		 * Updates the time driven parameters and pushes all dirty parameters to the material in one batch.
+		 * @param frameTime shared time of the current frame
+		 */
+		void update(const FrameTime& frameTime);
+
+	private:
+		std::vector<ShaderParameter>	mParameters;
+		std::vector<float>				mValues;
+		std::vector<int>				mIntValues;
+		std::vector<uint64>				mDirty;				///< Bit per parameter
+		std::vector<int>				mTimeDriven;		///< Parameters fed from the frame time
+
+		void markDirty(int index)										{ mDirty[index >> 6] |= (uint64(1) << (index & 63)); }
+		void flush(int index);
+	};
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+// External Includes
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Memory layout and lock-free reader protocol of a shared frame ring.
+ * This header has no dependencies on NAP so that consumer processes can include it directly.
+ *
+ * The segment starts with a SharedFrameHeader, followed by mSlotCount slots of mSlotSize bytes.
+ * Every slot starts with a SharedFrameSlot, pixel data follows at SharedFrameSlot::dataOffset.
+ * The publisher writes frame N into slot N % mSlotCount, guarded by a sequence counter that is odd while the slot is written.
+ * Readers never block the publisher: a reader checks the sequence before and after it used the pixels, the frame is
+ * only valid when both reads are equal and even. Readers can therefore process pixels in place, without copying.
+ *
+ * The segment keeps its name for the lifetime of the publisher. When the frame size changes the publisher lays out the
+ * slots again in the same segment, the generation in the header is odd while it does. The segment only grows,
+ * so a stale mapping never faults. Readers attach to a generation, copy the layout into a View and re-attach
+ * as soon as the generation changes. Frames read across a layout change fail validation.
+ */
+namespace nap
+{
+	namespace sharedframe
+	{
+		inline constexpr uint32_t magic = 0x464f4731;		///< 'FOG1'
+		inline constexpr uint32_t version = 2;
+
+		/**
+		 * Pixel format of a shared frame
+		 */
+		enum class EFormat : uint32_t
+		{
+			RGBA8 = 0
+		};
+
+		struct Header
+		{
+			uint32_t				mMagic;
+			uint32_t				mVersion;
+			uint32_t				mSlotCount;
+			uint32_t				mSlotSize;				///< Bytes per slot, slot header included
+			std::atomic<uint64_t>	mLatestFrame;			///< Number of the last published frame, 0 when nothing was published yet
+			uint64_t				mSegmentSize;			///< Bytes of the segment used by the current layout
+			std::atomic<uint32_t>	mGeneration;			///< Incremented before and after every layout change, odd while the layout changes
+			uint8_t					mPadding[28];
+		};
+		static_assert(sizeof(Header) == 64, "shared frame header must be 64 bytes");
+
+		struct Slot
+		{
+			static constexpr size_t dataOffset = 64;
+
+			std::atomic<uint64_t>	mSequence;				///< Odd while the publisher writes the slot
+			uint64_t				mFrame;					///< Frame number, starts at 1
+			int64_t					mTimestamp;				///< Steady clock time in nanoseconds the frame was published
+			uint32_t				mWidth;
+			uint32_t				mHeight;
+			uint32_t				mStride;				///< Bytes per row
+			EFormat					mFormat;
+			uint8_t					mPadding[24];
+		};
+		static_assert(sizeof(Slot) == Slot::dataOffset, "shared frame slot header must be 64 bytes");
+
+		/**
+		 * Layout of the segment as a reader attached to it
+		 */
+		struct View
+		{
+			Header*					mHeader = nullptr;
+			size_t					mMappedSize = 0;		///< Bytes the reader mapped
+			uint32_t				mGeneration = 0;		///< Generation of the layout
+			uint32_t				mSlotCount = 0;
+			uint32_t				mSlotSize = 0;
+		};
+
+		/**
+		 * @return slot with the given index, publisher side
+		 */
+		inline Slot* getSlot(Header* header, uint32_t index)
+		{
+			return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(header) + sizeof(Header) + static_cast<size_t>(index) * header->mSlotSize);
+		}
+
+		/**
+		 * @return slot with the given index, in the layout the reader attached to
+		 */
+		inline Slot* getSlot(const View& view, uint32_t index)
+		{
+			return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(view.mHeader) + sizeof(Header) + static_cast<size_t>(index) * view.mSlotSize);
+		}
+
+		/**
+		 * Publisher side: marks the layout as changing, readers detach.
+		 */
+		inline void beginLayout(Header* header)
+		{
+			header->mLatestFrame.store(0, std::memory_order_relaxed);
+			header->mGeneration.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		/**
+		 * Publisher side: publishes the new layout, readers can attach to it.
+		 */
+		inline void endLayout(Header* header)
+		{
+			header->mMagic = magic;
+			header->mGeneration.fetch_add(1, std::memory_order_release);
+		}
+
+		/**
+		 * Reader side: attaches to the current layout of a mapped segment.
+		 * @param header start of the mapping
+		 * @param mappedSize bytes mapped, the layout must fit
+		 * @param outView the layout
+		 * @return if the layout is complete and fits the mapping, otherwise map the segment again later
+		 */
+		inline bool attach(Header* header, size_t mappedSize, View& outView)
+		{
+			uint32_t generation = header->mGeneration.load(std::memory_order_acquire);
+			if ((generation & 1) != 0 || generation == 0 || header->mMagic != magic)
+				return false;
+			outView = { header, mappedSize, generation, header->mSlotCount, header->mSlotSize };
+			uint64_t segment_size = header->mSegmentSize;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return header->mGeneration.load(std::memory_order_relaxed) == generation && outView.mSlotCount > 0 &&
+				outView.mSlotSize > Slot::dataOffset && segment_size <= mappedSize &&
+				sizeof(Header) + static_cast<uint64_t>(outView.mSlotCount) * outView.mSlotSize <= segment_size;
+		}
+
+		/**
+		 * Reader side: a reader that is no longer current has to map the segment again and re-attach.
+		 * @return if the layout the reader attached to is still the layout of the segment
+		 */
+		inline bool isCurrent(const View& view)
+		{
+			return view.mHeader->mGeneration.load(std::memory_order_acquire) == view.mGeneration;
+		}
+
+		/**
+		 * @return pixels of a slot
+		 */
+		inline const uint8_t* getPixels(const Slot* slot)
+		{
+			return reinterpret_cast<const uint8_t*>(slot) + Slot::dataOffset;
+		}
+
+		/**
+		 * Publisher side: marks a slot as being written.
+		 */
+		inline void beginWrite(Slot* slot)
+		{
+			slot->mSequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		/**
+		 * Publisher side: marks a slot as complete and publishes its frame number.
+		 */
+		inline void endWrite(Header* header, Slot* slot)
+		{
+			slot->mSequence.fetch_add(1, std::memory_order_release);
+			header->mLatestFrame.store(slot->mFrame, std::memory_order_release);
+		}
+
+		/**
+		 * Reader side: starts reading the slot of the latest frame.
+		 * The slot header is only trustworthy after validate(), check its size against the slot size before touching the pixels.
+		 * @param view the layout the reader attached to
+		 * @param outSequence sequence to pass to validate()
+		 * @return the slot, nullptr when no frame is available, the slot is being written or the layout changed
+		 */
+		inline const Slot* beginRead(const View& view, uint64_t& outSequence)
+		{
+			uint64_t frame = view.mHeader->mLatestFrame.load(std::memory_order_acquire);
+			if (frame == 0 || !isCurrent(view))
+				return nullptr;
+			Slot* slot = getSlot(view, static_cast<uint32_t>(frame % view.mSlotCount));
+			outSequence = slot->mSequence.load(std::memory_order_acquire);
+			return (outSequence & 1) == 0 ? slot : nullptr;
+		}
+
+		/**
+		 * Reader side: checks if the slot wasn't overwritten, and the layout didn't change, while it was read.
+		 * @return if everything read from the slot since beginRead() is valid
+		 */
+		inline bool validate(const View& view, const Slot* slot, uint64_t sequence)
+		{
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return slot->mSequence.load(std::memory_order_relaxed) == sequence && view.mHeader->mGeneration.load(std::memory_order_relaxed) == view.mGeneration;
+		}
+	}
+}
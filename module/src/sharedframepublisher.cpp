@@ -0,0 +1,159 @@
+// Local Includes
+#include "sharedframepublisher.h"
+
+// External Includes
+#include <nap/logger.h>
+#include <algorithm>
+#include <chrono>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+RTTI_BEGIN_CLASS(nap::SharedFramePublisher)
+	RTTI_PROPERTY("Name",	&nap::SharedFramePublisher::mName,	nap::rtti::EPropertyMetaData::Required)
+	RTTI_PROPERTY("Slots",	&nap::SharedFramePublisher::mSlots,	nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+	SharedFramePublisher::~SharedFramePublisher()
+	{
+		destroy();
+	}
+
+
+	bool SharedFramePublisher::init(utility::ErrorState& errorState)
+	{
+#ifdef _WIN32
+		nap::Logger::warn("%s: shared memory publishing is only supported on POSIX platforms, publisher disabled", mID.c_str());
+		mEnabled = false;
+		return true;
+#else
+		if (!errorState.check(!mName.empty() && mName[0] == '/', "%s: shared memory name must start with a '/'", mID.c_str()))
+			return false;
+		return errorState.check(mSlots >= 2, "%s: at least 2 slots are required", mID.c_str());
+#endif
+	}
+
+
+	void SharedFramePublisher::onDestroy()
+	{
+		destroy();
+	}
+
+
+	void SharedFramePublisher::publish(Texture2D& texture)
+	{
+		if (!mEnabled)
+			return;
+
+		glm::ivec2 size(texture.getWidth(), texture.getHeight());
+		if (mHeader == nullptr || size != mSize)
+		{
+			utility::ErrorState error;
+			if (!create(size, error))
+			{
+				nap::Logger::error("%s: %s", mID.c_str(), error.toString().c_str());
+				mEnabled = false;
+				return;
+			}
+		}
+
+		// Readbacks in flight during a size change complete after the slots are laid out again
+		uint64 layout = mLayout;
+		texture.asyncGetData([this, layout](const void* data, size_t size) { onReadback(data, size, layout); });
+	}
+
+
+	bool SharedFramePublisher::create(const glm::ivec2& size, utility::ErrorState& errorState)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		// Pixel data of every slot starts on a cache line
+		size_t stride = static_cast<size_t>(size.x) * 4;
+		size_t slot_size = sharedframe::Slot::dataOffset + ((stride * size.y + 63) & ~size_t(63));
+		size_t segment_size = sizeof(sharedframe::Header) + slot_size * mSlots;
+
+		// A size change lays out the slots again in the same segment, readers keep its name and re-attach.
+		// Readers that still use the old layout are detached first.
+		if (mHeader != nullptr)
+		{
+			sharedframe::beginLayout(mHeader);
+			munmap(mHeader, mMappedSize);
+			mHeader = nullptr;
+		}
+
+		// The segment only grows, readers may still have a larger layout mapped
+		int fd = shm_open(mName.c_str(), O_CREAT | O_RDWR, 0644);
+		if (!errorState.check(fd >= 0, "unable to open shared memory: %s", mName.c_str()))
+			return false;
+		struct stat info = {};
+		size_t mapped_size = fstat(fd, &info) == 0 ? std::max(static_cast<size_t>(info.st_size), segment_size) : segment_size;
+		bool sized = static_cast<size_t>(info.st_size) >= mapped_size || ftruncate(fd, static_cast<off_t>(mapped_size)) == 0;
+		void* memory = sized ? mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (!errorState.check(memory != MAP_FAILED, "unable to map %d bytes of shared memory: %s", static_cast<int>(mapped_size), mName.c_str()))
+		{
+			shm_unlink(mName.c_str());
+			return false;
+		}
+
+		// The generation continues from a segment left by a previous layout or process, its readers detach as well
+		mHeader = static_cast<sharedframe::Header*>(memory);
+		mMappedSize = mapped_size;
+		mSize = size;
+		mLayout++;
+		if ((mHeader->mGeneration.load(std::memory_order_relaxed) & 1) == 0)
+			sharedframe::beginLayout(mHeader);
+		std::memset(reinterpret_cast<uint8*>(memory) + sizeof(sharedframe::Header), 0, mapped_size - sizeof(sharedframe::Header));
+		mHeader->mVersion = sharedframe::version;
+		mHeader->mSlotCount = static_cast<uint32_t>(mSlots);
+		mHeader->mSlotSize = static_cast<uint32_t>(slot_size);
+		mHeader->mSegmentSize = segment_size;
+		mHeader->mLatestFrame.store(0, std::memory_order_relaxed);
+		sharedframe::endLayout(mHeader);
+		return true;
+#endif
+	}
+
+
+	void SharedFramePublisher::destroy()
+	{
+#ifndef _WIN32
+		if (mHeader == nullptr)
+			return;
+		sharedframe::beginLayout(mHeader);
+		munmap(mHeader, mMappedSize);
+		shm_unlink(mName.c_str());
+		mHeader = nullptr;
+		mMappedSize = 0;
+#endif
+	}
+
+
+	void SharedFramePublisher::onReadback(const void* data, size_t size, uint64 layout)
+	{
+		// Frames of another size would be stamped with the current size and pass validation
+		size_t stride = static_cast<size_t>(mSize.x) * 4;
+		if (mHeader == nullptr || layout != mLayout || size < stride * mSize.y)
+			return;
+
+		// The readback is copied straight into the slot, consumers read it in place
+		uint64 frame = ++mFrame;
+		sharedframe::Slot* slot = sharedframe::getSlot(mHeader, static_cast<uint32_t>(frame % mHeader->mSlotCount));
+		sharedframe::beginWrite(slot);
+		slot->mFrame = frame;
+		slot->mWidth = static_cast<uint32_t>(mSize.x);
+		slot->mHeight = static_cast<uint32_t>(mSize.y);
+		slot->mStride = static_cast<uint32_t>(stride);
+		slot->mFormat = sharedframe::EFormat::RGBA8;
+		std::memcpy(reinterpret_cast<uint8*>(slot) + sharedframe::Slot::dataOffset, data, stride * mSize.y);
+		slot->mTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		sharedframe::endWrite(mHeader, slot);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+// Local Includes
+#include "sharedframeprotocol.h"
+
+// External Includes
+#include <nap/resource.h>
+#include <texture2d.h>
+
+namespace nap
+{
+	/**
+	 * Publishes frames of a texture into a named POSIX shared memory ring, see sharedframeprotocol.h for the layout.
+	 * Frames are read back asynchronously, the readback is copied straight into the shared memory slot,
+	 * consumers read the pixels in place. The texture must be created with ETextureUsage::DynamicRead.
+	 * The segment is created on the first publish, using the size of the published texture.
+	 * When the size changes the slots are laid out again in the same segment, readers re-attach to it.
+	 * Readbacks requested before a size change are dropped, they don't match the new layout.
+	 *
+	 * Publishing is opt-in: the main output is published when the scene contains a SharedFramePublisher 'MainOutputPublisher'
+	 * and a DynamicRead RenderTarget 'MainOutputPublisherTarget', canvases when their 'Publisher' property is set.
+	 * On platforms without POSIX shared memory the publisher logs a warning and stays disabled.
+	 */
+	class NAPAPI SharedFramePublisher : public Resource
+	{
+		RTTI_ENABLE(Resource)
+	public:
+		virtual ~SharedFramePublisher() override;
+
+		/**
+		 * Validates the publisher properties, disables the publisher on platforms without POSIX shared memory.
+		 * @param errorState contains the error if the properties are invalid
+		 * @return if initialization succeeded
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+		/**
+		 * Detaches the readers, unmaps and unlinks the shared memory segment.
+		 */
+		virtual void onDestroy() override;
+
+		/**
+		 * Requests a readback of the texture that is published once the copy completed.
+		 * Call after the texture is rendered, within the headless recording of the frame.
+		 * @param texture the texture to publish
+		 */
+		void publish(Texture2D& texture);
+
+		/**
+		 * @return number of published frames
+		 */
+		uint64 getPublishedFrames() const						{ return mFrame; }
+
+		/**
+		 * @return if frames are published, false on unsupported platforms or when the segment can't be created
+		 */
+		bool isEnabled() const									{ return mEnabled; }
+
+		std::string		mName = "/foglio";						///< Property: 'Name' name of the shared memory segment, starts with a '/'
+		int				mSlots = 3;								///< Property: 'Slots' number of frames in the ring
+
+	private:
+		sharedframe::Header*	mHeader = nullptr;
+		size_t					mMappedSize = 0;
+		glm::ivec2				mSize = { 0, 0 };
+		uint64					mFrame = 0;
+		uint64					mLayout = 0;			///< Incremented on every layout of the slots, readbacks of older layouts are dropped
+		bool					mEnabled = true;
+
+		bool create(const glm::ivec2& size, utility::ErrorState& errorState);
+		void destroy();
+		void onReadback(const void* data, size_t size, uint64 layout);
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// External Includes
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Bounded, lock-free single producer / single consumer queue.
+	 * push() may only be called from one thread and front() / pop() from one other thread.
+	 * The capacity is rounded up to a power of two, elements are default constructed up front so pushing never allocates.
+	 */
+	template<typename T>
+	class SPSCQueue
+	{
+	public:
+		/**
+		 * @param capacity maximum number of queued elements
+		 */
+		explicit SPSCQueue(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity + 1)
+				size <<= 1;
+			mBuffer.resize(size);
+			mMask = size - 1;
+		}
+
+		SPSCQueue(const SPSCQueue&) = delete;
+		SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+		/**
+		 * Producer only. Copies an element into the queue.
+		 * @param value the element to push
+		 * @return false if the queue is full, the element is dropped
+		 */
+		bool push(const T& value)
+		{
+			const size_t tail = mTail.load(std::memory_order_relaxed);
+			const size_t next = (tail + 1) & mMask;
+			if (next == mHead.load(std::memory_order_acquire))
+				return false;
+			mBuffer[tail] = value;
+			mTail.store(next, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * Consumer only.
+		 * @return the oldest element, nullptr if the queue is empty. Valid until pop() is called.
+		 */
+		T* front()
+		{
+			const size_t head = mHead.load(std::memory_order_relaxed);
+			if (head == mTail.load(std::memory_order_acquire))
+				return nullptr;
+			return &mBuffer[head];
+		}
+
+		/**
+		 * Consumer only. Removes the oldest element, the queue must not be empty.
+		 */
+		void pop()
+		{
+			const size_t head = mHead.load(std::memory_order_relaxed);
+			mHead.store((head + 1) & mMask, std::memory_order_release);
+		}
+
+	private:
+		std::vector<T>					mBuffer;
+		size_t							mMask = 0;
+		alignas(64) std::atomic<size_t>	mHead = { 0 };		///< Next element to read, written by the consumer
+		alignas(64) std::atomic<size_t>	mTail = { 0 };		///< Next slot to write, written by the producer
+	};
+}
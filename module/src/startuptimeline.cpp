@@ -0,0 +1,59 @@
+// Local Includes
+#include "startuptimeline.h"
+
+// External Includes
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <map>
+
+namespace nap
+{
+	StartupTimeline::StartupTimeline() : mStart(Clock::now())
+	{ }
+
+
+	double StartupTimeline::now() const
+	{
+		return std::chrono::duration<double>(Clock::now() - mStart).count();
+	}
+
+
+	void StartupTimeline::record(const std::string& category, const std::string& name, double start, double end)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!mClosed)
+			mEntries.push_back({ category, name, start, end - start });
+	}
+
+
+	bool StartupTimeline::markFirstFrame()
+	{
+		if (hasFirstFrame())
+			return false;
+
+		// Nothing is added after this, the entries can be read without lock from here on
+		std::lock_guard<std::mutex> lock(mMutex);
+		mClosed = true;
+		std::sort(mEntries.begin(), mEntries.end(), [](const Entry& a, const Entry& b) { return a.mStart < b.mStart; });
+		mTimeToFirstFrame = now();
+		return true;
+	}
+
+
+	std::string StartupTimeline::toString() const
+	{
+		std::map<std::string, double> category_totals;
+		std::string report = "Startup timeline:\n";
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto& entry : mEntries)
+		{
+			report += utility::stringFormat("  %8.3fs  %8.2fms  %-10s %s\n", entry.mStart, entry.mDuration * 1000.0, entry.mCategory.c_str(), entry.mName.c_str());
+			category_totals[entry.mCategory] += entry.mDuration;
+		}
+		for (const auto& total : category_totals)
+			report += utility::stringFormat("  total %-10s %8.2fms\n", total.first.c_str(), total.second * 1000.0);
+		if (hasFirstFrame())
+			report += utility::stringFormat("  time to first frame: %.3fs", mTimeToFirstFrame);
+		return report;
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// External Includes
+#include <nap/numeric.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Records how long each resource took to become available during startup, and the time to first frame.
+	 * Entries can be recorded from any thread, all times are in seconds relative to the start of the timeline.
+	 * The timeline is closed by the first frame: later entries, such as canvas inits on reload, are ignored.
+	 */
+	class NAPAPI StartupTimeline
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Entry
+		{
+			std::string mCategory;				///< Kind of work, e.g. 'prefetch' or 'canvas'
+			std::string mName;					///< Resource the work was done for
+			double		mStart = 0.0;			///< Start time in seconds, relative to the timeline start
+			double		mDuration = 0.0;		///< Duration in seconds
+		};
+
+		StartupTimeline();
+
+		/**
+		 * @return the time in seconds since the timeline started
+		 */
+		double now() const;
+
+		/**
+		 * Adds an entry to the timeline, thread safe. Ignored after the first frame.
+		 * @param category kind of work
+		 * @param name name of the resource
+		 * @param start start time in seconds, as returned by now()
+		 * @param end end time in seconds, as returned by now()
+		 */
+		void record(const std::string& category, const std::string& name, double start, double end);
+
+		/**
+		 * Marks the first presented frame and closes the timeline, only the first call has effect
+		 * @return if this was the first frame
+		 */
+		bool markFirstFrame();
+
+		/**
+		 * @return if the first frame has been rendered
+		 */
+		bool hasFirstFrame() const										{ return mTimeToFirstFrame >= 0.0; }
+
+		/**
+		 * @return time in seconds from service init to the first frame, -1 if no frame has been rendered yet
+		 */
+		double getTimeToFirstFrame() const								{ return mTimeToFirstFrame; }
+
+		/**
+		 * Entries are sorted on start time once the first frame is marked, only read them after hasFirstFrame().
+		 * @return all entries recorded before the first frame
+		 */
+		const std::vector<Entry>& getEntries() const					{ return mEntries; }
+
+		/**
+		 * @return human readable report: every entry, the total per category and the time to first frame
+		 */
+		std::string toString() const;
+
+	private:
+		Clock::time_point		mStart;
+		mutable std::mutex		mMutex;
+		std::vector<Entry>		mEntries;
+		bool					mClosed = false;			///< Set by the first frame, guarded by mMutex
+		double					mTimeToFirstFrame = -1.0;
+	};
+
+
+	/**
+	 * Records the lifetime of this object as an entry of the startup timeline.
+	 */
+	class NAPAPI ScopedStartupTimer
+	{
+	public:
+		ScopedStartupTimer(StartupTimeline& timeline, const std::string& category, const std::string& name) :
+			mTimeline(timeline), mCategory(category), mName(name), mStart(timeline.now())	{ }
+
+		~ScopedStartupTimer()											{ mTimeline.record(mCategory, mName, mStart, mTimeline.now()); }
+
+	private:
+		StartupTimeline&	mTimeline;
+		std::string			mCategory;
+		std::string			mName;
+		double				mStart;
+	};
+}
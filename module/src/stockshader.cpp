@@ -0,0 +1,37 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+ // Local includes
+#include "stockshader.h"
+#include "foglioservice.h"
+
+// External includes
+#include <nap/core.h>
+
+// nap::StockShader run time class definition
+RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::StockShader)
+RTTI_END_CLASS
+
+
+//////////////////////////////////////////////////////////////////////////
+// StockShader
+//////////////////////////////////////////////////////////////////////////
+
+namespace nap
+{
+	StockShader::StockShader(Core& core, const char* name) : Shader(core),
+		mFoglioService(core.getService<FoglioService>()), mName(name) { }
+
+
+	bool StockShader::init(utility::ErrorState& errorState)
+	{
+		std::string vert_source;
+		std::string frag_source;
+		if (!mFoglioService->getStockShaderSource(mName, vert_source, frag_source, errorState))
+			return false;
+
+		//Compile shader
+		return this->load(mName, vert_source.data(), vert_source.size(), frag_source.data(), frag_source.size(), errorState);
+	}
+}
@@ -0,0 +1,51 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#pragma once
+
+ // External Includes
+#include <shader.h>
+
+namespace nap
+{
+	// Forward declares
+	class Core;
+	class FoglioService;
+
+	// stock shader names, the source files are <name>.vert and <name>.frag
+	namespace shader
+	{
+		inline constexpr const char* canvaswarp = "warp";
+		inline constexpr const char* mask = "mask";
+		inline constexpr const char* canvasinterface = "canvasinterface";
+		inline constexpr const char* frame = "frame";
+		inline constexpr const char* block = "block";
+	}
+
+	/**
+		shader of which the source ships with the foglio module, see FoglioService::getStockShaderSource().
+		Every stock shader derives from it with its own type, the render service creates one material per shader type.
+	 */
+	class NAPAPI StockShader : public Shader
+	{
+		RTTI_ENABLE(Shader)
+	public:
+		/**
+		 * @param core the core
+		 * @param name stock shader name, one of the nap::shader names
+		 */
+		StockShader(Core& core, const char* name);
+
+		/**
+		 * Cross compiles the GLSL code of the stock shader to SPIR-V, creates the shader module and parses all the uniforms and samplers.
+		 * @param errorState contains the error if initialization fails.
+		 * @return if initialization succeeded.
+		 */
+		virtual bool init(utility::ErrorState& errorState) override;
+
+	private:
+		FoglioService* mFoglioService = nullptr;
+		const char* mName = nullptr;
+	};
+}
@@ -0,0 +1,146 @@
+#include "tracer.h"
+
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace nap
+{
+	static void writeJsonString(std::ofstream& stream, const char* text)
+	{
+		stream << '"';
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				stream << '\\' << *c;
+			else if (static_cast<unsigned char>(*c) < 0x20)
+				stream << ' ';
+			else
+				stream << *c;
+		}
+		stream << '"';
+	}
+
+
+	Tracer& Tracer::get()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+
+	Tracer::ThreadBufferOwner::~ThreadBufferOwner()
+	{
+		if (mBuffer != nullptr)
+			Tracer::get().releaseThreadBuffer(*mBuffer);
+	}
+
+
+	Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+	{
+		// Registered once per thread, after that recording never locks
+		thread_local ThreadBufferOwner owner;
+		if (owner.mBuffer == nullptr)
+		{
+			// Reuse the buffer of a finished thread, its zones are dropped
+			std::lock_guard<std::mutex> lock(mMutex);
+			auto free = std::find_if(mBuffers.begin(), mBuffers.end(), [](const auto& buffer) { return !buffer->mInUse; });
+			if (free == mBuffers.end())
+			{
+				mBuffers.emplace_back(std::make_unique<ThreadBuffer>());
+				free = mBuffers.end() - 1;
+			}
+			owner.mBuffer = free->get();
+			owner.mBuffer->mInUse = true;
+			owner.mBuffer->mHead.store(0, std::memory_order_relaxed);
+			owner.mBuffer->mThreadID = ++mThreadCount;
+			owner.mBuffer->mName = utility::stringFormat("thread %d", owner.mBuffer->mThreadID);
+		}
+		return *owner.mBuffer;
+	}
+
+
+	void Tracer::releaseThreadBuffer(ThreadBuffer& buffer)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		buffer.mInUse = false;
+	}
+
+
+	void Tracer::record(const char* name, const char* detail, uint64 start, uint64 end)
+	{
+		if (!isEnabled())
+			return;
+
+		// Single producer: the slot is filled first, publishing the new head makes it visible to the writer
+		ThreadBuffer& buffer = getThreadBuffer();
+		uint64 head = buffer.mHead.load(std::memory_order_relaxed);
+		Zone& zone = buffer.mZones[head % zoneCapacity];
+		zone.mName = name;
+		zone.mDetail[0] = '\0';
+		if (detail != nullptr)
+		{
+			std::strncpy(zone.mDetail, detail, detailLength - 1);
+			zone.mDetail[detailLength - 1] = '\0';
+		}
+		zone.mStart = start;
+		zone.mEnd = end;
+		buffer.mHead.store(head + 1, std::memory_order_release);
+	}
+
+
+	void Tracer::setThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = getThreadBuffer();
+		std::lock_guard<std::mutex> lock(mMutex);
+		buffer.mName = name;
+	}
+
+
+	bool Tracer::writeChromeTrace(const std::string& path, utility::ErrorState& errorState)
+	{
+		std::ofstream stream(path);
+		if (!errorState.check(stream.is_open(), "unable to open %s for writing", path.c_str()))
+			return false;
+
+		stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		std::vector<Zone> zones;
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto& buffer : mBuffers)
+		{
+			// Copy the ring while its thread keeps writing, then drop the zones that may have been overwritten during the copy
+			uint64 head = buffer->mHead.load(std::memory_order_acquire);
+			uint64 begin = head > zoneCapacity ? head - zoneCapacity : 0;
+			zones.clear();
+			for (uint64 i = begin; i < head; i++)
+				zones.emplace_back(buffer->mZones[i % zoneCapacity]);
+			uint64 new_head = buffer->mHead.load(std::memory_order_acquire);
+			uint64 valid = new_head >= zoneCapacity ? new_head - zoneCapacity + 1 : 0;
+			uint64 skip = std::min<uint64>(valid > begin ? valid - begin : 0, zones.size());
+
+			stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->mThreadID << ",\"args\":{\"name\":";
+			writeJsonString(stream, buffer->mName.c_str());
+			stream << "}}";
+			first = false;
+
+			for (auto zone = zones.begin() + skip; zone != zones.end(); ++zone)
+			{
+				stream << ",\n{\"name\":";
+				writeJsonString(stream, zone->mName);
+				stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->mThreadID;
+				stream << utility::stringFormat(",\"ts\":%.3f,\"dur\":%.3f", zone->mStart / 1000.0, (zone->mEnd - zone->mStart) / 1000.0);
+				if (zone->mDetail[0] != '\0')
+				{
+					stream << ",\"args\":{\"detail\":";
+					writeJsonString(stream, zone->mDetail);
+					stream << "}";
+				}
+				stream << "}";
+			}
+		}
+		stream << "\n]}\n";
+		return errorState.check(stream.good(), "unable to write %s", path.c_str());
+	}
+}
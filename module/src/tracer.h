@@ -0,0 +1,146 @@
+#pragma once
+
+// External Includes
+#include <utility/errorstate.h>
+#include <nap/numeric.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Records timed CPU zones of every thread, for inspection in chrome://tracing or Perfetto.
+	 * Every thread writes into its own ring buffer without locking, only the latest zones of a thread are kept.
+	 * The buffer of a thread that exits is reused by the next thread that records, the zones of the finished thread are kept until then.
+	 * Use the FOGLIO_TRACE_ZONE macros, they compile to nothing when the module is built without FOGLIO_TRACING.
+	 */
+	class NAPAPI Tracer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr int zoneCapacity = 16384;		///< Zones kept per thread
+		static constexpr int detailLength = 32;			///< Characters of a zone detail that are kept, including terminator
+
+		struct Zone
+		{
+			const char*		mName = nullptr;			///< Static zone name
+			char			mDetail[detailLength];		///< Copy of the zone detail, e.g. the canvas, empty when there is none
+			uint64			mStart = 0;					///< Nanoseconds since the tracer started
+			uint64			mEnd = 0;					///< Nanoseconds since the tracer started
+		};
+
+		/**
+		 * @return the tracer shared by all threads
+		 */
+		static Tracer& get();
+
+		/**
+		 * @return nanoseconds since the tracer started
+		 */
+		uint64 now() const												{ return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - mStart).count(); }
+
+		/**
+		 * Adds a zone to the ring buffer of the calling thread, lock free
+		 * @param name static zone name, the pointer is stored
+		 * @param detail optional detail, copied and truncated
+		 * @param start start time in nanoseconds, as returned by now()
+		 * @param end end time in nanoseconds, as returned by now()
+		 */
+		void record(const char* name, const char* detail, uint64 start, uint64 end);
+
+		/**
+		 * Names the calling thread in the trace
+		 * @param name thread name
+		 */
+		void setThreadName(const std::string& name);
+
+		/**
+		 * Enables or disables recording at runtime, zones are still timed but dropped when disabled
+		 * @param enabled if zones are recorded
+		 */
+		void setEnabled(bool enabled)									{ mEnabled.store(enabled, std::memory_order_relaxed); }
+
+		/**
+		 * @return if zones are recorded
+		 */
+		bool isEnabled() const											{ return mEnabled.load(std::memory_order_relaxed); }
+
+		/**
+		 * Writes the zones of all threads as Chrome trace event JSON, while the threads keep recording.
+		 * @param path output file
+		 * @param errorState contains the error if the file can't be written
+		 * @return if the trace was written
+		 */
+		bool writeChromeTrace(const std::string& path, utility::ErrorState& errorState);
+
+	private:
+		// Zones of a single thread, written by that thread only
+		struct ThreadBuffer
+		{
+			int						mThreadID = 0;
+			std::string				mName;
+			std::vector<Zone>		mZones = std::vector<Zone>(zoneCapacity);
+			std::atomic<uint64>		mHead = { 0 };		///< Number of zones ever written
+			bool					mInUse = true;		///< If a running thread owns the buffer
+		};
+
+		// Returns the buffer of a thread to the tracer when the thread exits
+		struct ThreadBufferOwner
+		{
+			ThreadBuffer*			mBuffer = nullptr;
+			~ThreadBufferOwner();
+		};
+
+		Tracer() : mStart(Clock::now())									{ }
+		ThreadBuffer& getThreadBuffer();
+		void releaseThreadBuffer(ThreadBuffer& buffer);
+
+		Clock::time_point							mStart;
+		std::atomic<bool>							mEnabled = { true };
+		std::mutex									mMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>>	mBuffers;			///< Buffers outlive their threads, so zones of finished threads can be written
+		int											mThreadCount = 0;	///< Threads that ever recorded, numbers the threads in the trace
+	};
+
+
+	/**
+	 * Records its lifetime as a zone of the tracer. The detail is copied, it can be a temporary.
+	 */
+	class NAPAPI TraceZone
+	{
+	public:
+		TraceZone(const char* name, const char* detail = nullptr) : mName(name), mStart(Tracer::get().now())
+		{
+			mDetail[0] = '\0';
+			if (detail != nullptr)
+				std::strncpy(mDetail, detail, Tracer::detailLength - 1);
+			mDetail[Tracer::detailLength - 1] = '\0';
+		}
+
+		TraceZone(const char* name, const std::string& detail) : TraceZone(name, detail.c_str())		{ }
+		~TraceZone()																					{ Tracer::get().record(mName, mDetail, mStart, Tracer::get().now()); }
+
+	private:
+		const char*		mName;
+		char			mDetail[Tracer::detailLength];
+		uint64			mStart;
+	};
+}
+
+#ifdef FOGLIO_TRACING
+	#define FOGLIO_TRACE_CONCAT_INNER(a, b) a##b
+	#define FOGLIO_TRACE_CONCAT(a, b) FOGLIO_TRACE_CONCAT_INNER(a, b)
+	#define FOGLIO_TRACE_ZONE(name) nap::TraceZone FOGLIO_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+	#define FOGLIO_TRACE_ZONE_DETAIL(name, detail) nap::TraceZone FOGLIO_TRACE_CONCAT(trace_zone_, __LINE__)(name, detail)
+	#define FOGLIO_TRACE_THREAD(name) nap::Tracer::get().setThreadName(name)
+#else
+	#define FOGLIO_TRACE_ZONE(name)
+	#define FOGLIO_TRACE_ZONE_DETAIL(name, detail)
+	#define FOGLIO_TRACE_THREAD(name)
+#endif
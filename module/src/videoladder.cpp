@@ -0,0 +1,283 @@
+// Local Includes
+#include "videoladder.h"
+#include "tracer.h"
+
+// External Includes
+#include <utility/fileutils.h>
+#include <nap/logger.h>
+#include <utility/stringutils.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace nap
+{
+	// Switching up hides a blurry picture, switching down only saves work and must not flap
+	static constexpr double switchUpDelay = 0.1;
+	static constexpr double switchDownDelay = 1.0;
+
+	// Seconds a rendition may take to present its first frame before the switch is abandoned
+	static constexpr double prerollTimeout = 2.0;
+
+	// Seconds a rendition is assumed to take to present its first frame, until a preroll measured it
+	static constexpr double prerollLead = 0.25;
+
+	// Rendition height from a file named <stem>.<height>p.<extension>, 0 when the name doesn't match
+	static int parseRenditionHeight(const std::string& fileName, const std::string& stem, const std::string& extension)
+	{
+		if (fileName.size() <= stem.size() + extension.size() + 3 || fileName.compare(0, stem.size() + 1, stem + ".") != 0)
+			return 0;
+		const std::string suffix = "p." + extension;
+		if (fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) != 0)
+			return 0;
+		std::string lines = fileName.substr(stem.size() + 1, fileName.size() - stem.size() - 1 - suffix.size());
+		if (lines.empty() || !std::all_of(lines.begin(), lines.end(), ::isdigit))
+			return 0;
+		return std::atoi(lines.c_str());
+	}
+
+
+	VideoLadder::VideoLadder(VideoService& service, VideoPlayer& player, double keyframeInterval) :
+		mService(service), mPlayer(player), mKeyframeInterval(keyframeInterval), mPrerollLead(prerollLead)
+	{
+		for (const auto& file : mPlayer.mVideoFiles)
+		{
+			std::vector<Rendition> renditions;
+			std::string directory = utility::getFileDir(file->mPath);
+			std::string stem = utility::getFileNameWithoutExtension(file->mPath);
+			std::string extension = utility::getFileExtension(file->mPath);
+
+			std::vector<std::string> files;
+			utility::listDir(directory.c_str(), files, false);
+			for (const auto& name : files)
+			{
+				int height = parseRenditionHeight(name, stem, extension);
+				if (height > 0)
+					renditions.push_back({ height, utility::joinPath({ directory, name }) });
+			}
+			std::sort(renditions.begin(), renditions.end(), [](const Rendition& a, const Rendition& b) { return a.mHeight < b.mHeight; });
+			renditions.push_back({ 0, file->mPath });
+			mRenditions.emplace_back(std::move(renditions));
+		}
+		reset();
+	}
+
+
+	VideoLadder::~VideoLadder()
+	{
+		// Playback continues on the video player of the scene, it can outlive the group on a reload
+		if (mActivePlayer != nullptr && mActivePlayer->isPlaying() && !mPlayer.isPlaying())
+			mPlayer.play(mActivePlayer->getCurrentTime(), mActivePlayer->getSpeed());
+		if (mPrerollPlayer != nullptr)
+			mPrerollPlayer->stop();
+		if (mActivePlayer != nullptr)
+			mActivePlayer->stop();
+	}
+
+
+	int VideoLadder::select(int videoIndex, int height) const
+	{
+		const auto& renditions = mRenditions[videoIndex];
+		for (int i = 0; i < renditions.size() - 1; i++)
+		{
+			if (renditions[i].mHeight >= height)
+				return i;
+		}
+		return static_cast<int>(renditions.size()) - 1;
+	}
+
+
+	bool VideoLadder::update(double deltaTime)
+	{
+		int requested = mRequested;
+		mRequested = 0;
+
+		// Selecting another video, or starting the video player of the scene while a rendition plays, hands playback back to the original
+		int index = mPlayer.getIndex();
+		bool prerolls_original = mPreroll >= 0 && mPrerollPlayer == nullptr;
+		if (index != mIndex || (mActivePlayer != nullptr && mPlayer.isPlaying() && !prerolls_original))
+		{
+			bool changed = mActivePlayer != nullptr;
+			reset();
+			return changed;
+		}
+		if (index < 0 || index >= mRenditions.size() || mRenditions[index].size() < 2)
+			return false;
+
+		if (mPreroll >= 0)
+			return updatePreroll(deltaTime);
+
+		int target = select(index, requested);
+		if (target == mActive)
+		{
+			mPending = -1;
+			return false;
+		}
+		if (target != mPending)
+		{
+			mPending = target;
+			mPendingTime = 0.0;
+			return false;
+		}
+
+		// Wait until the rendition has been required for long enough
+		mPendingTime += deltaTime;
+		double delay = target > mActive ? switchUpDelay : switchDownDelay;
+		if (mPendingTime < delay)
+			return false;
+
+		// A paused video waits
+		if (!getActivePlayer().isPlaying())
+			return false;
+		startPreroll(target);
+		return false;
+	}
+
+
+	bool VideoLadder::updatePreroll(double deltaTime)
+	{
+		VideoPlayer& active = getActivePlayer();
+		VideoPlayer& preroll = mPrerollPlayer != nullptr ? *mPrerollPlayer : mPlayer;
+		double time = active.getCurrentTime();
+
+		// A seek, loop or pause of the active player invalidates the keyframe the preroll waits for
+		double lead = mPrerollLead * active.getSpeed();
+		bool skipped = !mPrerollPlaying && (time > mPrerollStart + deltaTime * active.getSpeed() || time < mPrerollStart - lead - mKeyframeInterval);
+		if (!active.isPlaying() || skipped)
+		{
+			cancelPreroll();
+			return false;
+		}
+
+		// The clock of a player starts at its first decoded frame, start decoding the lead ahead of the keyframe
+		if (!mPrerollPlaying)
+		{
+			if (time < mPrerollStart - lead)
+				return false;
+			preroll.play(mPrerollStart, active.getSpeed());
+			mPrerollPlaying = true;
+			mPrerollTime = 0.0;
+			return false;
+		}
+
+		// The target presented its first frame once its clock moved past the keyframe
+		mPrerollTime += deltaTime;
+		if (preroll.isPlaying() && preroll.getCurrentTime() > mPrerollStart)
+		{
+			// Both clocks run at the same rate from here, a target that trails the active player never catches up.
+			// The next switch decodes a frame more than this one took ahead, a target too far ahead skips that time
+			mPrerollLead = std::min(mPrerollTime + deltaTime, prerollTimeout);
+			if (preroll.getCurrentTime() >= time)
+				return swapToPreroll();
+			nap::Logger::info("%s: rendition %s trailed the playhead, decoding %.2fs ahead from now on", mPlayer.mID.c_str(), mRenditions[mIndex][mPreroll].mPath.c_str(), mPrerollLead);
+			cancelPreroll();
+			return false;
+		}
+		if (mPrerollTime > prerollTimeout)
+		{
+			nap::Logger::warn("%s: rendition %s didn't present a frame within %.1fs", mPlayer.mID.c_str(), mRenditions[mIndex][mPreroll].mPath.c_str(), prerollTimeout);
+			cancelPreroll();
+		}
+		return false;
+	}
+
+
+	void VideoLadder::reset()
+	{
+		// The video player of the scene is left as it is, it was selected or started from outside
+		if (mPrerollPlayer != nullptr)
+			mPrerollPlayer->stop();
+		if (mActivePlayer != nullptr)
+			mActivePlayer->stop();
+		mPrerollPlayer = nullptr;
+		mPrerollFile = nullptr;
+		mActivePlayer = nullptr;
+		mActiveFile = nullptr;
+		mPreroll = -1;
+		mPending = -1;
+		mIndex = mPlayer.getIndex();
+		mActive = mIndex >= 0 && mIndex < mRenditions.size() ? static_cast<int>(mRenditions[mIndex].size()) - 1 : -1;
+	}
+
+
+	void VideoLadder::startPreroll(int rendition)
+	{
+		FOGLIO_TRACE_ZONE_DETAIL("VideoLadder::startPreroll", mPlayer.mID);
+		// The target starts at the first keyframe of the renditions the active player reaches after the lead
+		VideoPlayer& active = getActivePlayer();
+		double time = active.getCurrentTime() + mPrerollLead * active.getSpeed();
+		if (mKeyframeInterval > 0.0)
+			time = std::ceil(time / mKeyframeInterval) * mKeyframeInterval;
+		mPending = -1;
+
+		// The original prerolls on the video player of the scene, every other rendition on a player of its own
+		const Rendition& target = mRenditions[mIndex][rendition];
+		if (target.mHeight > 0)
+		{
+			auto file = std::make_unique<VideoFile>();
+			file->mID = utility::stringFormat("%s_%dp", mPlayer.mID.c_str(), target.mHeight);
+			file->mPath = target.mPath;
+			auto player = std::make_unique<VideoPlayer>(mService);
+			player->mID = file->mID + "_player";
+			player->mVideoFiles.emplace_back(file.get());
+			player->mLoop = mPlayer.mLoop;
+			utility::ErrorState error;
+			if (!file->init(error) || !player->init(error) || !player->start(error))
+			{
+				// A rendition that can't be opened is dropped from the ladder
+				nap::Logger::warn("%s: unable to open rendition %s: %s", mPlayer.mID.c_str(), target.mPath.c_str(), error.toString().c_str());
+				mRenditions[mIndex].erase(mRenditions[mIndex].begin() + rendition);
+				if (mActive > rendition)
+					mActive--;
+				return;
+			}
+			mPrerollFile = std::move(file);
+			mPrerollPlayer = std::move(player);
+		}
+		mPreroll = rendition;
+		mPrerollStart = time;
+		mPrerollPlaying = false;
+		mPrerollTime = 0.0;
+	}
+
+
+	void VideoLadder::cancelPreroll()
+	{
+		if (mPrerollPlayer != nullptr)
+			mPrerollPlayer->stop();
+		else if (mPrerollPlaying)
+			mPlayer.stopPlayback();
+		mPrerollPlayer = nullptr;
+		mPrerollFile = nullptr;
+		mPreroll = -1;
+	}
+
+
+	bool VideoLadder::swapToPreroll()
+	{
+		FOGLIO_TRACE_ZONE_DETAIL("VideoLadder::swapToPreroll", mPlayer.mID);
+
+		// The previous player stops decoding, a rendition player is released with its textures
+		if (mActivePlayer != nullptr)
+			mActivePlayer->stop();
+		else
+			mPlayer.stopPlayback();
+		mActivePlayer = std::move(mPrerollPlayer);
+		mActiveFile = std::move(mPrerollFile);
+		mActive = mPreroll;
+		mPreroll = -1;
+		return true;
+	}
+
+
+	int VideoLadder::getRenditionHeight() const
+	{
+		return mActive >= 0 ? mRenditions[mIndex][mActive].mHeight : 0;
+	}
+
+
+	int VideoLadder::getRenditionCount() const
+	{
+		return mIndex >= 0 && mIndex < mRenditions.size() ? static_cast<int>(mRenditions[mIndex].size()) - 1 : 0;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// External Includes
+#include <videoplayer.h>
+#include <videoservice.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	/**
+	 * Resolution ladder of the videos of a video player.
+	 * Every video file can have lower resolution renditions next to it, named <name>.<height>p.<extension>,
+	 * for example clip.540p.mp4 for clip.mp4. tools/videoladder/make_ladder.sh generates them.
+	 *
+	 * Canvases request the number of video lines they show every frame, the ladder plays the smallest rendition
+	 * that covers the largest request. The original plays on the video player of the scene, every other rendition
+	 * on a player the ladder creates for it, the video files of the scene are never modified.
+	 * A switch opens the target on its own player and prerolls it from the next keyframe of the renditions ahead of
+	 * the playhead, while the active player keeps showing. Decoding starts a lead ahead of that keyframe, the measured
+	 * time a rendition takes to present its first frame. Once the target presented a frame at or ahead of the active
+	 * player the canvases sample the target and the previous player stops decoding. A target that trails the playhead
+	 * is abandoned and the next switch decodes further ahead.
+	 */
+	class NAPAPI VideoLadder
+	{
+	public:
+		/**
+		 * Looks up the renditions of every video file of the player.
+		 * @param service creates the players of the renditions
+		 * @param player the video player of the scene, plays the original
+		 * @param keyframeInterval keyframe interval in seconds the renditions were encoded with, 0 switches immediately
+		 */
+		VideoLadder(VideoService& service, VideoPlayer& player, double keyframeInterval);
+
+		/**
+		 * Stops the rendition players, the video player of the scene continues where the active rendition was.
+		 */
+		~VideoLadder();
+
+		/**
+		 * Requests a minimum number of video lines for this frame, the largest request of a frame wins.
+		 * @param height video lines required
+		 */
+		void request(int height)							{ mRequested = std::max(mRequested, height); }
+
+		/**
+		 * Starts prerolling the rendition that covers the requests of this frame, when it has been required for long enough,
+		 * and swaps to a prerolled rendition once it caught up with the active player. Clears the requests.
+		 * @param deltaTime time in seconds since last update
+		 * @return if the active player changed, the canvases of the player have to sample getActivePlayer()
+		 */
+		bool update(double deltaTime);
+
+		/**
+		 * @return height of the rendition that is playing, 0 for the original
+		 */
+		int getRenditionHeight() const;
+
+		/**
+		 * @return number of renditions of the video that is playing, excluding the original
+		 */
+		int getRenditionCount() const;
+
+		/**
+		 * @return if a rendition is being prerolled
+		 */
+		bool isPrerolling() const							{ return mPreroll >= 0; }
+
+		/**
+		 * @return the video player of the scene
+		 */
+		VideoPlayer& getPlayer()							{ return mPlayer; }
+
+		/**
+		 * Transport controls act on this player: seeking or pausing the video player of the scene has no effect while a rendition plays.
+		 * @return the player the canvases sample, the video player of the scene while the original plays
+		 */
+		VideoPlayer& getActivePlayer()						{ return mActivePlayer != nullptr ? *mActivePlayer : mPlayer; }
+
+	private:
+		struct Rendition
+		{
+			int				mHeight;		///< Video lines, 0 for the original
+			std::string		mPath;
+		};
+
+		VideoService&						mService;
+		VideoPlayer&						mPlayer;
+		double								mKeyframeInterval;
+		std::vector<std::vector<Rendition>>	mRenditions;			///< Per video file, ascending height, the original last
+		int									mIndex = -1;			///< Video of the player the active rendition belongs to
+		int									mActive = -1;			///< Rendition the canvases sample
+		std::unique_ptr<VideoFile>			mActiveFile;			///< File of the active rendition, null while the original plays
+		std::unique_ptr<VideoPlayer>		mActivePlayer;			///< Player of the active rendition, null while the original plays
+		int									mPreroll = -1;			///< Rendition being prerolled
+		std::unique_ptr<VideoFile>			mPrerollFile;			///< File of the prerolled rendition, null when prerolling the original
+		std::unique_ptr<VideoPlayer>		mPrerollPlayer;			///< Player of the prerolled rendition, null when prerolling the original
+		double								mPrerollStart = 0.0;	///< Keyframe time the preroll starts from
+		bool								mPrerollPlaying = false;	///< If the prerolled player is decoding
+		double								mPrerollTime = 0.0;		///< Seconds the preroll has been waiting for its first frame
+		double								mPrerollLead;			///< Seconds a rendition takes to present its first frame
+		int									mRequested = 0;
+		int									mPending = -1;			///< Rendition waiting to be prerolled
+		double								mPendingTime = 0.0;		///< Seconds the pending rendition has been required
+
+		int select(int videoIndex, int height) const;
+		void reset();
+		void startPreroll(int rendition);
+		bool updatePreroll(double deltaTime);
+		void cancelPreroll();
+		bool swapToPreroll();
+	};
+}
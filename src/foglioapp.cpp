@@ -10,9 +10,12 @@
 #include <rendercanvascomponent.h>
 #include <canvasgroupcomponent.h>
 #include <foglioservice.h>
+#include <tracer.h>
 #include <perspcameracomponent.h>
 #include <orthocameracomponent.h>
 #include <imguiutils.h>
+#include <algorithm>
+#include <ctime>
 
 #include <sequenceplayereventoutput.h>
 #include <sequenceevent.h>
@@ -36,6 +39,11 @@ namespace nap
 		mSceneService = getCore().getService<nap::SceneService>();
 		mInputService = getCore().getService<nap::InputService>();
 		mGuiService = getCore().getService<nap::IMGuiService>();
+		mFoglioService = getCore().getService<nap::FoglioService>();
+
+		// Everything up to here is spent loading the scene
+		StartupTimeline& timeline = mFoglioService->getStartupTimeline();
+		timeline.record("scene", "resources", 0.0, timeline.now());
 
 		// Fetch the resource manager
 		mResourceManager = getCore().getResourceManager();
@@ -50,6 +58,17 @@ namespace nap
 		if (!error.check(mControlsWindow != nullptr, "unable to find render window with name: %s", "ControlsWindow"))
 			return false;
 		mCanvasSequenceEditorGUI = mResourceManager->findObject<nap::SequenceEditorGUI>("CanvasSequenceEditorGUI");
+		mOutputRecorder = mResourceManager->findObject<nap::OutputRecorder>("OutputRecorder");
+		mOutputPublisher = mResourceManager->findObject<nap::SharedFramePublisher>("MainOutputPublisher");
+		if (mOutputPublisher != nullptr && !mOutputPublisher->isEnabled())
+			mOutputPublisher = nullptr;
+		mMetricsExporter = mResourceManager->findObject<nap::MetricsExporter>("MetricsExporter");
+		if (mOutputPublisher != nullptr)
+		{
+			mOutputPublisherTarget = mResourceManager->findObject<nap::RenderTarget>("MainOutputPublisherTarget");
+			if (!error.check(mOutputPublisherTarget != nullptr, "unable to find render target with name: %s", "MainOutputPublisherTarget"))
+				return false;
+		}
 		// Get the scene that contains our entities and components
 		mScene = mResourceManager->findObject<Scene>("Scene");
 		if (!error.check(mScene != nullptr, "unable to find scene with name: %s", "Scene"))
@@ -75,10 +94,17 @@ namespace nap
 	// Called when the window is updating
 	void foglioApp::update(double deltaTime)
 	{
+		FOGLIO_TRACE_ZONE("foglioApp::update");
 		// Use a default input router to forward input events (recursively) to all input components in the default scene
 		nap::DefaultInputRouter input_router(true);
 		//mInputService->processWindowEvents(*mMainWindow, input_router, { &mScene->getRootEntity() });
 		mInputService->processWindowEvents(*mControlsWindow, input_router, { &mScene->getRootEntity() });
+
+		// Canvases outside of the outputs are still part of the recorded and published composition
+		mVideoWallEntity->getComponent<CanvasGroupComponentInstance>().mDrawComposition =
+			(mOutputPublisher != nullptr && mOutputPublisher->isEnabled()) || (mOutputRecorder != nullptr && mOutputRecorder->isRecording());
+		if (mMetricsExporter != nullptr)
+			mMetricsExporter->update(getCore().getElapsedTime());
 		updateGUI();
 	}
 	
@@ -86,18 +112,18 @@ namespace nap
 	// Called when the window is going to render
 	void foglioApp::render()
 	{
+		FOGLIO_TRACE_ZONE("foglioApp::render");
 		// Signal the beginning of a new frame, allowing it to be recorded.
 		// The system might wait until all commands that were previously associated with the new frame have been processed on the GPU.
 		// Multiple frames are in flight at the same time, but if the graphics load is heavy the system might wait here to ensure resources are available.
-		mRenderService->beginFrame();
+		{
+			FOGLIO_TRACE_ZONE("RenderService::beginFrame");
+			mRenderService->beginFrame();
+		}
 
 		// Find the orthographic camera component
 		nap::OrthoCameraComponentInstance& ortho_cam = mOrthoCameraEntity->getComponent<OrthoCameraComponentInstance>();
-		//get canvases once again for the render service
-		std::vector<nap::RenderableComponentInstance*> canvas_components_to_render;
-		for (nap::EntityInstance* canvasEntity : mVideoWallEntity->getChildren()) {
-			canvas_components_to_render.emplace_back(&canvasEntity->getComponent<RenderableComponentInstance>());
-		};
+		CanvasRegistry& canvas_registry = mFoglioService->getCanvasRegistry();
 
 		CanvasGroupComponentInstance* canvasGroupComponent = &mVideoWallEntity->getComponent<CanvasGroupComponentInstance>();
 		// Start recording into the headless recording buffer.
@@ -105,41 +131,61 @@ namespace nap
 		{
 			canvasGroupComponent->drawAllHeadless();
 			canvasGroupComponent->drawSelectedInterface();
+
+			// Render the main output composition, without GUI, for recording and publishing
+			if (mOutputRecorder != nullptr && mOutputRecorder->isRecording())
+			{
+				renderComposition(mOutputRecorder->getTarget());
+				mOutputRecorder->capture();
+			}
+			if (mOutputPublisher != nullptr && mOutputPublisher->isEnabled())
+			{
+				renderComposition(*mOutputPublisherTarget);
+				mOutputPublisher->publish(mOutputPublisherTarget->getColorTexture());
+			}
 			// Tell the render service we are done rendering into render-targets.
 			// The queue is submitted and executed.
 			mRenderService->endHeadlessRecording();
 		}
 
-		canvasGroupComponent->getSelected()->getComponent<RenderCanvasComponentInstance>().setFinalSampler(false);
-		for (auto canvasEntity : mVideoWallEntity->getChildren()) {
-			canvasEntity->getComponent<RenderCanvasComponentInstance>().mIsControlViewDraw = false;
-		}
-		if (mRenderService->beginRecording(*mMainWindow)) {
+		// Render every output window, each output only draws the canvases culled for it
+		groupOutputWindows(*canvasGroupComponent);
+		for (const auto& output_window : mOutputWindows)
+		{
+			RenderWindow& window = *output_window.first;
+			if (!mRenderService->beginRecording(window))
+				continue;
+
 			// Begin render pass
-			mMainWindow->beginRendering();
+			window.beginRendering();
+			for (int output : output_window.second)
+				canvasGroupComponent->drawOutput(output, ortho_cam);
 
-			mRenderService->renderObjects(*mMainWindow, ortho_cam, canvas_components_to_render);
-			
+			// Restore the full viewport for the GUI
+			VkViewport viewport = { 0.0f, 0.0f, static_cast<float>(window.getBufferSize().x), static_cast<float>(window.getBufferSize().y), 0.0f, 1.0f };
+			VkRect2D scissor = { { 0, 0 }, { static_cast<uint32_t>(window.getBufferSize().x), static_cast<uint32_t>(window.getBufferSize().y) } };
+			vkCmdSetViewport(mRenderService->getCurrentCommandBuffer(), 0, 1, &viewport);
+			vkCmdSetScissor(mRenderService->getCurrentCommandBuffer(), 0, 1, &scissor);
 			mGuiService->draw();
 
 			// End render pass
-			mMainWindow->endRendering();
+			window.endRendering();
 
 			// End recording
 			mRenderService->endRecording();
 		}
 		
-		for (auto canvasEntity : mVideoWallEntity->getChildren()) {
-			canvasEntity->getComponent<RenderCanvasComponentInstance>().mIsControlViewDraw = true;
-		}
-		canvasGroupComponent->getSelected()->getComponent<RenderCanvasComponentInstance>().setFinalSampler(true);
+		for (RenderCanvasComponentInstance* canvas : canvas_registry.getCanvases())
+			canvas->mIsControlViewDraw = true;
+		if (canvasGroupComponent->getSelectedCanvas() != nullptr)
+			canvasGroupComponent->getSelectedCanvas()->setFinalSampler(true);
 
 		if (mRenderService->beginRecording(*mControlsWindow)) {
 			// Begin render pass
 			mControlsWindow->beginRendering();
 			// render canvases
 			if (canvasGroupComponent->mDrawBackdrop) {
-				mRenderService->renderObjects(*mControlsWindow, ortho_cam, canvas_components_to_render);
+				mRenderService->renderObjects(*mControlsWindow, ortho_cam, canvas_registry.getRenderables());
 			}
 			// Render GUI elements
 			mGuiService->draw();
@@ -151,13 +197,48 @@ namespace nap
 			mRenderService->endRecording();
 		}
 		// Proceed to next frame
-		mRenderService->endFrame();
+		{
+			FOGLIO_TRACE_ZONE("RenderService::endFrame");
+			mRenderService->endFrame();
+		}
+		mFoglioService->getMetrics().markPresent(getCore().getElapsedTime(), mFoglioService->getFrameTime().mFrame);
 
+		if (mFoglioService->getStartupTimeline().markFirstFrame())
+			nap::Logger::info(mFoglioService->getStartupTimeline().toString());
 
 
 	}
 	
 
+	void foglioApp::groupOutputWindows(const CanvasGroupComponentInstance& canvasGroup)
+	{
+		// Grouped every frame, a reload replaces the group, its outputs and possibly their windows
+		for (auto& output_window : mOutputWindows)
+			output_window.second.clear();
+		const std::vector<ResourcePtr<CanvasOutput>>& outputs = canvasGroup.getOutputs();
+		for (int i = 0; i < outputs.size(); i++)
+		{
+			RenderWindow* window = outputs[i]->mWindow.get();
+			auto it = std::find_if(mOutputWindows.begin(), mOutputWindows.end(), [window](const auto& entry) { return entry.first == window; });
+			if (it == mOutputWindows.end())
+				it = mOutputWindows.emplace(mOutputWindows.end(), window, std::vector<int>());
+			it->second.emplace_back(i);
+		}
+
+		// Windows no output draws into anymore are dropped, they may no longer exist
+		mOutputWindows.erase(std::remove_if(mOutputWindows.begin(), mOutputWindows.end(), [](const auto& entry) { return entry.second.empty(); }), mOutputWindows.end());
+	}
+
+
+	void foglioApp::renderComposition(IRenderTarget& target)
+	{
+		nap::OrthoCameraComponentInstance& ortho_cam = mOrthoCameraEntity->getComponent<OrthoCameraComponentInstance>();
+		target.beginRendering();
+		mVideoWallEntity->getComponent<CanvasGroupComponentInstance>().drawComposition(target, ortho_cam);
+		target.endRendering();
+	}
+
+
 	void foglioApp::windowMessageReceived(WindowEventPtr windowEvent)
 	{
 		mRenderService->addEvent(std::move(windowEvent));
@@ -191,6 +272,14 @@ namespace nap
 				}
 			}
 
+			// t is pressed, write the CPU trace for chrome://tracing or Perfetto
+			if (press_event->mKey == nap::EKeyCode::KEY_t && press_event->mWindow == mControlsWindow->getNumber())
+				writeTrace();
+
+			// r is pressed, toggle recording of the main output
+			if (press_event->mKey == nap::EKeyCode::KEY_r && press_event->mWindow == mControlsWindow->getNumber())
+				toggleRecording();
+
 			if (press_event->mKey == nap::EKeyCode::KEY_l && press_event->mWindow == mControlsWindow->getNumber()) {
 				ResourcePtr<VideoPlayer> player = mScene->findEntity("BigCircleEntity")->findComponent<RenderCanvasComponentInstance>()->getVideoPlayer();
 				nap::utility::ErrorState error;
@@ -208,9 +297,39 @@ namespace nap
 	
 	int foglioApp::shutdown()
 	{
+		if (mOutputRecorder != nullptr)
+			mOutputRecorder->stop();
 		return 0;
 	}
 
+
+	void foglioApp::writeTrace()
+	{
+		std::string path = utility::stringFormat("foglio_trace_%lld.json", static_cast<long long>(std::time(nullptr)));
+		utility::ErrorState error;
+		if (!Tracer::get().writeChromeTrace(path, error))
+		{
+			nap::Logger::error("unable to write trace: %s", error.toString().c_str());
+			return;
+		}
+		nap::Logger::info("trace written to %s", path.c_str());
+	}
+
+
+	void foglioApp::toggleRecording()
+	{
+		if (mOutputRecorder == nullptr)
+			return;
+		if (mOutputRecorder->isRecording())
+		{
+			mOutputRecorder->stop();
+			return;
+		}
+		utility::ErrorState error;
+		if (!mOutputRecorder->start(mVideoWallEntity->getComponent<CanvasGroupComponentInstance>().getVirtualSize(), error))
+			nap::Logger::error("unable to start recording: %s", error.toString().c_str());
+	}
+
 	// Draw some GUI elements
 	void foglioApp::updateGUI()
 	{
@@ -227,6 +346,25 @@ namespace nap
 		ImGui::Begin("Controls");
 		ImGui::Text(getCurrentDateTime().toString().c_str());
 		ImGui::Text(utility::stringFormat("Framerate: %.02f", getCore().getFramerate()).c_str());
+		if (ImGui::CollapsingHeader("Frame Metrics", ImGuiTreeNodeFlags_None))
+			drawFrameMetrics();
+		if (ImGui::CollapsingHeader("Startup", ImGuiTreeNodeFlags_None))
+		{
+			const StartupTimeline& timeline = mFoglioService->getStartupTimeline();
+			if (timeline.hasFirstFrame())
+			{
+				ImGui::Text("Time to first frame: %.3fs", timeline.getTimeToFirstFrame());
+				for (const auto& entry : timeline.getEntries())
+					ImGui::Text("%8.3fs %8.2fms %s: %s", entry.mStart, entry.mDuration * 1000.0, entry.mCategory.c_str(), entry.mName.c_str());
+			}
+		}
+		if (mOutputRecorder != nullptr && ImGui::CollapsingHeader("Recording", ImGuiTreeNodeFlags_None))
+		{
+			if (ImGui::Button(mOutputRecorder->isRecording() ? "Stop Recording" : "Start Recording"))
+				toggleRecording();
+			ImGui::Text("Captured: %d, written: %d, dropped: %d", mOutputRecorder->getCapturedFrames(),
+				mOutputRecorder->getWrittenFrames(), mOutputRecorder->getDroppedFrames());
+		}
 		if (mVideoWallEntity->hasComponent<CanvasGroupComponentInstance>()) {
 			mVideoWallEntity->getComponent<CanvasGroupComponentInstance>().drawOutliner();
 		}
@@ -238,4 +376,27 @@ namespace nap
 
 		mVideoWallEntity->getComponent<CanvasGroupComponentInstance>().drawSequenceEditor();
 	}
+
+
+	void foglioApp::drawFrameMetrics()
+	{
+		const Metrics& metrics = mFoglioService->getMetrics();
+		const MetricHistogram& frame_time = metrics.getFrameTime();
+		const MetricHistogram& present_interval = metrics.getPresentInterval();
+		ImGui::Text("Frame time (last %ds): p50 %.2fms, p95 %.2fms, p99 %.2fms", Metrics::window,
+			frame_time.getRollingPercentile(0.5) * 1000.0, frame_time.getRollingPercentile(0.95) * 1000.0, frame_time.getRollingPercentile(0.99) * 1000.0);
+		ImGui::Text("Present interval (last %ds): p50 %.2fms, p95 %.2fms, p99 %.2fms", Metrics::window,
+			present_interval.getRollingPercentile(0.5) * 1000.0, present_interval.getRollingPercentile(0.95) * 1000.0, present_interval.getRollingPercentile(0.99) * 1000.0);
+		ImGui::Text("Missed vsync: %llu", static_cast<unsigned long long>(metrics.getMissedVsyncs()));
+
+		// Spikes stand out against the median, the scale is fixed to 4 times the median interval
+		const std::vector<float>& intervals = metrics.getIntervals();
+		float scale_max = static_cast<float>(std::max(present_interval.getRollingPercentile(0.5) * 4.0, 0.001));
+		ImGui::PlotLines("##intervals", intervals.data(), static_cast<int>(intervals.size()), metrics.getIntervalOffset(),
+			"Present interval", 0.0f, scale_max, ImVec2(ImGui::GetContentRegionAvailWidth(), 80.0f));
+		for (auto it = metrics.getSpikes().rbegin(); it != metrics.getSpikes().rend(); ++it)
+			ImGui::Text("%10.3fs frame %-8d %.2fms", it->mTime, it->mFrame, it->mInterval * 1000.0);
+		if (mMetricsExporter != nullptr)
+			ImGui::Text("Exported every %.0fs to %s", mMetricsExporter->mInterval, mMetricsExporter->mPath.c_str());
+	}
 }
@@ -20,11 +20,18 @@
 #include <entity.h>
 #include <videoplayer.h>
 #include <app.h>
+#include <foglioservice.h>
+#include <outputrecorder.h>
+#include <metricsexporter.h>
+#include <sharedframepublisher.h>
 
 namespace nap
 {
 	using namespace rtti;
 
+	// Forward declares
+	class CanvasGroupComponentInstance;
+
 	/**
 	 * Main application that is called from within the main loop
 	 */
@@ -81,11 +88,17 @@ namespace nap
 		SceneService*				mSceneService = nullptr;		///< Manages all the objects in the scene
 		InputService*				mInputService = nullptr;		///< Input service for processing input
 		IMGuiService*				mGuiService = nullptr;			///< Manages GUI related update / draw calls
+		FoglioService*				mFoglioService = nullptr;		///< Startup timeline and stock canvas resources
 		ObjectPtr<RenderWindow>		mMainWindow = nullptr;					///< Pointer to the main render window
 		ObjectPtr<RenderWindow>		mControlsWindow = nullptr;					///< Pointer to the controls window	
 		ObjectPtr<Scene>			mScene = nullptr;				///< Pointer to the main scene
 
 		ObjectPtr<SequenceEditorGUI>mCanvasSequenceEditorGUI = nullptr;
+		ObjectPtr<OutputRecorder>	mOutputRecorder = nullptr;		///< Records the main output, optional
+		ObjectPtr<SharedFramePublisher>	mOutputPublisher = nullptr;	///< Publishes the main output to shared memory, optional
+		ObjectPtr<MetricsExporter>	mMetricsExporter = nullptr;		///< Writes the metrics for the node_exporter textfile collector, optional
+		ObjectPtr<RenderTarget>		mOutputPublisherTarget = nullptr;	///< Main output composition that is published
+		std::vector<std::pair<RenderWindow*, std::vector<int>>> mOutputWindows;	///< Output windows and the outputs drawn in each, grouped every frame
 
 		ObjectPtr<EntityInstance>	mCameraEntity = nullptr;		///< Pointer to the entity that holds the perspective camera
 		ObjectPtr<EntityInstance>	mOrthoCameraEntity = nullptr;
@@ -97,5 +110,32 @@ namespace nap
 		 * Sets up the GUI every frame
 		 */
 		void updateGUI();
+
+		/**
+		 * Starts or stops recording the main output
+		 */
+		void toggleRecording();
+
+		/**
+		 * Writes the CPU trace zones of all threads as Chrome trace JSON to the working directory
+		 */
+		void writeTrace();
+
+		/**
+		 * Shows the rolling frame time percentiles, the present interval timeline and the latest spikes
+		 */
+		void drawFrameMetrics();
+
+		/**
+		 * Groups the outputs of the canvas group by window, outputs that share a window are drawn in a single render pass
+		 * @param canvasGroup the canvas group that owns the outputs
+		 */
+		void groupOutputWindows(const CanvasGroupComponentInstance& canvasGroup);
+
+		/**
+		 * Renders the composition of the entire virtual canvas space, without GUI, into a headless target
+		 * @param target the target to render into
+		 */
+		void renderComposition(IRenderTarget& target);
 	};
 }
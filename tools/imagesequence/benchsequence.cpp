@@ -0,0 +1,218 @@
+// Measures the CPU cost of playing a foglio image sequence on several streams at once, see module/src/imagesequenceformat.h.
+// Every stream maps the file and does the per frame work of ImageSequence at the frame rate of the sequence:
+// decompress (LZ4 sequences) and copy into a staging sized buffer. Reports the cores used, process CPU time over wall time,
+// and the frame rate every stream reached. With a video, the same is measured for ffmpeg decoding it in real time,
+// one process per stream: the libavcodec software decode that VideoPlayer runs, without its YUV upload.
+//
+// Build: c++ -std=c++17 -O2 -I../../module/src benchsequence.cpp -o benchsequence -lpthread
+// Usage: benchsequence <sequence> [max streams] [seconds] [video]
+
+#include <imagesequenceformat.h>
+#include <lz4block.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace nap;
+
+struct Sequence
+{
+	const uint8_t*							mMapped = nullptr;
+	size_t									mSize = 0;
+	imagesequence::Header					mHeader = {};
+	std::vector<imagesequence::FrameEntry>	mEntries;
+};
+
+
+static bool openSequence(const char* path, Sequence& sequence)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(imagesequence::Header))
+	{
+		close(fd);
+		return false;
+	}
+	sequence.mSize = static_cast<size_t>(info.st_size);
+	void* data = mmap(nullptr, sequence.mSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+	sequence.mMapped = static_cast<const uint8_t*>(data);
+	std::memcpy(&sequence.mHeader, sequence.mMapped, sizeof(imagesequence::Header));
+	const imagesequence::Header& header = sequence.mHeader;
+	if (header.mMagic != imagesequence::magic || header.mFrameCount == 0 || header.mFrameRate <= 0.0f)
+		return false;
+	if (header.mCompression != imagesequence::ECompression::None)
+	{
+		sequence.mEntries.resize(header.mFrameCount);
+		std::memcpy(sequence.mEntries.data(), sequence.mMapped + sizeof(imagesequence::Header), sizeof(imagesequence::FrameEntry) * header.mFrameCount);
+		for (const auto& entry : sequence.mEntries)
+		{
+			if (entry.mOffset + entry.mSize > sequence.mSize)
+				return false;
+		}
+	}
+	return header.mCompression != imagesequence::ECompression::None ||
+		header.mDataOffset + header.mFrameStride * (header.mFrameCount - 1) + header.mFrameSize <= sequence.mSize;
+}
+
+
+static double getCpuTime(int who)
+{
+	struct rusage usage;
+	getrusage(who, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+
+// Plays the sequence until stopped, frames that can't be prepared in time are skipped like the playhead skips them
+static void playStream(const Sequence& sequence, const std::atomic<bool>& stop, std::atomic<int>& frames)
+{
+	const imagesequence::Header& header = sequence.mHeader;
+	std::vector<uint8_t> decoded(header.mFrameSize);
+	std::vector<uint8_t> staging(header.mFrameSize);
+	auto interval = std::chrono::duration<double>(1.0 / header.mFrameRate);
+	auto start = std::chrono::steady_clock::now();
+	int64_t tick = 0;
+	while (!stop.load(std::memory_order_relaxed))
+	{
+		int frame = static_cast<int>(tick % header.mFrameCount);
+		const uint8_t* data = nullptr;
+		if (header.mCompression != imagesequence::ECompression::None)
+		{
+			const imagesequence::FrameEntry& entry = sequence.mEntries[frame];
+			if (lz4::decompress(sequence.mMapped + entry.mOffset, entry.mSize, decoded.data(), decoded.size()))
+				data = decoded.data();
+		}
+		else
+		{
+			data = sequence.mMapped + header.mDataOffset + header.mFrameStride * frame;
+		}
+		if (data != nullptr)
+			std::memcpy(staging.data(), data, staging.size());
+		frames.fetch_add(1, std::memory_order_relaxed);
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		tick = std::max(tick + 1, static_cast<int64_t>(std::chrono::duration<double>(elapsed) / interval));
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * static_cast<double>(tick)));
+	}
+}
+
+
+static void benchSequence(const Sequence& sequence, int streams, double seconds, double& outCores, double& outFps)
+{
+	std::atomic<bool> stop = { false };
+	std::atomic<int> frames = { 0 };
+	double cpu_start = getCpuTime(RUSAGE_SELF);
+	auto wall_start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 0; i < streams; i++)
+		threads.emplace_back(playStream, std::cref(sequence), std::cref(stop), std::ref(frames));
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+	stop = true;
+	for (auto& thread : threads)
+		thread.join();
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	outCores = (getCpuTime(RUSAGE_SELF) - cpu_start) / wall;
+	outFps = frames.load() / wall / streams;
+}
+
+
+// Decodes the video in real time in a process per stream, the CPU time of the children is collected when they exit
+static bool benchVideo(const char* video, int streams, double seconds, double& outCores)
+{
+	std::string duration = std::to_string(seconds);
+	double cpu_start = getCpuTime(RUSAGE_CHILDREN);
+	auto wall_start = std::chrono::steady_clock::now();
+	std::vector<pid_t> children;
+	for (int i = 0; i < streams; i++)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			execlp("ffmpeg", "ffmpeg", "-loglevel", "error", "-re", "-stream_loop", "-1", "-i", video, "-t", duration.c_str(), "-f", "null", "-", static_cast<char*>(nullptr));
+			_exit(127);
+		}
+		if (pid < 0)
+			break;
+		children.push_back(pid);
+	}
+
+	bool succeeded = children.size() == static_cast<size_t>(streams);
+	for (pid_t child : children)
+	{
+		int status = 0;
+		waitpid(child, &status, 0);
+		succeeded &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	outCores = (getCpuTime(RUSAGE_CHILDREN) - cpu_start) / wall;
+	return succeeded;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <sequence> [max streams] [seconds] [video]\n", argv[0]);
+		return 1;
+	}
+	int max_streams = argc > 2 ? std::atoi(argv[2]) : 8;
+	double seconds = argc > 3 ? std::atof(argv[3]) : 5.0;
+	const char* video = argc > 4 ? argv[4] : nullptr;
+
+	Sequence sequence;
+	if (!openSequence(argv[1], sequence))
+	{
+		std::fprintf(stderr, "unable to open image sequence: %s\n", argv[1]);
+		return 1;
+	}
+
+	static const char* format_names[] = { "rgba", "yuv420p", "bc1", "bc3" };
+	const imagesequence::Header& header = sequence.mHeader;
+	std::printf("%s: %ux%u %s%s, %u frames at %.2f fps, %.2fMB per frame, %u cores\n", argv[1], header.mWidth, header.mHeight,
+		format_names[std::min<uint32_t>(static_cast<uint32_t>(header.mFormat), 3)], header.mCompression != imagesequence::ECompression::None ? " lz4" : "",
+		header.mFrameCount, header.mFrameRate, static_cast<double>(header.mFrameSize) / (1024.0 * 1024.0), std::thread::hardware_concurrency());
+
+	// Reading the mapping once up front keeps the first run from measuring the disk
+	volatile uint8_t sink = 0;
+	for (size_t offset = 0; offset < sequence.mSize; offset += 4096)
+		sink = sink + sequence.mMapped[offset];
+
+	std::printf("%8s %16s %16s%s\n", "streams", "sequence cores", "fps per stream", video != nullptr ? "      video cores" : "");
+	for (int streams = 1; streams <= max_streams; streams++)
+	{
+		double cores, fps;
+		benchSequence(sequence, streams, seconds, cores, fps);
+		std::printf("%8d %16.3f %16.2f", streams, cores, fps);
+		if (video != nullptr)
+		{
+			double video_cores;
+			if (benchVideo(video, streams, seconds, video_cores))
+				std::printf(" %16.3f", video_cores);
+			else
+				std::printf(" %16s", "failed");
+		}
+		std::printf("\n");
+		std::fflush(stdout);
+	}
+	munmap(const_cast<uint8_t*>(sequence.mMapped), sequence.mSize);
+	return 0;
+}
@@ -0,0 +1,318 @@
+// Packs raw video frames into a foglio image sequence, see module/src/imagesequenceformat.h.
+// Frames are read from stdin as tightly packed rgba or yuv420p, as written by ffmpeg's rawvideo muxer.
+// bc1 and bc3 encode rgba input into texture blocks with a fast range fit, lz4 compresses every frame.
+//
+// Build: c++ -std=c++17 -O2 -I../../module/src packsequence.cpp -o packsequence
+// Usage: ffmpeg -i <video> -f rawvideo -pix_fmt rgba - | packsequence <output> <width> <height> <rgba|yuv420p|bc1|bc3> <fps> [lz4]
+
+#include <imagesequenceformat.h>
+#include <lz4block.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace nap;
+
+static uint16_t pack565(const int* color)
+{
+	return static_cast<uint16_t>(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+
+static void unpack565(uint16_t color, int* out)
+{
+	out[0] = (color >> 11) * 255 / 31;
+	out[1] = ((color >> 5) & 63) * 255 / 63;
+	out[2] = (color & 31) * 255 / 31;
+}
+
+
+// Color block of 16 rgba texels, end points on the diagonal of the bounding box that follows the correlation of the channels.
+// BC1 blocks with transparent texels use three colors and black, BC3 color blocks always use four colors.
+static void encodeColorBlock(const uint8_t* texels, bool punchThrough, uint8_t* out)
+{
+	int low[3] = { 255, 255, 255 };
+	int high[3] = { 0, 0, 0 };
+	int mean[3] = { 0, 0, 0 };
+	bool transparent = false;
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			low[c] = std::min<int>(low[c], texels[i * 4 + c]);
+			high[c] = std::max<int>(high[c], texels[i * 4 + c]);
+			mean[c] += texels[i * 4 + c];
+		}
+		transparent |= punchThrough && texels[i * 4 + 3] < 128;
+	}
+
+	// Flip red and blue along the diagonal when they fall while green rises
+	int covariance[2] = { 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		int green = texels[i * 4 + 1] * 16 - mean[1];
+		covariance[0] += (texels[i * 4] * 16 - mean[0]) * green;
+		covariance[1] += (texels[i * 4 + 2] * 16 - mean[2]) * green;
+	}
+	if (covariance[0] < 0)
+		std::swap(low[0], high[0]);
+	if (covariance[1] < 0)
+		std::swap(low[2], high[2]);
+
+	uint16_t color0 = pack565(high);
+	uint16_t color1 = pack565(low);
+	if (transparent ? color0 > color1 : color0 < color1)
+		std::swap(color0, color1);
+
+	int palette[4][3];
+	unpack565(color0, palette[0]);
+	unpack565(color1, palette[1]);
+	int colors = transparent ? 3 : 4;
+	for (int c = 0; c < 3; c++)
+	{
+		if (transparent)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+		}
+		else
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	uint32_t indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		const uint8_t* texel = texels + i * 4;
+		int best = 0;
+		if (transparent && texel[3] < 128)
+		{
+			best = 3;
+		}
+		else
+		{
+			int best_distance = 0x7fffffff;
+			for (int p = 0; p < colors && color0 != color1; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+					distance += (texel[c] - palette[p][c]) * (texel[c] - palette[p][c]);
+				if (distance < best_distance)
+				{
+					best_distance = distance;
+					best = p;
+				}
+			}
+		}
+		indices |= static_cast<uint32_t>(best) << (2 * i);
+	}
+
+	out[0] = static_cast<uint8_t>(color0 & 0xff);
+	out[1] = static_cast<uint8_t>(color0 >> 8);
+	out[2] = static_cast<uint8_t>(color1 & 0xff);
+	out[3] = static_cast<uint8_t>(color1 >> 8);
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+
+// BC3 alpha block, eight alphas between the extremes
+static void encodeAlphaBlock(const uint8_t* texels, uint8_t* out)
+{
+	int high = 0;
+	int low = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		high = std::max<int>(high, texels[i * 4 + 3]);
+		low = std::min<int>(low, texels[i * 4 + 3]);
+	}
+
+	uint64_t indices = 0;
+	if (high > low)
+	{
+		int palette[8] = { high, low };
+		for (int p = 2; p < 8; p++)
+			palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+		for (int i = 0; i < 16; i++)
+		{
+			int alpha = texels[i * 4 + 3];
+			int best = 0;
+			for (int p = 1; p < 8; p++)
+			{
+				if (std::abs(alpha - palette[p]) < std::abs(alpha - palette[best]))
+					best = p;
+			}
+			indices |= static_cast<uint64_t>(best) << (3 * i);
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(high);
+	out[1] = static_cast<uint8_t>(low);
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+
+// Encodes a frame into rows of blocks, texels past the edge repeat the last row and column
+static void encodeBlocks(const uint8_t* rgba, int width, int height, imagesequence::EFormat format, uint8_t* out)
+{
+	uint8_t texels[64];
+	int blocks_x = static_cast<int>(imagesequence::getBlockCount(width));
+	int blocks_y = static_cast<int>(imagesequence::getBlockCount(height));
+	for (int by = 0; by < blocks_y; by++)
+	{
+		for (int bx = 0; bx < blocks_x; bx++)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int x = std::min(bx * 4 + i % 4, width - 1);
+				int y = std::min(by * 4 + i / 4, height - 1);
+				std::memcpy(texels + i * 4, rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+			}
+			if (format == imagesequence::EFormat::BC1)
+			{
+				encodeColorBlock(texels, true, out);
+				out += 8;
+			}
+			else
+			{
+				encodeAlphaBlock(texels, out);
+				encodeColorBlock(texels, false, out + 8);
+				out += 16;
+			}
+		}
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc != 6 && !(argc == 7 && std::string(argv[6]) == "lz4"))
+	{
+		std::fprintf(stderr, "usage: %s <output> <width> <height> <rgba|yuv420p|bc1|bc3> <fps> [lz4]\n", argv[0]);
+		return 1;
+	}
+
+	std::string format_name = argv[4];
+	imagesequence::EFormat format;
+	if (format_name == "rgba")
+		format = imagesequence::EFormat::RGBA8;
+	else if (format_name == "yuv420p")
+		format = imagesequence::EFormat::YUV420;
+	else if (format_name == "bc1")
+		format = imagesequence::EFormat::BC1;
+	else if (format_name == "bc3")
+		format = imagesequence::EFormat::BC3;
+	else
+	{
+		std::fprintf(stderr, "unsupported pixel format: %s\n", format_name.c_str());
+		return 1;
+	}
+	bool compress = argc == 7;
+	int width = std::atoi(argv[2]);
+	int height = std::atoi(argv[3]);
+	float frame_rate = static_cast<float>(std::atof(argv[5]));
+	if (width <= 0 || height <= 0 || frame_rate <= 0.0f)
+	{
+		std::fprintf(stderr, "invalid size or frame rate\n");
+		return 1;
+	}
+
+	FILE* output = std::fopen(argv[1], "wb");
+	if (output == nullptr)
+	{
+		std::fprintf(stderr, "unable to open %s\n", argv[1]);
+		return 1;
+	}
+
+	// The frame count is unknown until stdin ends. The header is written again afterwards,
+	// compressed frames are collected in a temporary file until the size of the index is known.
+	imagesequence::ECompression compression = compress ? imagesequence::ECompression::LZ4 : imagesequence::ECompression::None;
+	imagesequence::Header header = imagesequence::createHeader(format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 0, frame_rate, compression);
+	FILE* frames = compress ? std::tmpfile() : output;
+	if (frames == nullptr)
+	{
+		std::fprintf(stderr, "unable to create temporary file\n");
+		std::fclose(output);
+		return 1;
+	}
+	if (!compress)
+	{
+		std::fwrite(&header, sizeof(header), 1, output);
+		std::vector<uint8_t> padding(header.mDataOffset - sizeof(header), 0);
+		std::fwrite(padding.data(), 1, padding.size(), output);
+	}
+
+	// Every frame is padded to the alignment, so each one starts on its own page
+	uint64_t input_size = imagesequence::isBlockCompressed(format) ? static_cast<uint64_t>(width) * height * 4 : header.mFrameSize;
+	std::vector<uint8_t> input(input_size);
+	std::vector<uint8_t> frame(imagesequence::align(header.mFrameSize, imagesequence::alignment), 0);
+	std::vector<uint8_t> compressed(imagesequence::align(lz4::getMaxCompressedSize(header.mFrameSize), imagesequence::alignment), 0);
+	std::vector<imagesequence::FrameEntry> entries;
+	uint64_t stored_size = 0;
+	while (std::fread(input.data(), 1, input.size(), stdin) == input.size())
+	{
+		if (imagesequence::isBlockCompressed(format))
+			encodeBlocks(input.data(), width, height, format, frame.data());
+		else
+			std::memcpy(frame.data(), input.data(), input.size());
+
+		const std::vector<uint8_t>* data = &frame;
+		size_t size = frame.size();
+		if (compress)
+		{
+			size_t compressed_size = lz4::compress(frame.data(), header.mFrameSize, compressed.data());
+			entries.push_back({ stored_size, compressed_size });
+			std::fill(compressed.begin() + compressed_size, compressed.end(), 0);
+			data = &compressed;
+			size = imagesequence::align(compressed_size, imagesequence::alignment);
+		}
+		if (std::fwrite(data->data(), 1, size, frames) != size)
+		{
+			std::fprintf(stderr, "unable to write frame %u\n", header.mFrameCount);
+			std::fclose(output);
+			return 1;
+		}
+		stored_size += size;
+		header.mFrameCount++;
+	}
+
+	if (compress)
+	{
+		// The data offset grows with the index, the offsets of the entries are relative to the file
+		header = imagesequence::createHeader(format, static_cast<uint32_t>(width), static_cast<uint32_t>(height), header.mFrameCount, frame_rate, compression);
+		for (auto& entry : entries)
+			entry.mOffset += header.mDataOffset;
+		std::fwrite(&header, sizeof(header), 1, output);
+		std::fwrite(entries.data(), sizeof(imagesequence::FrameEntry), entries.size(), output);
+		std::vector<uint8_t> padding(header.mDataOffset - sizeof(header) - sizeof(imagesequence::FrameEntry) * entries.size(), 0);
+		std::fwrite(padding.data(), 1, padding.size(), output);
+
+		std::rewind(frames);
+		size_t read;
+		while ((read = std::fread(compressed.data(), 1, compressed.size(), frames)) > 0)
+			std::fwrite(compressed.data(), 1, read, output);
+		std::fclose(frames);
+	}
+	else
+	{
+		std::fseek(output, 0, SEEK_SET);
+		std::fwrite(&header, sizeof(header), 1, output);
+	}
+
+	bool written = std::ferror(output) == 0;
+	std::fclose(output);
+	if (!written)
+	{
+		std::fprintf(stderr, "unable to write %s\n", argv[1]);
+		return 1;
+	}
+	std::printf("%s: %u frames, %dx%d %s%s at %.2f fps, %.1fMB\n", argv[1], header.mFrameCount, width, height, format_name.c_str(), compress ? " lz4" : "",
+		frame_rate, static_cast<double>(header.mDataOffset + stored_size) / (1024.0 * 1024.0));
+	return header.mFrameCount > 0 ? 0 : 1;
+}
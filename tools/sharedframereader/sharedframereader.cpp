@@ -0,0 +1,147 @@
+// Reference consumer of the foglio shared frame ring, see module/src/sharedframeprotocol.h.
+// Reads frames in place and reports the latency from publish to consume. Maps the segment again when the publisher changes its layout.
+//
+// Build: c++ -std=c++17 -O2 -I../../module/src sharedframereader.cpp -o sharedframereader (add -lrt on older glibc)
+// Usage: sharedframereader [name] [frames]
+
+#include <sharedframeprotocol.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace nap;
+
+static int64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// Maps the segment and attaches to its layout, fails until the publisher completed one
+static bool openSegment(const std::string& name, sharedframe::View& outView)
+{
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	void* memory = MAP_FAILED;
+	size_t mapped_size = 0;
+	if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(sizeof(sharedframe::Header)))
+	{
+		mapped_size = static_cast<size_t>(info.st_size);
+		memory = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (memory == MAP_FAILED)
+		return false;
+	if (!sharedframe::attach(static_cast<sharedframe::Header*>(memory), mapped_size, outView))
+	{
+		munmap(memory, mapped_size);
+		return false;
+	}
+	return true;
+}
+
+
+static void waitForSegment(const std::string& name, sharedframe::View& outView)
+{
+	while (!openSegment(name, outView))
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	std::printf("%s: %u slots of %u bytes, generation %u\n", name.c_str(), outView.mSlotCount, outView.mSlotSize, outView.mGeneration);
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::string name = argc > 1 ? argv[1] : "/foglio";
+	int frame_count = argc > 2 ? std::atoi(argv[2]) : 600;
+
+	// Wait for the publisher
+	sharedframe::View view;
+	waitForSegment(name, view);
+	if (view.mHeader->mVersion != sharedframe::version)
+	{
+		std::fprintf(stderr, "unsupported version: %u\n", view.mHeader->mVersion);
+		return 1;
+	}
+
+	// Poll for new frames, touch the pixels in place and validate afterwards
+	std::vector<double> latencies;
+	latencies.reserve(std::max(frame_count, 0));
+	uint64_t last_frame = 0;
+	int torn = 0;
+	int skipped = 0;
+	int layouts = 0;
+	uint64_t checksum = 0;
+	while (latencies.size() < static_cast<size_t>(std::max(frame_count, 0)))
+	{
+		// The publisher changed the frame size, frame numbers continue in the new layout
+		if (!sharedframe::isCurrent(view))
+		{
+			munmap(view.mHeader, view.mMappedSize);
+			waitForSegment(name, view);
+			layouts++;
+			continue;
+		}
+
+		uint64_t sequence = 0;
+		const sharedframe::Slot* slot = sharedframe::beginRead(view, sequence);
+		if (slot == nullptr || slot->mFrame == last_frame)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			continue;
+		}
+
+		// The slot header isn't validated yet, never let it point past the slot
+		uint64_t frame = slot->mFrame;
+		int64_t timestamp = slot->mTimestamp;
+		uint32_t height = slot->mHeight;
+		uint32_t stride = slot->mStride;
+		if (static_cast<uint64_t>(stride) * height > view.mSlotSize - sharedframe::Slot::dataOffset)
+		{
+			torn++;
+			continue;
+		}
+		const uint8_t* pixels = sharedframe::getPixels(slot);
+		uint64_t sum = 0;
+		for (uint32_t y = 0; y < height; y += 64)
+			sum += pixels[static_cast<size_t>(y) * stride];
+		int64_t consumed = now();
+
+		if (!sharedframe::validate(view, slot, sequence))
+		{
+			torn++;
+			continue;
+		}
+		if (last_frame != 0 && frame > last_frame + 1)
+			skipped += static_cast<int>(frame - last_frame - 1);
+		last_frame = frame;
+		checksum += sum;
+		latencies.emplace_back(static_cast<double>(consumed - timestamp) / 1.0e6);
+	}
+	munmap(view.mHeader, view.mMappedSize);
+
+	std::printf("frames: %d, skipped: %d, torn: %d, layout changes: %d, checksum: %llu\n", static_cast<int>(latencies.size()), skipped, torn, layouts,
+		static_cast<unsigned long long>(checksum));
+	if (latencies.empty())
+	{
+		std::printf("no frames received\n");
+		return 0;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	double total = 0.0;
+	for (double latency : latencies)
+		total += latency;
+	std::printf("publish to consume latency (ms): avg %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+		total / latencies.size(), latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+	return 0;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Generates the resolution ladder of a video for foglio: lower resolution renditions next to the source,
+# named <name>.<height>p.<extension>. Every rendition gets a keyframe every KEYFRAME_INTERVAL seconds
+# with scene cut detection disabled, so all renditions share their keyframes and foglio can switch on one.
+# KEYFRAME_INTERVAL must match the 'KeyframeInterval' of the canvas group.
+#
+# Usage: make_ladder.sh <video> [height...]
+# Default heights: 1080 720 540 360
+
+set -e
+
+if [ $# -lt 1 ]; then
+	echo "usage: $0 <video> [height...]" >&2
+	exit 1
+fi
+
+SOURCE="$1"
+shift
+HEIGHTS="${*:-1080 720 540 360}"
+KEYFRAME_INTERVAL="${KEYFRAME_INTERVAL:-1}"
+
+DIR=$(dirname "$SOURCE")
+FILE=$(basename "$SOURCE")
+STEM="${FILE%.*}"
+EXTENSION="${FILE##*.}"
+SOURCE_HEIGHT=$(ffprobe -v error -select_streams v:0 -show_entries stream=height -of csv=p=0 "$SOURCE")
+
+for HEIGHT in $HEIGHTS; do
+	if [ "$HEIGHT" -ge "$SOURCE_HEIGHT" ]; then
+		echo "skipping ${HEIGHT}p, source is ${SOURCE_HEIGHT}p"
+		continue
+	fi
+	OUTPUT="$DIR/$STEM.${HEIGHT}p.$EXTENSION"
+	echo "$OUTPUT"
+	ffmpeg -y -v error -i "$SOURCE" -vf "scale=-2:$HEIGHT" -pix_fmt yuv420p \
+		-c:v libx264 -preset slow -crf 18 \
+		-force_key_frames "expr:gte(t,n_forced*$KEYFRAME_INTERVAL)" -sc_threshold 0 \
+		-c:a copy "$OUTPUT"
+done